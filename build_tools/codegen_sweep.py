@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+# Copyright 2022 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Sweep the static module codegen flags of a model and rank the variants.
+
+Every variant of the matrix (VLEN x LMUL cap x flag set) reconfigures one
+sweep build directory with the SPRINGBOK_RVV_VLEN, SPRINGBOK_RVV_LMUL_MAX and
+SPRINGBOK_CODEGEN_FLAGS cache variables, rebuilds the target (only the model
+modules depend on them) and runs it in Renode through test_runner.py. The
+variants are ranked by the "Inference cycles" the executable reports.
+
+Example:
+  ROOTDIR=$(pwd) ./build_tools/codegen_sweep.py \\
+    --target samples/quant_model/mobilenet_v1_bytecode_static \\
+    --renode-path build/renode/renode \\
+    --lmul 1,2,4,8 --vlen 256,512 \\
+    --flag-set default= \\
+    --flag-set data_tiling=--iree-flow-enable-data-tiling
+"""
+import argparse
+import itertools
+import os
+import shutil
+import subprocess
+
+import simulation
+
+
+parser = argparse.ArgumentParser(
+    description="Sweep codegen flags of a springbok model.")
+parser.add_argument("--target", required=True,
+                    help="Executable path relative to the build directory")
+parser.add_argument("--renode-path", required=True,
+                    help="Path to renode simulator")
+parser.add_argument("--lmul", default="1,2,4,8",
+                    help="LMUL caps to sweep (default: 1,2,4,8)")
+parser.add_argument("--vlen", default="512",
+                    help="Minimum VLENs to sweep, up to the simulated 512 "
+                    "(default: 512)")
+parser.add_argument("--flag-set", action="append", dest="flag_sets",
+                    metavar="NAME=FLAGS",
+                    help="Named set of extra iree-compile flags, such as "
+                    "tiling options. Repeat to sweep several "
+                    "(default: default=)")
+parser.add_argument("--build-dir",
+                    help="Sweep build directory "
+                    "(default: build/build-riscv-sweep)")
+parser.add_argument("--output",
+                    help="Ranked cycles table (default: "
+                    "<build-dir>/<target name>_sweep.md)")
+parser.add_argument("--timeout", type=int, default=3000,
+                    help="Timeout of each simulation (default: 3000)")
+
+SIM_VLEN = 512
+
+
+def configure(args, rootdir, build_dir, vlen, lmul, flags):
+    """Configure the sweep build like build_riscv.sh, with the variant."""
+    cmd = [
+        "cmake", "-G", "Ninja", "-B", build_dir,
+        "-DCMAKE_TOOLCHAIN_FILE=%s" %
+        os.path.join(rootdir, "cmake", "riscv_iree.cmake"),
+        "-DCMAKE_BUILD_TYPE=MinSizeRel",
+        "-DIREE_HOST_BIN_DIR=%s" %
+        os.path.join(rootdir, "build", "iree_compiler", "bin"),
+        "-DRISCV_TOOLCHAIN_ROOT=%s" % os.environ.get(
+            "RISCV_RV32_NEWLIB_TOOLCHAIN_ROOT",
+            os.path.join(rootdir, "build", "toolchain_iree_rv32imf")),
+        "-DSPRINGBOK_RVV_VLEN=%d" % vlen,
+        "-DSPRINGBOK_RVV_LMUL_MAX=%d" % lmul,
+        "-DSPRINGBOK_CODEGEN_FLAGS=%s" % flags,
+        rootdir,
+    ]
+    subprocess.run(cmd, check=True, stdout=subprocess.DEVNULL)
+
+
+def build(build_dir, target):
+    # iree_cc_binary names its target after the package path.
+    target_name = target.replace("/", "_")
+    subprocess.run(["cmake", "--build", build_dir, "--target", target_name],
+                   check=True, stdout=subprocess.DEVNULL)
+
+
+def write_table(path, target, results):
+    ranked = sorted(results, key=lambda r: (r["cycles"] is None,
+                                            r["cycles"] or 0))
+    best = ranked[0]["cycles"] if ranked and ranked[0]["cycles"] else None
+    lines = [
+        "# Codegen sweep of %s" % target,
+        "",
+        "| Rank | VLEN | LMUL | Flag set | Inference cycles | vs best |",
+        "| ---: | ---: | ---: | :------- | ---------------: | ------: |",
+    ]
+    for rank, r in enumerate(ranked, 1):
+        if r["cycles"] is None:
+            cycles, ratio = "FAILED", "-"
+        else:
+            cycles = str(r["cycles"])
+            ratio = "%.2fx" % (r["cycles"] / best)
+        lines.append("| %d | %d | %d | %s | %s | %s |" %
+                     (rank, r["vlen"], r["lmul"], r["flag_set"], cycles,
+                      ratio))
+    with open(path, "w") as f:
+        f.write("\n".join(lines) + "\n")
+    print("\n".join(lines))
+
+
+def main():
+    args = parser.parse_args()
+    rootdir = simulation.root_dir(parser)
+    build_dir = os.path.realpath(args.build_dir or os.path.join(
+        rootdir, "build", "build-riscv-sweep"))
+    lmuls = [int(x) for x in args.lmul.split(",")]
+    vlens = [int(x) for x in args.vlen.split(",")]
+    if any(v > SIM_VLEN or v & (v - 1) for v in vlens):
+        parser.error("VLEN must be a power of two up to %d" % SIM_VLEN)
+    flag_sets = []
+    for flag_set in args.flag_sets or ["default="]:
+        name, _, flags = flag_set.partition("=")
+        flag_sets.append((name, flags))
+
+    target_name = os.path.basename(args.target)
+    variant_dir = os.path.join(build_dir, "sweep", target_name)
+    os.makedirs(variant_dir, exist_ok=True)
+    results = []
+    for vlen, lmul, (name, flags) in itertools.product(vlens, lmuls,
+                                                       flag_sets):
+        variant = "vlen%d_lmul%d_%s" % (vlen, lmul, name)
+        print("Building %s" % variant, flush=True)
+        configure(args, rootdir, build_dir, vlen, lmul, flags)
+        build(build_dir, args.target)
+        # Keep every variant, since the next one rebuilds the same target.
+        elf = os.path.join(variant_dir, variant)
+        shutil.copy(os.path.join(build_dir, args.target), elf)
+        cycles = simulation.simulate(args, rootdir, elf)
+        print("  %s cycles" % (cycles if cycles is not None else "FAILED"),
+              flush=True)
+        results.append({"vlen": vlen, "lmul": lmul, "flag_set": name,
+                        "cycles": cycles})
+
+    output = args.output or os.path.join(build_dir,
+                                         "%s_sweep.md" % target_name)
+    write_table(output, args.target, results)
+
+
+if __name__ == "__main__":
+    main()
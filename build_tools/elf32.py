@@ -0,0 +1,93 @@
+# Copyright 2022 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Minimal ELF32 reader shared by the build tools.
+
+Reads the section headers, symbols and relocations of springbok executables
+and objects with the standard library only, so the tools do not depend on the
+binutils of the target toolchain or on a Python ELF package.
+"""
+import collections
+import struct
+
+
+SHT_SYMTAB = 2
+SHT_RELA = 4
+SHT_REL = 9
+SHF_ALLOC = 0x2
+SHF_EXECINSTR = 0x4
+STB_LOCAL = 0
+STT_FUNC = 2
+SHN_LORESERVE = 0xff00
+
+Section = collections.namedtuple(
+    "Section", "name type flags address offset size link info align entsize")
+Symbol = collections.namedtuple("Symbol", "name value size bind type shndx")
+Relocation = collections.namedtuple("Relocation", "offset symbol type")
+
+
+class Elf32:
+    """The section headers of an ELF32 file, with its symbols and relocations
+    on demand."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4] != 1:
+            raise ValueError("%s is not an ELF32 file" % path)
+        self.endian = "<" if self.data[5] == 1 else ">"
+        (shoff,) = struct.unpack_from(self.endian + "I", self.data, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(
+            self.endian + "HHH", self.data, 0x2e)
+        headers = [struct.unpack_from(self.endian + "IIIIIIIIII", self.data,
+                                      shoff + i * shentsize)
+                   for i in range(shnum)]
+        names_offset = headers[shstrndx][4] if headers else 0
+        self.sections = [
+            Section(self.string(names_offset, header[0]), *header[1:])
+            for header in headers
+        ]
+
+    def string(self, table_offset, offset):
+        start = table_offset + offset
+        return self.data[start:self.data.index(b"\0", start)].decode()
+
+    def symbols(self, symtab):
+        """Return the symbols of the SHT_SYMTAB section `symtab`, in table
+        order, so relocations can index them."""
+        strtab = self.sections[symtab.link].offset
+        symbols = []
+        for offset in range(symtab.offset, symtab.offset + symtab.size, 16):
+            name, value, size, info, _, shndx = struct.unpack_from(
+                self.endian + "IIIBBH", self.data, offset)
+            symbols.append(Symbol(self.string(strtab, name), value, size,
+                                  info >> 4, info & 0xf, shndx))
+        return symbols
+
+    def all_symbols(self):
+        """Return the symbols of all the SHT_SYMTAB sections."""
+        return [symbol for section in self.sections
+                if section.type == SHT_SYMTAB
+                for symbol in self.symbols(section)]
+
+    def relocations(self, section):
+        """Return the relocations of the SHT_REL or SHT_RELA `section`."""
+        entry = 12 if section.type == SHT_RELA else 8
+        relocations = []
+        for offset in range(section.offset, section.offset + section.size,
+                            entry):
+            address, info = struct.unpack_from(self.endian + "II", self.data,
+                                               offset)
+            relocations.append(Relocation(address, info >> 8, info & 0xff))
+        return relocations
@@ -0,0 +1,244 @@
+#!/usr/bin/env python3
+# Copyright 2022 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Break the memory footprint of a springbok ELF down by component.
+
+Every input section of the linker map is attributed to a component (the IREE
+runtime, the VM bytecode or EmitC module, the static kernel library, the
+embedded model inputs, newlib, ...) from the archive it comes from, and
+counted as text, rodata, data or bss after the output section it lands in.
+The section headers of the ELF then give the minimum ITCM and DTCM the
+executable links into, and the external memory its .ext_rodata takes. The
+heap takes the rest of the DTCM, so its size comes on top of the DTCM
+minimum.
+
+The `<executable>_footprint` targets run this on every executable, with the
+map springbok's add_executable asks the linker for.
+"""
+import argparse
+import collections
+import json
+import os
+import re
+
+import elf32
+
+
+parser = argparse.ArgumentParser(
+    description="Report the memory footprint of a springbok ELF.")
+parser.add_argument("elf", help="Executable to analyze")
+parser.add_argument("--map", dest="map_file",
+                    help="Linker map of the executable (default: <elf>.map)")
+parser.add_argument("--output",
+                    help="JSON report (default: <elf>_footprint.json)")
+
+ITCM_ORIGIN = 0x32000000
+DTCM_ORIGIN = 0x34000000
+EXT_ORIGIN = 0x60000000
+
+# Ordered rules from the input file of a section to its component.
+COMPONENTS = [
+    ("static kernel library", re.compile(r"_lib\.a\(")),
+    ("EmitC module", re.compile(r"_emitc\.a\(")),
+    ("VM bytecode module", re.compile(r"bytecode_module\w*\.a\(")),
+    ("IREE runtime", re.compile(r"/lib(iree|flatcc)_[^/]*\.a\(")),
+    ("sample runtime", re.compile(r"/libsamples_(util|device)_[^/]*\.a\(")),
+    ("springbok BSP", re.compile(r"/libspringbok\w*\.a\(")),
+    ("newlib", re.compile(r"/lib(c|g|m|nosys)(_nano)?\.a\(")),
+    ("libgcc", re.compile(r"/libgcc\.a\(")),
+]
+# Input data embedded by iree_model_input and its static storage in the
+# generated model header.
+MODEL_INPUT = re.compile(r"\.(data|rodata|bss|sdata|sbss)\.\w*_input"
+                         r"(_len|_\d+_storage)?$")
+
+KINDS = ("text", "rodata", "data", "bss")
+
+
+def section_kind(name):
+    """Map an output section to text, rodata, data or bss, or None."""
+    if name.startswith((".text", ".overlay")):
+        return "text"
+    if name.startswith((".rodata", ".srodata", ".ext_rodata", ".preinit_array",
+                        ".init_array", ".fini_array", ".eh_frame")):
+        return "rodata"
+    if name.startswith((".data", ".sdata")):
+        return "data"
+    if name.startswith((".bss", ".sbss")):
+        return "bss"
+    return None
+
+
+def component(input_section, input_file):
+    if MODEL_INPUT.search(input_section):
+        return "model inputs"
+    if input_section == "*fill*" or not input_file:
+        return "alignment and linker"
+    for name, pattern in COMPONENTS:
+        if pattern.search(input_file):
+            return name
+    return "application"
+
+
+def archive(input_file):
+    """Return the archive (or object) name of a map input file."""
+    match = re.match(r"(.*)\((.*)\)$", input_file)
+    return os.path.basename(match.group(1) if match else input_file)
+
+
+def parse_map(path):
+    """Return the memory regions and (output section, input section, file,
+    size) tuples of a GNU ld map."""
+    regions = {}
+    inputs = []
+    with open(path, "r") as f:
+        lines = f.read().splitlines()
+
+    i = 0
+    while i < len(lines) and lines[i] != "Memory Configuration":
+        i += 1
+    region = re.compile(r"^(\w+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)")
+    while i < len(lines) and lines[i] != "Linker script and memory map":
+        match = region.match(lines[i])
+        if match and match.group(1) != "Name":
+            regions[match.group(1)] = (int(match.group(2), 16),
+                                       int(match.group(3), 16))
+        i += 1
+
+    output_section = None
+    input_line = re.compile(
+        r"^ (\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)(?:\s+(\S.*))?$")
+    continuation = re.compile(
+        r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)(?:\s+(\S.*))?$")
+    for i in range(i, len(lines)):
+        line = lines[i].rstrip()
+        if line.startswith("."):
+            output_section = line.split()[0]
+            continue
+        if line.startswith("/DISCARD/"):
+            output_section = None
+            continue
+        if output_section is None or not line.startswith(" ") or \
+                line.startswith(" *("):
+            continue
+        match = input_line.match(line)
+        if match:
+            name, size, input_file = (match.group(1), int(match.group(3), 16),
+                                      match.group(4))
+        elif re.match(r"^ (\S+)$", line) and i + 1 < len(lines):
+            # Long section names put the address on the next line.
+            match = continuation.match(lines[i + 1])
+            if not match:
+                continue
+            name, size, input_file = (line.strip(), int(match.group(2), 16),
+                                      match.group(3))
+        else:
+            continue
+        if size:
+            inputs.append((output_section, name, (input_file or "").strip(),
+                           size))
+    return regions, inputs
+
+
+def read_sections(elf_path):
+    """Return the (name, address, size) allocated sections of an ELF32."""
+    return [(section.name, section.address, section.size)
+            for section in elf32.Elf32(elf_path).sections
+            if section.flags & elf32.SHF_ALLOC and section.size]
+
+
+def footprint(elf_path, map_path):
+    regions, inputs = parse_map(map_path)
+    components = collections.defaultdict(collections.Counter)
+    archives = collections.defaultdict(collections.Counter)
+    sections = collections.Counter()
+    for output_section, name, input_file, size in inputs:
+        kind = section_kind(output_section)
+        if kind is None:
+            continue
+        sections[kind] += size
+        components[component(name, input_file)][kind] += size
+        if input_file:
+            archives[archive(input_file)][kind] += size
+
+    def table(counters):
+        rows = {}
+        for name, counter in sorted(counters.items(),
+                                    key=lambda item: -sum(item[1].values())):
+            rows[name] = {kind: counter[kind] for kind in KINDS}
+            rows[name]["total"] = sum(counter.values())
+        return rows
+
+    # The stack sits at the top of the DTCM and the heap takes what is
+    # between the static data and the stack.
+    itcm_end = ITCM_ORIGIN
+    dtcm_end = DTCM_ORIGIN
+    ext_end = EXT_ORIGIN
+    stack = secondary_stacks = heap = 0
+    for name, address, size in read_sections(elf_path):
+        if name == ".stack":
+            stack = size
+        elif name == ".heap":
+            heap = size
+        elif address >= EXT_ORIGIN:
+            ext_end = max(ext_end, address + size)
+        elif address >= DTCM_ORIGIN:
+            dtcm_end = max(dtcm_end, address + size)
+            if name == ".secondary_stack":
+                secondary_stacks = size
+        elif address >= ITCM_ORIGIN:
+            itcm_end = max(itcm_end, address + size)
+
+    return {
+        "elf": os.path.realpath(elf_path),
+        "sections": {kind: sections[kind] for kind in KINDS},
+        "components": table(components),
+        "archives": table(archives),
+        "itcm": {
+            "length": regions.get("ITCM", (0, 0))[1],
+            "min": itcm_end - ITCM_ORIGIN,
+        },
+        "dtcm": {
+            "length": regions.get("DTCM", (0, 0))[1],
+            "static": dtcm_end - DTCM_ORIGIN - secondary_stacks,
+            "secondary_stacks": secondary_stacks,
+            "stack": stack,
+            "heap_available": heap,
+            "min_without_heap": dtcm_end - DTCM_ORIGIN + stack,
+        },
+        "ext": {
+            "length": regions.get("EXT", (0, 0))[1],
+            "min": ext_end - EXT_ORIGIN,
+        },
+    }
+
+
+def main():
+    args = parser.parse_args()
+    report = footprint(args.elf, args.map_file or args.elf + ".map")
+    output = args.output or args.elf + "_footprint.json"
+    with open(output, "w") as f:
+        json.dump(report, f, indent=2)
+        f.write("\n")
+
+    print("%s: ITCM %d bytes, DTCM %d bytes + heap, external %d bytes" %
+          (os.path.basename(args.elf), report["itcm"]["min"],
+           report["dtcm"]["min_without_heap"], report["ext"]["min"]))
+    for name, row in report["components"].items():
+        print("  %-22s %9d" % (name, row["total"]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+# Copyright 2022 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Pack images into the dataset directory the simulator serves to a model.
+
+The manifest lists one image per line, optionally followed by its integer
+label (the top-1 index the model should predict):
+
+  images/dog.jpg 208
+  images/cat.jpg 281
+
+Every image is converted like gen_mlmodel_input.py does for the compiled-in
+input, and the records are written back to back to <output>/inputs.bin. When
+every line has a label, the int32 labels go to <output>/labels.bin. Run the
+model over the dataset with `test_runner.py --dataset <output>`; see
+samples/util/dataset.h for the runtime side.
+"""
+import argparse
+import os
+
+import numpy as np
+from PIL import Image
+
+
+parser = argparse.ArgumentParser(
+    description="Pack a dataset of model inputs.")
+parser.add_argument("--manifest", required=True,
+                    help="Text file of '<image> [<label>]' lines, image paths "
+                    "relative to the manifest")
+parser.add_argument("--o", dest="output_dir", required=True,
+                    help="Output dataset directory")
+parser.add_argument("--s", dest="input_shape", required=True,
+                    help='Model input shape (example: "1, 224, 224, 3")')
+parser.add_argument("--q", dest="is_quant", action="store_true",
+                    help="Indicate it is quant model (default: False)")
+parser.add_argument("--r", dest="float_input_range", default="-1.0, 1.0",
+                    help='Float model input range (default: "-1.0, 1.0")')
+
+
+def read_manifest(path):
+    """Return the (image path, label or None) entries of the manifest."""
+    entries = []
+    base = os.path.dirname(os.path.realpath(path))
+    with open(path, "r") as f:
+        for number, line in enumerate(f, 1):
+            fields = line.split()
+            if not fields or fields[0].startswith("#"):
+                continue
+            if len(fields) > 2:
+                raise ValueError("%s:%d: expected '<image> [<label>]'" %
+                                 (path, number))
+            label = int(fields[1]) if len(fields) == 2 else None
+            entries.append((os.path.join(base, fields[0]), label))
+    return entries
+
+
+def convert(image_path, input_shape, is_quant, float_input_range):
+    """Convert an image (or raw .bin input) into the bytes of one record."""
+    length = int(np.prod(input_shape))
+    dtype = np.uint8 if is_quant else np.float32
+    if os.path.splitext(image_path)[1] in ("", ".bin"):
+        data = np.fromfile(image_path, dtype=dtype)
+    else:
+        image = Image.open(image_path).resize((input_shape[2], input_shape[1]))
+        data = np.array(image)
+        if not is_quant:
+            low = np.min(float_input_range)
+            high = np.max(float_input_range)
+            data = (high - low) * data / 255.0 + low
+    if data.size != length:
+        raise ValueError("%s holds %d values, the input shape %d" %
+                         (image_path, data.size, length))
+    data = data.reshape(length).astype(np.uint8 if is_quant else "<f4")
+    return data.tobytes()
+
+
+def main():
+    args = parser.parse_args()
+    input_shape = [int(x) for x in args.input_shape.split(",")]
+    if len(input_shape) < 3:
+        parser.error("Input shape < 3 dimensions")
+    float_input_range = [float(x) for x in args.float_input_range.split(",")]
+    entries = read_manifest(args.manifest)
+    if not entries:
+        parser.error("%s lists no image" % args.manifest)
+
+    os.makedirs(args.output_dir, exist_ok=True)
+    with open(os.path.join(args.output_dir, "inputs.bin"), "wb") as f:
+        for image_path, _ in entries:
+            f.write(convert(image_path, input_shape, args.is_quant,
+                            float_input_range))
+    labels_path = os.path.join(args.output_dir, "labels.bin")
+    if all(label is not None for _, label in entries):
+        np.array([label for _, label in entries], dtype="<i4").tofile(
+            labels_path)
+    elif os.path.exists(labels_path):
+        os.remove(labels_path)
+    print("%d records in %s" % (len(entries), args.output_dir))
+
+
+if __name__ == "__main__":
+    main()
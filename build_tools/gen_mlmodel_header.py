@@ -0,0 +1,347 @@
+#!/usr/bin/env python3
+# Copyright 2022 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Generate the MlModel descriptor header from the model entry function.
+
+The signature of the entry function in the MLIR input of iree-compile fixes
+the rank, shape and element type of every input and output. The generated
+header turns them into constants and statically allocated input storage, so
+the runtime needs no descriptor written by hand.
+
+Dynamic dimensions (`?`) of the inputs take the upper bounds given with --d,
+which size their storage, and are flagged in the dynamic_dims mask of the
+tensor. The dynamic dimensions of the outputs are only known at runtime, so
+they are 0 in the header, as are the length and byte size of those outputs.
+"""
+import argparse
+import os
+import re
+
+
+parser = argparse.ArgumentParser(
+    description="Generate the MlModel header of a compiled model.")
+parser.add_argument("--i", dest="input_file",
+                    help="MLIR input of iree-compile", required=True)
+parser.add_argument("--o", dest="output_file",
+                    help="Output header name", required=True)
+parser.add_argument("--n", dest="name",
+                    help="Name used for the generated symbols", required=True)
+parser.add_argument("--e", dest="entry",
+                    help="Entry function (default: first public function)")
+parser.add_argument("--m", dest="model_name",
+                    help="Model name reported at runtime (default: --n)")
+parser.add_argument("--g", dest="guard",
+                    help="Header guard (default: derived from --o)")
+parser.add_argument("--d", dest="dynamic_dim_max", type=int, action="append",
+                    default=[],
+                    help="Upper bound of a dynamic input dimension, repeated "
+                    "for each of them in order of appearance")
+
+# Matches the storage alignment of the IREE heap allocator.
+STORAGE_ALIGNMENT = "IREE_HAL_HEAP_BUFFER_ALIGNMENT"
+
+FLOAT_TYPES = {
+    "bf16": ("IREE_HAL_ELEMENT_TYPE_BFLOAT_16", 2),
+    "f16": ("IREE_HAL_ELEMENT_TYPE_FLOAT_16", 2),
+    "f32": ("IREE_HAL_ELEMENT_TYPE_FLOAT_32", 4),
+    "f64": ("IREE_HAL_ELEMENT_TYPE_FLOAT_64", 8),
+}
+
+
+def strip_strings(text):
+    """Blank out string literals so their contents never parse as syntax."""
+    return re.sub(r'"(\\.|[^"\\])*"', '""', text)
+
+
+def match_bracket(text, start, open_char, close_char):
+    """Return the index just past the bracket closing the one at `start`."""
+    depth = 0
+    for i in range(start, len(text)):
+        if text[i] == open_char:
+            depth += 1
+        elif text[i] == close_char:
+            depth -= 1
+            if depth == 0:
+                return i + 1
+    raise ValueError("unbalanced '%s' at offset %d" % (open_char, start))
+
+
+def tensor_types(text):
+    """Return the bodies of the top-level tensor<...> types in `text`."""
+    types = []
+    pos = 0
+    while True:
+        pos = text.find("tensor<", pos)
+        if pos < 0:
+            return types
+        end = match_bracket(text, pos + len("tensor"), "<", ">")
+        types.append(text[pos + len("tensor<"):end - 1])
+        pos = end
+
+
+def element_type(name):
+    """Map an MLIR element type to the HAL element type and its byte size."""
+    quant = re.match(r"!quant\.uniform<(u?)i?(\d+)", name)
+    if quant:
+        signedness = "UINT" if quant.group(1) else "SINT"
+        bits = int(quant.group(2))
+        return "IREE_HAL_ELEMENT_TYPE_%s_%d" % (signedness, bits), bits // 8
+    if name in FLOAT_TYPES:
+        return FLOAT_TYPES[name]
+    if name == "i1":
+        return "IREE_HAL_ELEMENT_TYPE_BOOL_8", 1
+    integer = re.fullmatch(r"(u|s)?i(8|16|32|64)", name)
+    if integer:
+        # Signless integers are passed as signed, like the samples always did.
+        signedness = "UINT" if integer.group(1) == "u" else "SINT"
+        bits = int(integer.group(2))
+        return "IREE_HAL_ELEMENT_TYPE_%s_%d" % (signedness, bits), bits // 8
+    raise ValueError("unsupported element type %s" % name)
+
+
+def parse_tensor(body):
+    """Split a tensor type body such as 1x224x224x3xui8 into shape and type.
+
+    Dynamic dimensions are None in the shape.
+    """
+    dims = []
+    rest = body
+    while True:
+        dim = re.match(r"(\d+|\?)x", rest)
+        if not dim:
+            break
+        dims.append(None if dim.group(1) == "?" else int(dim.group(1)))
+        rest = rest[dim.end():]
+    hal_type, size = element_type(rest)
+    return {"shape": dims, "element_type": hal_type, "element_size": size}
+
+
+def bound_tensors(tensors, bounds):
+    """Size the tensors, with their dynamic dimensions taken from `bounds`.
+
+    Without bounds (outputs), the dynamic dimensions and the length and byte
+    size of their tensor are 0. Returns the bounds left over.
+    """
+    bounds = list(bounds) if bounds is not None else None
+    for index, tensor in enumerate(tensors):
+        tensor["dynamic_dims"] = 0
+        length = 1
+        for i, dim in enumerate(tensor["shape"]):
+            if dim is None:
+                tensor["dynamic_dims"] |= 1 << i
+                if bounds is None:
+                    dim = 0
+                elif not bounds:
+                    raise ValueError(
+                        "no upper bound (--d) for dynamic dimension %d of "
+                        "input %d" % (i, index))
+                else:
+                    dim = bounds.pop(0)
+                tensor["shape"][i] = dim
+            length *= dim
+        tensor["length"] = length
+        tensor["size_bytes"] = length * tensor["element_size"]
+    return bounds
+
+
+def parse_signature(mlir, entry):
+    """Return the entry function name, inputs and outputs."""
+    mlir = strip_strings(mlir)
+    func_re = re.compile(r"func(?:\.func)?\s+(private\s+|public\s+)?@([\w$.]+)\s*\(")
+    for func in func_re.finditer(mlir):
+        visibility = (func.group(1) or "").strip()
+        name = func.group(2)
+        if entry is None and visibility == "private":
+            continue
+        if entry is not None and name != entry:
+            continue
+        args_end = match_bracket(mlir, func.end() - 1, "(", ")")
+        inputs = tensor_types(mlir[func.end():args_end - 1])
+        rest = mlir[args_end:].lstrip()
+        outputs = []
+        if rest.startswith("->"):
+            rest = rest[2:].lstrip()
+            if rest.startswith("("):
+                outputs = tensor_types(rest[1:match_bracket(rest, 0, "(", ")")])
+            elif rest.startswith("tensor<"):
+                outputs = tensor_types(
+                    rest[:match_bracket(rest, len("tensor"), "<", ">")])
+        return (name, [parse_tensor(t) for t in inputs],
+                [parse_tensor(t) for t in outputs])
+    raise ValueError("entry function %s not found" %
+                     ("@" + entry if entry else "(public)"))
+
+
+def write_tensors(lines, prefix, macro, kind, tensors, with_storage):
+    for i, tensor in enumerate(tensors):
+        lines.append("#define %s_%s_%d_LENGTH %d" %
+                     (macro, kind.upper(), i, tensor["length"]))
+        lines.append("#define %s_%s_%d_SIZE_BYTES %d" %
+                     (macro, kind.upper(), i, tensor["size_bytes"]))
+    lines.append("")
+    for i, tensor in enumerate(tensors):
+        lines.append("static const iree_hal_dim_t %s_%s_%d_shape[] = {%s};" %
+                     (prefix, kind, i,
+                      ", ".join(str(d) for d in tensor["shape"]) or "0"))
+        if with_storage:
+            lines.append("static iree_alignas(%s) uint8_t %s_%s_%d_storage[%d];" %
+                         (STORAGE_ALIGNMENT, prefix, kind, i,
+                          max(tensor["size_bytes"], 1)))
+    lines.append("")
+    lines.append("static const MlTensor %s_%ss[] = {" % (prefix, kind))
+    for i, tensor in enumerate(tensors):
+        storage = ("%s_%s_%d_storage" % (prefix, kind, i)
+                   if with_storage else "NULL")
+        lines.append("    {")
+        lines.append("        .rank = %d," % len(tensor["shape"]))
+        lines.append("        .shape = %s_%s_%d_shape," % (prefix, kind, i))
+        if tensor["dynamic_dims"]:
+            lines.append("        .dynamic_dims = 0x%x," %
+                         tensor["dynamic_dims"])
+        lines.append("        .length = %d," % tensor["length"])
+        lines.append("        .size_bytes = %d," % tensor["size_bytes"])
+        lines.append("        .element_type = %s," % tensor["element_type"])
+        lines.append("        .data = %s," % storage)
+        lines.append("    },")
+    lines.append("};")
+    lines.append("")
+
+
+def write_direct_call(lines, prefix, entry, num_inputs, num_outputs):
+    """Write the typed direct call of the entry function for EmitC builds."""
+    cconv = "0%s_%s" % ("r" * num_inputs, "r" * num_outputs)
+    lines += [
+        "#if defined(BUILD_EMITC)",
+        "// Arguments and results of @%s in the register layout of its" % entry,
+        '// "%s" calling convention.' % cconv,
+        "typedef struct {",
+    ]
+    lines += ["  iree_vm_ref_t input_%d;" % i for i in range(num_inputs)]
+    lines += ["} %s_args_t;" % prefix, "", "typedef struct {"]
+    lines += ["  iree_vm_ref_t output_%d;" % i for i in range(num_outputs)]
+    lines += [
+        "} %s_results_t;" % prefix,
+        "",
+        "static iree_status_t %s_direct_call(" % prefix,
+        "    iree_vm_context_t *context, iree_vm_function_t function,",
+        "    iree_hal_buffer_view_t *const *inputs,",
+        "    iree_hal_buffer_view_t **outputs) {",
+        "  %s_args_t args = {" % prefix,
+    ]
+    lines += ["      .input_%d = iree_hal_buffer_view_retain_ref(inputs[%d]),"
+              % (i, i) for i in range(num_inputs)]
+    lines += [
+        "  };",
+        "  %s_results_t results = {0};" % prefix,
+        "  iree_status_t status = direct_call(",
+        "      context, function, iree_make_byte_span(&args, sizeof(args)),",
+        "      iree_make_byte_span(&results, sizeof(results)));",
+    ]
+    lines += ["  iree_vm_ref_release(&args.input_%d);" % i
+              for i in range(num_inputs)]
+    for i in range(num_outputs):
+        lines += [
+            "  if (iree_status_is_ok(status)) {",
+            "    status = iree_hal_buffer_view_check_deref(results.output_%d,"
+            % i,
+            "                                              &outputs[%d]);" % i,
+            "  }",
+        ]
+    lines += ["  if (!iree_status_is_ok(status)) {"]
+    for i in range(num_outputs):
+        lines += ["    iree_vm_ref_release(&results.output_%d);" % i,
+                  "    outputs[%d] = NULL;" % i]
+    lines += [
+        "  }",
+        "  return status;",
+        "}",
+        "#endif  // defined(BUILD_EMITC)",
+        "",
+    ]
+
+
+def gen_mlmodel_header(args):
+    with open(args.input_file, "r") as f:
+        entry, inputs, outputs = parse_signature(f.read(), args.entry)
+    if not inputs or not outputs:
+        raise ValueError("@%s needs tensor inputs and outputs" % entry)
+    if bound_tensors(inputs, args.dynamic_dim_max):
+        raise ValueError("more upper bounds (--d) than dynamic input "
+                         "dimensions of @%s" % entry)
+    bound_tensors(outputs, None)
+
+    prefix = re.sub(r"\W", "_", args.name)
+    macro = prefix.upper()
+    guard = args.guard or re.sub(
+        r"\W", "_", os.path.basename(args.output_file)).upper() + "_"
+    model_name = args.model_name or args.name
+
+    lines = [
+        "// Generated by build_tools/gen_mlmodel_header.py from the signature",
+        "// of @%s in %s. Do not edit." % (entry,
+                                           os.path.basename(args.input_file)),
+        "",
+        "#ifndef %s" % guard,
+        "#define %s" % guard,
+        "",
+        '#include "samples/util/direct_call.h"',
+        '#include "samples/util/model_api.h"',
+        "",
+        "#define %s_NUM_INPUTS %d" % (macro, len(inputs)),
+        "#define %s_NUM_OUTPUTS %d" % (macro, len(outputs)),
+    ]
+    write_tensors(lines, prefix, macro, "input", inputs, with_storage=True)
+    write_tensors(lines, prefix, macro, "output", outputs, with_storage=False)
+    lines += [
+        "static iree_hal_buffer_mapping_t %s_output_mappings[%d];" %
+        (prefix, len(outputs)),
+        "",
+    ]
+    write_direct_call(lines, prefix, entry, len(inputs), len(outputs))
+    lines += [
+        "// The descriptor is kModel, the model util.c runs, unless the sample",
+        "// names it with %s_DESCRIPTOR to run it in a pipeline with others." %
+        macro,
+        "#if !defined(%s_DESCRIPTOR)" % macro,
+        "#define %s_DESCRIPTOR kModel" % macro,
+        "#endif",
+        "const MlModel %s_DESCRIPTOR = {" % macro,
+        "    .num_input = %s_NUM_INPUTS," % macro,
+        "    .inputs = %s_inputs," % prefix,
+        "    .num_output = %s_NUM_OUTPUTS," % macro,
+        "    .outputs = %s_outputs," % prefix,
+        "    .output_mappings = %s_output_mappings," % prefix,
+        '    .entry_func = "module.%s",' % entry,
+        '    .model_name = "%s",' % model_name,
+        "#if defined(BUILD_EMITC)",
+        "    .direct_call = %s_direct_call," % prefix,
+        "#endif",
+        "#if defined(BENCHMARK_INVOCATIONS)",
+        "    .benchmark_invocations = BENCHMARK_INVOCATIONS,",
+        "#endif",
+        "#if defined(RESULT_CACHE)",
+        "    .result_cache = RESULT_CACHE,",
+        "#endif",
+        "};",
+        "",
+        "#endif  // %s" % guard,
+        "",
+    ]
+    with open(args.output_file, "w") as f:
+        f.write("\n".join(lines))
+
+
+if __name__ == "__main__":
+    gen_mlmodel_header(parser.parse_args())
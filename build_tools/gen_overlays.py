@@ -0,0 +1,232 @@
+#!/usr/bin/env python3
+# Copyright 2022 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Move the dispatch functions of a static library object into code overlays.
+
+iree-compile emits every function of a static library into a section of its
+own. The sections that reference each other through relocations form groups
+that must be resident together, and the group of the library query function,
+the one global function, stays in .text. The other groups are packed into at
+most SLOT_COUNT slots that each fit the ITCM overlay window, and their
+sections renamed to .overlay<slot>, which springbok.ld links at the window
+and loads into DTCM.
+
+The slot of every dispatch function is recorded in an .overlay_table section
+of the object, as (FNV-1a hash of "<library>:<function>", slot) pairs, which
+the overlay manager of samples/device looks the exports of the library up in.
+The library name is the one of its `<library>_library_query` function, unique
+in an executable, as export names are not: the models of a pipeline have
+dispatches of the same name. Every entry also gets a global
+__overlay_hash_<hash> symbol, so two objects with the same hash fail the link
+as multiple definitions.
+
+Slots are numbered from 0 in every object, so the overlays of several
+libraries linked into one executable share the slots, which then have to fit
+the window together.
+"""
+import argparse
+import os
+import struct
+import subprocess
+import tempfile
+
+import elf32
+
+
+parser = argparse.ArgumentParser(
+    description="Move the dispatch functions of a static library object into "
+    "code overlays.")
+parser.add_argument("--i", dest="input_file", required=True,
+                    help="Static library object of iree-compile")
+parser.add_argument("--o", dest="output_file", required=True,
+                    help="Output object")
+parser.add_argument("--w", dest="window", required=True,
+                    help="Byte size of the overlay window, with an optional "
+                    "K or M suffix as in the --defsym of __overlay_window__")
+parser.add_argument("--objcopy", default="objcopy",
+                    help="objcopy of the target toolchain")
+
+# Matches the .overlay<n> output sections of springbok.ld.
+SLOT_COUNT = 8
+
+QUERY_SUFFIX = "_library_query"
+
+
+def parse_size(text):
+    scale = {"K": 1024, "M": 1024 * 1024}.get(text[-1:].upper(), 1)
+    return int(text[:-1] if scale > 1 else text, 0) * scale
+
+
+def fnv1a(name):
+    value = 0x811c9dc5
+    for byte in name.encode():
+        value = ((value ^ byte) * 0x01000193) & 0xffffffff
+    return value
+
+
+def read_object(path):
+    """Return the sections of an ELF32 relocatable object as dicts, with the
+    symbols and relocations attached to the sections they belong to."""
+    elf = elf32.Elf32(path)
+    sections = [{"name": section.name, "type": section.type,
+                 "flags": section.flags, "size": section.size,
+                 "align": max(section.align, 1), "functions": [],
+                 "global": False, "references": set()}
+                for section in elf.sections]
+
+    symbols = []
+    for symtab in elf.sections:
+        if symtab.type != elf32.SHT_SYMTAB:
+            continue
+        for symbol in elf.symbols(symtab):
+            symbols.append(symbol.shndx)
+            if not 0 < symbol.shndx < elf32.SHN_LORESERVE:
+                continue
+            target = sections[symbol.shndx]
+            if symbol.type == elf32.STT_FUNC:
+                target["functions"].append(symbol.name)
+            if symbol.bind != elf32.STB_LOCAL:
+                target["global"] = True
+
+    for section in elf.sections:
+        if section.type not in (elf32.SHT_RELA, elf32.SHT_REL):
+            continue
+        source = sections[section.info]
+        for relocation in elf.relocations(section):
+            shndx = symbols[relocation.symbol] \
+                if relocation.symbol < len(symbols) else 0
+            if 0 < shndx < elf32.SHN_LORESERVE:
+                source["references"].add(shndx)
+    return sections, elf.endian
+
+
+def library_name(sections):
+    """Return the name of the library of its query function."""
+    for section in sections:
+        if not section["global"]:
+            continue
+        for function in section["functions"]:
+            if function.endswith(QUERY_SUFFIX):
+                return function[:-len(QUERY_SUFFIX)]
+    raise ValueError("no %s function" % QUERY_SUFFIX)
+
+
+def is_code(section):
+    code = elf32.SHF_ALLOC | elf32.SHF_EXECINSTR
+    return section["flags"] & code == code and section["size"] > 0
+
+
+def code_groups(sections):
+    """Group the code sections that reference each other, and return the
+    groups that hold no global symbol."""
+    code = [i for i, section in enumerate(sections) if is_code(section)]
+    parent = {i: i for i in code}
+
+    def find(i):
+        while parent[i] != i:
+            parent[i] = parent[parent[i]]
+            i = parent[i]
+        return i
+
+    for i in code:
+        for j in sections[i]["references"]:
+            if j in parent:
+                parent[find(i)] = find(j)
+    groups = {}
+    for i in code:
+        groups.setdefault(find(i), []).append(i)
+    return [group for group in groups.values()
+            if not any(sections[i]["global"] for i in group)]
+
+
+def group_size(sections, group):
+    size = 0
+    for i in group:
+        align = sections[i]["align"]
+        size = (size + align - 1) // align * align + sections[i]["size"]
+    return size
+
+
+def pack_slots(sections, groups, window):
+    """First-fit decreasing packing of the groups into the window slots."""
+    slots = []
+    for group in sorted(groups, key=lambda g: -group_size(sections, g)):
+        size = group_size(sections, group)
+        if size > window:
+            raise ValueError(
+                "%s needs %d bytes, more than the %d-byte overlay window" %
+                (", ".join(sections[i]["name"] for i in group), size, window))
+        for slot in slots:
+            if slot["size"] + size <= window:
+                break
+        else:
+            if len(slots) == SLOT_COUNT:
+                raise ValueError("the code does not fit %d overlay slots of "
+                                 "%d bytes" % (SLOT_COUNT, window))
+            slot = {"size": 0, "groups": []}
+            slots.append(slot)
+        slot["size"] += size
+        slot["groups"].append(group)
+    return slots
+
+
+def gen_overlays(args):
+    sections, endian = read_object(args.input_file)
+    if sum(1 for section in sections if is_code(section)) < 2:
+        raise ValueError("%s has a single code section: compile it with "
+                         "function sections to overlay it" % args.input_file)
+    window = parse_size(args.window)
+    slots = pack_slots(sections, code_groups(sections), window)
+
+    library = library_name(sections)
+    objcopy = [args.objcopy]
+    table = b""
+    hashes = {}
+    for index, slot in enumerate(slots):
+        for group in slot["groups"]:
+            for i in group:
+                objcopy.append("--rename-section=%s=.overlay%d" %
+                               (sections[i]["name"], index))
+                for function in sections[i]["functions"]:
+                    value = fnv1a("%s:%s" % (library, function))
+                    if hashes.setdefault(value, function) != function:
+                        raise ValueError("%s and %s hash alike" %
+                                         (hashes[value], function))
+                    table += struct.pack(endian + "II", value, index)
+        print("%s: overlay slot %d, %d bytes" %
+              (os.path.basename(args.input_file), index, slot["size"]))
+
+    with tempfile.TemporaryDirectory() as temp_dir:
+        table_file = os.path.join(temp_dir, "overlay_table.bin")
+        with open(table_file, "wb") as f:
+            f.write(table)
+        objcopy += [
+            "--add-section=.overlay_table=%s" % table_file,
+            "--set-section-flags=.overlay_table=alloc,load,readonly,data",
+            args.input_file, args.output_file,
+        ]
+        subprocess.run(objcopy, check=True)
+    # objcopy only aligns a section, or defines a symbol in it, that exists
+    # before the run.
+    objcopy = [args.objcopy, "--set-section-alignment=.overlay_table=4"]
+    for offset in range(0, len(table), 8):
+        (value,) = struct.unpack_from(endian + "I", table, offset)
+        objcopy.append("--add-symbol=__overlay_hash_%08x=.overlay_table:%d,"
+                       "global" % (value, offset))
+    subprocess.run(objcopy + [args.output_file], check=True)
+
+
+if __name__ == "__main__":
+    gen_overlays(parser.parse_args())
@@ -0,0 +1,339 @@
+#!/usr/bin/env python3
+# Copyright 2022 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Drive the inference server mode of a springbok executable in Renode.
+
+This stands in for the management core. It halts the vector core at the
+inference marker, switches the firmware to server mode through
+`springbok_server_queue` (see samples/util/server.h), and keeps its ring of
+request descriptors full: it posts requests while the core is halted, resumes
+it, and collects the completions every time the firmware halts for the host
+with the HostReq IRQ of the control block.
+
+Latencies are measured in simulated cycles, from the post of a request to its
+completion; Renode runs one instruction per cycle, so `--clock-mhz` turns
+them into time and into the sustained requests per second.
+
+Example:
+  ROOTDIR=$(pwd) ./build_tools/inference_server_host.py \\
+    build/build-riscv/samples/quant_model/mobilenet_v1_emitc_static \\
+    --renode-path build/renode/renode --requests 16
+"""
+import argparse
+import io
+import json
+import os
+import re
+import struct
+import sys
+import tempfile
+import time
+
+import pexpect
+
+
+parser = argparse.ArgumentParser(
+    description="Serve inference requests to a springbok executable.")
+parser.add_argument("elf", help="Executable to serve from")
+parser.add_argument("--renode-path", required=True,
+                    help="Path to renode simulator")
+parser.add_argument("--requests", type=int, default=8,
+                    help="Number of requests to serve (default: 8)")
+parser.add_argument("--in-flight", type=int,
+                    help="Requests posted ahead of the completed ones "
+                    "(default: the depth of the ring)")
+parser.add_argument("--inputs",
+                    help="Records of model inputs, such as the inputs.bin of "
+                    "gen_dataset.py, copied round-robin into the requests "
+                    "(default: the compiled-in input)")
+parser.add_argument("--clock-mhz", type=float, default=100.0,
+                    help="Clock of the vector core (default: 100)")
+parser.add_argument("--json-output", help="Path to a JSON report")
+parser.add_argument("--timeout", type=int, default=1000,
+                    help="Timeout of each request, in seconds (default: 1000)")
+parser.add_argument("--quick_test",
+                    help="allow quickest test time", action="store_true")
+
+PROMPT = r"\(springbok\)"
+TERMINATION_STRINGS = [
+    "main returned",
+    "Exception occurred",
+    "ReadByte from non existing peripheral",
+]
+QUEUE_SYMBOL = "springbok_server_queue"
+CONTROL_BLOCK = "sysbus.vec_controlblock"
+INTR_STATE = 0x0
+CONTROL = 0xc
+HOSTREQ_IRQ = 0x1
+MARKER_INFERENCE = 1
+
+# Word offsets of ServerQueue and ServerRequest.
+QUEUE_FIELDS = ("enabled", "stop", "head", "tail", "depth", "staging_address",
+                "slot_size", "input_size", "output_size")
+REQUEST_FIELDS = ("request_id", "model_id", "input_address", "output_address",
+                  "status", "start_ccount", "end_ccount", "inference_cycles")
+
+
+def queue_offset(field):
+    return 4 * QUEUE_FIELDS.index(field)
+
+
+def request_offset(slot, field):
+    return (4 * len(QUEUE_FIELDS) + 4 * len(REQUEST_FIELDS) * slot +
+            4 * REQUEST_FIELDS.index(field))
+
+
+def read_symbol(elf_path, symbol):
+    """Return the address of a symbol of an ELF32."""
+    with open(elf_path, "rb") as f:
+        elf = f.read()
+    if elf[:4] != b"\x7fELF" or elf[4] != 1:
+        raise ValueError("%s is not an ELF32 file" % elf_path)
+    endian = "<" if elf[5] == 1 else ">"
+    (shoff,) = struct.unpack_from(endian + "I", elf, 0x20)
+    shentsize, shnum = struct.unpack_from(endian + "HH", elf, 0x2e)
+    sections = [struct.unpack_from(endian + "IIIIIIIIII", elf,
+                                   shoff + i * shentsize)
+                for i in range(shnum)]
+    for section in sections:
+        sh_type, sh_offset, sh_size, sh_link = (section[1], section[4],
+                                                section[5], section[6])
+        if sh_type != 2:  # SHT_SYMTAB
+            continue
+        strtab_offset = sections[sh_link][4]
+        for offset in range(sh_offset, sh_offset + sh_size, 16):
+            name, value = struct.unpack_from(endian + "II", elf, offset)
+            end = elf.index(b"\0", strtab_offset + name)
+            if elf[strtab_offset + name:end].decode() == symbol:
+                return value
+    raise ValueError("%s has no %s; is it built with samples/util?" %
+                     (elf_path, symbol))
+
+
+class Renode:
+    """ The Renode monitor of the springbok machine. """
+    def __init__(self, renode_path, elf, quick_test):
+        rootdir = os.environ.get("ROOTDIR")
+        if rootdir is None:
+            parser.error("ROOTDIR environment variable not set.")
+        script = """
+$bin=@%s
+path set @%s
+include @sim/config/springbok.resc
+sysbus.cpu2 StopAtMarker %d""" % (os.path.realpath(elf),
+                                 os.path.realpath(rootdir), MARKER_INFERENCE)
+        if quick_test:
+            script += """
+sysbus.cpu2 PerformanceInMips 2000
+emulation SetGlobalQuantum "1" """
+        file_desc, self.script_path = tempfile.mkstemp(suffix=".resc")
+        with os.fdopen(file_desc, "w") as tmp:
+            tmp.write(script)
+        self.log = io.StringIO()
+        self.child = pexpect.spawn(
+            " ".join([renode_path, "--disable-xwt", "--console", "--plain",
+                      self.script_path]),
+            encoding="utf-8", timeout=120)
+        self.child.logfile_read = self.log
+        self.child.expect(PROMPT)
+
+    def command(self, command):
+        """ Run a monitor command and return what it printed. """
+        self.child.sendline(command)
+        self.child.expect(PROMPT)
+        # Drop the echo of the command.
+        return self.child.before.split(command, 1)[-1]
+
+    def read_word(self, address):
+        answer = self.command("sysbus ReadDoubleWord 0x%x" % address)
+        return int(re.findall(r"0x([0-9A-Fa-f]+)", answer)[-1], 16)
+
+    def write_word(self, address, value):
+        self.command("sysbus WriteDoubleWord 0x%x 0x%x" %
+                     (address, value & 0xffffffff))
+
+    def ccount(self):
+        answer = self.command("sysbus.cpu2 ExecutedInstructions")
+        return int(re.findall(r"\d+", answer)[-1]) & 0xffffffff
+
+    def resume(self):
+        self.command("%s WriteDoubleWord 0x%x 0" % (CONTROL_BLOCK, CONTROL))
+
+    def wait_hostreq(self, timeout):
+        """ Wait for the core to halt for the host, and acknowledge it. """
+        deadline = time.time() + timeout
+        while True:
+            answer = self.command("%s ReadDoubleWord 0x%x" %
+                                  (CONTROL_BLOCK, INTR_STATE))
+            if int(re.findall(r"0x([0-9A-Fa-f]+)", answer)[-1], 16) & \
+                    HOSTREQ_IRQ:
+                self.command("%s WriteDoubleWord 0x%x 0x%x" %
+                             (CONTROL_BLOCK, INTR_STATE, HOSTREQ_IRQ))
+                return
+            if any(x in self.log.getvalue() for x in TERMINATION_STRINGS):
+                sys.exit("the executable exited instead of serving:\n" +
+                         self.log.getvalue())
+            if time.time() > deadline:
+                sys.exit("timed out waiting for the executable")
+            time.sleep(0.05)
+
+    def wait_exit(self, timeout):
+        self.child.expect(TERMINATION_STRINGS, timeout=timeout)
+        self.child.expect("\n", timeout=timeout)
+
+    def close(self):
+        try:
+            self.child.sendline("q")
+            self.child.expect(pexpect.EOF, timeout=10)
+        except (pexpect.exceptions.TIMEOUT, pexpect.exceptions.EOF):
+            pass
+        self.child.close(force=True)
+        os.remove(self.script_path)
+
+
+def split_records(path, record_size, directory):
+    """ Write every record of an inputs file to its own file, for LoadBinary.
+    """
+    with open(path, "rb") as f:
+        data = f.read()
+    if not data or len(data) % record_size:
+        sys.exit("%s is not a whole number of %d-byte records" %
+                 (path, record_size))
+    records = []
+    for i in range(len(data) // record_size):
+        record = os.path.join(directory, "record_%d.bin" % i)
+        with open(record, "wb") as f:
+            f.write(data[i * record_size:(i + 1) * record_size])
+        records.append(record)
+    return records
+
+
+def serve(args, renode, queue):
+    """ Serve the requests and return their post, start and end cycles. """
+    # Halted at the marker, before the first inference.
+    renode.wait_hostreq(args.timeout)
+    renode.write_word(queue + queue_offset("enabled"), 1)
+    renode.command("sysbus.cpu2 StopAtMarker 0")
+    renode.resume()
+    # Halted with an empty ring.
+    renode.wait_hostreq(args.timeout)
+    field = {name: renode.read_word(queue + queue_offset(name))
+             for name in QUEUE_FIELDS[4:]}
+    depth = field["depth"]
+    in_flight = min(args.in_flight or depth, depth)
+    records = []
+    if args.inputs:
+        records = split_records(args.inputs, field["input_size"],
+                                tempfile.mkdtemp())
+
+    requests = []
+    completed = 0
+    start = time.time()
+    while completed < args.requests:
+        while len(requests) < args.requests and \
+                len(requests) - completed < in_flight:
+            n = len(requests)
+            slot = n % depth
+            staging = field["staging_address"] + slot * field["slot_size"]
+            input_address = 0
+            if records:
+                renode.command("sysbus LoadBinary @%s 0x%x" %
+                               (records[n % len(records)], staging))
+                input_address = staging
+            for name, value in (("request_id", n), ("model_id", 0),
+                                ("input_address", input_address),
+                                ("output_address",
+                                 staging + field["input_size"])):
+                renode.write_word(queue + request_offset(slot, name), value)
+            requests.append({"request_id": n, "post_ccount": renode.ccount()})
+            renode.write_word(queue + queue_offset("head"), len(requests))
+        renode.resume()
+        renode.wait_hostreq(args.timeout)
+        tail = renode.read_word(queue + queue_offset("tail"))
+        for n in range(completed, tail):
+            for name in REQUEST_FIELDS[4:]:
+                requests[n][name] = renode.read_word(
+                    queue + request_offset(n % depth, name))
+        completed = tail
+    wall_seconds = time.time() - start
+
+    renode.write_word(queue + queue_offset("stop"), 1)
+    renode.resume()
+    renode.wait_exit(args.timeout)
+    return requests, wall_seconds
+
+
+def report(args, requests, wall_seconds):
+    mask = 0xffffffff
+    latencies = [(r["end_ccount"] - r["post_ccount"]) & mask
+                 for r in requests]
+    services = [(r["end_ccount"] - r["start_ccount"]) & mask
+                for r in requests]
+    span = (requests[-1]["end_ccount"] - requests[0]["post_ccount"]) & mask
+    failed = [r["request_id"] for r in requests if r["status"]]
+    cycles_per_us = args.clock_mhz
+    summary = {
+        "elf": os.path.realpath(args.elf),
+        "requests": len(requests),
+        "failed": failed,
+        "clock_mhz": args.clock_mhz,
+        "cycles": span,
+        "requests_per_second": (len(requests) * cycles_per_us * 1e6 / span
+                                if span else 0.0),
+        "latency_cycles": {
+            "mean": sum(latencies) / len(latencies),
+            "min": min(latencies),
+            "max": max(latencies),
+        },
+        "service_cycles_mean": sum(services) / len(services),
+        "inference_cycles_mean": (sum(r["inference_cycles"]
+                                      for r in requests) / len(requests)),
+        "simulated_requests_per_wall_second": len(requests) / wall_seconds,
+        "per_request": requests,
+    }
+    print("Served %d requests, %d failed" % (len(requests), len(failed)))
+    print("Sustained throughput: %.2f requests/s at %g MHz" %
+          (summary["requests_per_second"], args.clock_mhz))
+    latency = summary["latency_cycles"]
+    print("Request latency: mean %.0f, min %d, max %d cycles "
+          "(mean %.1f us)" % (latency["mean"], latency["min"],
+                              latency["max"],
+                              latency["mean"] / cycles_per_us))
+    print("Service time: mean %.0f cycles, of which inference %.0f" %
+          (summary["service_cycles_mean"], summary["inference_cycles_mean"]))
+    if args.json_output:
+        with open(args.json_output, "w") as f:
+            json.dump(summary, f, indent=2)
+            f.write("\n")
+    return 1 if failed else 0
+
+
+def main():
+    args = parser.parse_args()
+    if args.requests < 1:
+        parser.error("--requests must be positive")
+    queue = read_symbol(args.elf, QUEUE_SYMBOL)
+    renode = Renode(args.renode_path, args.elf, args.quick_test)
+    try:
+        renode.command("start")
+        renode.resume()
+        requests, wall_seconds = serve(args, renode, queue)
+    finally:
+        renode.close()
+    sys.exit(report(args, requests, wall_seconds))
+
+
+if __name__ == "__main__":
+    main()
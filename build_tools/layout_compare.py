@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+# Copyright 2022 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Compare the cycles and rodata of a model built with two weight layouts.
+
+The baseline and variant executables (such as mobilenet_v1_emitc_static and
+its DATA_TILING build mobilenet_v1_emitc_static_data_tiling) are run in Renode
+through test_runner.py, which uses the Renode server when RENODE_SERVER is
+set, and their linker maps are broken down by elf_footprint.py. The table
+reports the inference cycles, the rodata of the module (where the weights
+live), of the static kernel library and of the whole executable, and the
+minimum ITCM and DTCM of each.
+
+Example:
+  ROOTDIR=$(pwd) ./build_tools/layout_compare.py \\
+    --renode-path build/renode/renode \\
+    build/build-riscv/samples/quant_model/mobilenet_v1_emitc_static \\
+    build/build-riscv/samples/quant_model/mobilenet_v1_emitc_static_data_tiling
+"""
+import argparse
+import json
+import os
+import sys
+
+import elf_footprint
+import simulation
+
+
+parser = argparse.ArgumentParser(
+    description="Compare two weight layouts of a springbok model.")
+parser.add_argument("baseline", help="Executable with the current layout")
+parser.add_argument("variant", help="Executable with the layout to compare")
+parser.add_argument("--renode-path", required=True,
+                    help="Path to renode simulator")
+parser.add_argument("--output",
+                    help="Markdown table (default: "
+                    "<variant>_layout_compare.md), written along with a "
+                    ".json of the same name")
+parser.add_argument("--timeout", type=int, default=3000,
+                    help="Timeout of each simulation (default: 3000)")
+
+MODULE_COMPONENTS = ("EmitC module", "VM bytecode module")
+
+
+def measure(args, rootdir, elf):
+    report = elf_footprint.footprint(elf, elf + ".map")
+    components = report["components"]
+
+    def rodata(names):
+        return sum(components[name]["rodata"] for name in names
+                   if name in components)
+
+    return {
+        "elf": os.path.realpath(elf),
+        "cycles": simulation.simulate(args, rootdir, elf),
+        "module_rodata": rodata(MODULE_COMPONENTS),
+        "library_rodata": rodata(["static kernel library"]),
+        "rodata": report["sections"]["rodata"],
+        "itcm": report["itcm"]["min"],
+        "dtcm": report["dtcm"]["min_without_heap"],
+    }
+
+
+def write_report(path, baseline, variant):
+    rows = [
+        ("Inference cycles", "cycles"),
+        ("Module rodata", "module_rodata"),
+        ("Kernel library rodata", "library_rodata"),
+        ("Total rodata", "rodata"),
+        ("Minimum ITCM", "itcm"),
+        ("Minimum DTCM", "dtcm"),
+    ]
+    lines = [
+        "# %s against %s" % (os.path.basename(variant["elf"]),
+                             os.path.basename(baseline["elf"])),
+        "",
+        "| | Baseline | Variant | Change |",
+        "| :- | -------: | ------: | -----: |",
+    ]
+    for title, key in rows:
+        old, new = baseline[key], variant[key]
+        if old is None or new is None:
+            change = "-"
+        elif old:
+            change = "%+.1f%%" % (100.0 * (new - old) / old)
+        else:
+            change = "%+d" % new
+        lines.append("| %s | %s | %s | %s |" %
+                     (title, "FAILED" if old is None else old,
+                      "FAILED" if new is None else new, change))
+    with open(path, "w") as f:
+        f.write("\n".join(lines) + "\n")
+    with open(os.path.splitext(path)[0] + ".json", "w") as f:
+        json.dump({"baseline": baseline, "variant": variant}, f, indent=2)
+        f.write("\n")
+    print("\n".join(lines))
+
+
+def main():
+    args = parser.parse_args()
+    rootdir = simulation.root_dir(parser)
+    for elf in (args.baseline, args.variant):
+        if not os.path.isfile(elf + ".map"):
+            sys.exit("%s.map not found, the executable is linked with it" %
+                     elf)
+    baseline = measure(args, rootdir, args.baseline)
+    variant = measure(args, rootdir, args.variant)
+    output = args.output or args.variant + "_layout_compare.md"
+    write_report(output, baseline, variant)
+    if baseline["cycles"] is None or variant["cycles"] is None:
+        sys.exit("simulation failed")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+# Copyright 2022 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Run the operator microbenchmarks and tabulate RVV against scalar.
+
+Every `<kernel>_<type>_<size>` of samples/microbench is built as an `_rvv` and
+a `_scalar` executable. Both are run in Renode through test_runner.py (which
+uses the Renode server when RENODE_SERVER is set), and the table reports the
+inference cycles of each, the arithmetic ops per cycle and the vector speedup.
+Integer kernels must produce the same output checksum with and without RVV;
+float kernels may differ in rounding, so theirs is not compared.
+
+Example:
+  ROOTDIR=$(pwd) ./build_tools/microbench_report.py \\
+    --renode-path build/renode/renode --filter matmul
+"""
+import argparse
+import concurrent.futures
+import json
+import os
+import re
+import sys
+
+import simulation
+
+
+parser = argparse.ArgumentParser(
+    description="Tabulate the springbok operator microbenchmarks.")
+parser.add_argument("--renode-path", required=True,
+                    help="Path to renode simulator")
+parser.add_argument("--build-dir",
+                    help="RISC-V build directory (default: build/build-riscv)")
+parser.add_argument("--filter", default="",
+                    help="Only run the benchmarks matching this regex")
+parser.add_argument("--jobs", type=int, default=1,
+                    help="Simulations to run in parallel (default: 1)")
+parser.add_argument("--output",
+                    help="Markdown table (default: "
+                    "<build-dir>/microbench_report.md), written along with "
+                    "a .json of the same name")
+parser.add_argument("--timeout", type=int, default=3000,
+                    help="Timeout of each simulation (default: 3000)")
+
+BENCHMARK = re.compile(r"^(.+)_(i8|i32|f32)_([0-9x]+)_(rvv|scalar)$")
+VARIANTS = ("rvv", "scalar")
+
+
+def find_benchmarks(bench_dir, pattern):
+    """Return {(kernel, type, size): {variant: elf}} of the built ELFs."""
+    benchmarks = {}
+    for name in sorted(os.listdir(bench_dir)):
+        match = BENCHMARK.match(name)
+        path = os.path.join(bench_dir, name)
+        if not match or not os.path.isfile(path) or \
+                not re.search(pattern, name):
+            continue
+        kernel, element_type, size, variant = match.groups()
+        benchmarks.setdefault((kernel, element_type, size), {})[variant] = path
+    return benchmarks
+
+
+def simulate(args, rootdir, elf):
+    """Run the executable and return its cycles, ops and checksum."""
+    log = simulation.run(args, rootdir, elf)
+    cycles = simulation.inference_cycles(log)
+    ops = re.search(r"Microbench ops: (\d+)", log or "")
+    if cycles is None or not ops:
+        return None
+    checksum = re.search(r"Output checksum: (0x[0-9a-f]+)", log)
+    return {"cycles": cycles, "ops": int(ops.group(1)),
+            "checksum": checksum.group(1) if checksum else None}
+
+
+def summarize(key, results):
+    kernel, element_type, size = key
+    row = {"kernel": kernel, "type": element_type, "size": size}
+    for variant in VARIANTS:
+        result = results.get(variant)
+        row[variant] = result
+        if result:
+            row["ops"] = result["ops"]
+    rvv, scalar = results.get("rvv"), results.get("scalar")
+    row["speedup"] = (scalar["cycles"] / rvv["cycles"]
+                      if rvv and scalar else None)
+    if element_type == "f32" or not rvv or not scalar:
+        row["outputs_match"] = None
+    else:
+        row["outputs_match"] = rvv["checksum"] == scalar["checksum"]
+    return row
+
+
+def write_report(path, rows):
+    def cycles(result):
+        return str(result["cycles"]) if result else "FAILED"
+
+    def ops_per_cycle(result):
+        return ("%.3f" % (result["ops"] / result["cycles"])
+                if result else "-")
+
+    lines = [
+        "# Springbok operator microbenchmarks",
+        "",
+        "| Kernel | Type | Size | RVV cycles | Scalar cycles | RVV ops/cycle "
+        "| Scalar ops/cycle | Speedup | Outputs |",
+        "| :----- | :--- | :--- | ---------: | ------------: | ------------: "
+        "| ---------------: | ------: | :------ |",
+    ]
+    for row in rows:
+        speedup = "%.2fx" % row["speedup"] if row["speedup"] else "-"
+        match = {True: "match", False: "MISMATCH", None: "-"}[
+            row["outputs_match"]]
+        lines.append("| %s | %s | %s | %s | %s | %s | %s | %s | %s |" %
+                     (row["kernel"], row["type"], row["size"],
+                      cycles(row["rvv"]), cycles(row["scalar"]),
+                      ops_per_cycle(row["rvv"]),
+                      ops_per_cycle(row["scalar"]), speedup, match))
+    with open(path, "w") as f:
+        f.write("\n".join(lines) + "\n")
+    with open(os.path.splitext(path)[0] + ".json", "w") as f:
+        json.dump(rows, f, indent=2)
+        f.write("\n")
+    print("\n".join(lines))
+
+
+def main():
+    args = parser.parse_args()
+    if args.jobs < 1:
+        parser.error("--jobs must be positive")
+    rootdir = simulation.root_dir(parser)
+    build_dir = os.path.realpath(args.build_dir or os.path.join(
+        rootdir, "build", "build-riscv"))
+    bench_dir = os.path.join(build_dir, "samples", "microbench")
+    if not os.path.isdir(bench_dir):
+        sys.exit("%s not found, build the microbench samples first" %
+                 bench_dir)
+    benchmarks = find_benchmarks(bench_dir, args.filter)
+    if not benchmarks:
+        sys.exit("no microbenchmark matches '%s'" % args.filter)
+
+    runs = [(key, variant, elf) for key, elfs in sorted(benchmarks.items())
+            for variant, elf in sorted(elfs.items())]
+    results = {key: {} for key in benchmarks}
+    with concurrent.futures.ThreadPoolExecutor(args.jobs) as executor:
+        futures = {executor.submit(simulate, args, rootdir, elf):
+                   (key, variant, elf) for key, variant, elf in runs}
+        for future in concurrent.futures.as_completed(futures):
+            key, variant, elf = futures[future]
+            results[key][variant] = future.result()
+            print("%s: %s" % (os.path.basename(elf),
+                              "done" if results[key][variant] else "FAILED"),
+                  flush=True)
+
+    rows = [summarize(key, results[key]) for key in sorted(results)]
+    output = args.output or os.path.join(build_dir, "microbench_report.md")
+    write_report(output, rows)
+    if any(row["outputs_match"] is False for row in rows):
+        sys.exit("RVV and scalar outputs differ")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+# Copyright 2022 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Tabulate how a model scales across the harts of the multi-hart platform.
+
+The `<prefix>_<N>hart` executables (mobilenet_v1_bytecode_static_1hart, _2hart
+and _4hart in quant_model) are run in Renode with the test runner's
+--multihart option. The table reports the inference cycles of each, the
+cycles spent in parallel dispatches, the harts the executor used, and the
+speedup and parallel efficiency against the 1-hart build.
+
+Example:
+  ROOTDIR=$(pwd) ./build_tools/multihart_scaling.py \\
+    --renode-path build/renode/renode \\
+    build/build-riscv/samples/quant_model/mobilenet_v1_bytecode_static
+"""
+import argparse
+import json
+import os
+import re
+import sys
+
+import simulation
+
+
+parser = argparse.ArgumentParser(
+    description="Tabulate the multi-hart scaling of a springbok model.")
+parser.add_argument("prefix",
+                    help="Executable path without its _<N>hart suffix")
+parser.add_argument("--renode-path", required=True,
+                    help="Path to renode simulator")
+parser.add_argument("--harts", default="1,2,4",
+                    help="Hart counts to run, 1 first (default: 1,2,4)")
+parser.add_argument("--output",
+                    help="Markdown table (default: "
+                    "<prefix>_multihart_scaling.md), written along with a "
+                    ".json of the same name")
+parser.add_argument("--timeout", type=int, default=3000,
+                    help="Timeout of each simulation (default: 3000)")
+
+
+def measure(args, rootdir, elf):
+    """Run the executable and return its cycles and harts, or None."""
+    log = simulation.run(args, rootdir, elf, ["--multihart"])
+    cycles = simulation.inference_cycles(log)
+    harts = re.search(r"multihart: (\d+) harts, (\d+) parallel", log or "")
+    dispatch = re.search(r"multihart: (\d+) cycles in parallel dispatches",
+                         log or "")
+    if cycles is None or not harts:
+        return None
+    return {"cycles": cycles, "harts": int(harts.group(1)),
+            "parallel_dispatches": int(harts.group(2)),
+            "dispatch_cycles": int(dispatch.group(1)) if dispatch else None}
+
+
+def write_report(path, prefix, results):
+    base = results[0][1]
+    lines = [
+        "# Multi-hart scaling of %s" % os.path.basename(prefix),
+        "",
+        "| Harts | Used | Inference cycles | Parallel dispatch cycles "
+        "| Speedup | Efficiency |",
+        "| ----: | ---: | ---------------: | -----------------------: "
+        "| ------: | ---------: |",
+    ]
+    for harts, result in results:
+        if result is None:
+            lines.append("| %d | - | FAILED | - | - | - |" % harts)
+            continue
+        if base:
+            speedup = base["cycles"] / result["cycles"]
+            scaling = ("%.2fx" % speedup,
+                       "%.0f%%" % (100.0 * speedup / result["harts"]))
+        else:
+            scaling = ("-", "-")
+        lines.append("| %d | %d | %d | %s | %s | %s |" %
+                     ((harts, result["harts"], result["cycles"],
+                       result["dispatch_cycles"]) + scaling))
+    with open(path, "w") as f:
+        f.write("\n".join(lines) + "\n")
+    with open(os.path.splitext(path)[0] + ".json", "w") as f:
+        json.dump({str(harts): result for harts, result in results}, f,
+                  indent=2)
+        f.write("\n")
+    print("\n".join(lines))
+
+
+def main():
+    args = parser.parse_args()
+    rootdir = simulation.root_dir(parser)
+    hart_counts = [int(harts) for harts in args.harts.split(",")]
+    results = []
+    for harts in hart_counts:
+        elf = "%s_%dhart" % (args.prefix, harts)
+        if not os.path.isfile(elf):
+            sys.exit("%s not found, build the multi-hart samples first" % elf)
+        results.append((harts, measure(args, rootdir, elf)))
+    output = args.output or args.prefix + "_multihart_scaling.md"
+    write_report(output, args.prefix, results)
+    if any(result is None for _, result in results):
+        sys.exit("simulation failed")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+# Copyright 2022 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Profile a Renode PCAndOpcode execution trace against its ELF.
+
+The trace is read as a stream (a file or a FIFO Renode writes into), so it
+never has to fit in memory or on disk. Calls and returns are decoded from the
+opcodes to keep a shadow call stack, and every `--period` instructions the
+stack is sampled. The samples are symbolized against the ELF symbol table and
+written as:
+
+  <prefix>.folded    folded stacks, the input of flamegraph.pl
+  <prefix>_flat.txt  flat profile by function, plus a breakdown by category
+"""
+import argparse
+import bisect
+import collections
+import re
+import sys
+
+import elf32
+
+
+parser = argparse.ArgumentParser(
+    description="Profile a Renode execution trace.")
+parser.add_argument("elf", help="Executable the trace was recorded from")
+parser.add_argument("trace", help="PCAndOpcode trace file or FIFO")
+parser.add_argument("--output", required=True,
+                    help="Output prefix of the profile files")
+parser.add_argument("--period", type=int, default=100,
+                    help="Instructions between samples (default: 100)")
+
+TRACE_LINE = re.compile(r"0x([0-9A-Fa-f]+)\s*:\s*0x([0-9A-Fa-f]+)")
+
+OPCODE_JAL = 0x6f
+OPCODE_JALR = 0x67
+REG_RA = 1
+REG_T0 = 5
+
+# Ordered breakdown of where the time goes, by symbol name.
+CATEGORIES = [
+    ("generated kernels", re.compile(r"_dispatch_\d+")),
+    ("vmvx microkernels", re.compile(r"^iree_uk_|^vmvx_")),
+    ("IREE VM", re.compile(r"^iree_vm_")),
+    ("IREE HAL", re.compile(r"^iree_hal_")),
+    ("IREE runtime (other)", re.compile(r"^iree_|^flatcc_")),
+    ("libc", re.compile(
+        r"^_?(mem|str|_?malloc|_?free|calloc|realloc|printf|_?v?s?n?printf|"
+        r"_?v?fprintf|__s|_fflush|_svfprintf|_dtoa|__call_exitprocs|"
+        r"__libc_)")),
+    ("springbok BSP", re.compile(r"^springbok_|^_start$|^print_csrs$")),
+]
+
+
+def read_symbols(elf_path):
+    """Return the sorted (address, size, name) function symbols of an ELF32."""
+    return sorted((symbol.value, symbol.size, symbol.name)
+                  for symbol in elf32.Elf32(elf_path).all_symbols()
+                  if symbol.type == elf32.STT_FUNC and symbol.shndx != 0)
+
+
+class Symbolizer:
+    """Map addresses to function names."""
+
+    def __init__(self, symbols):
+        self.symbols = symbols
+        self.starts = [s[0] for s in symbols]
+        self.cache = {}
+
+    def __call__(self, pc):
+        name = self.cache.get(pc)
+        if name is None:
+            i = bisect.bisect_right(self.starts, pc) - 1
+            if i >= 0 and (pc < self.starts[i] + max(self.symbols[i][1], 1) or
+                           self.symbols[i][1] == 0):
+                name = self.symbols[i][2]
+            else:
+                name = "0x%08x" % pc
+            self.cache[pc] = name
+        return name
+
+
+def classify(name):
+    for category, pattern in CATEGORIES:
+        if pattern.search(name):
+            return category
+    return "other"
+
+
+def profile(trace, symbolize, period):
+    """Return the sampled stacks of the trace, as a Counter of name tuples."""
+    stacks = collections.Counter()
+    stack = []
+    pending = None  # Control transfer of the previous instruction.
+    countdown = period
+    for line in trace:
+        match = TRACE_LINE.search(line)
+        if not match:
+            continue
+        pc = int(match.group(1), 16)
+        opcode = int(match.group(2), 16)
+        function = symbolize(pc)
+
+        if pending == "call":
+            stack.append(function)
+        elif pending == "return":
+            if stack:
+                stack.pop()
+        elif pending == "jump" and stack and function != stack[-1]:
+            # A jump into another function is a tail call.
+            stack[-1] = function
+        pending = None
+        if not stack:
+            stack.append(function)
+
+        countdown -= 1
+        if countdown == 0:
+            countdown = period
+            frames = stack[:-1] + [function]
+            stacks[tuple(frames)] += 1
+
+        kind = opcode & 0x7f
+        if kind in (OPCODE_JAL, OPCODE_JALR):
+            rd = (opcode >> 7) & 0x1f
+            rs1 = (opcode >> 15) & 0x1f
+            if rd in (REG_RA, REG_T0):
+                pending = "call"
+            elif kind == OPCODE_JALR and rs1 == REG_RA:
+                pending = "return"
+            else:
+                pending = "jump"
+    return stacks
+
+
+def write_profile(prefix, stacks, period):
+    with open(prefix + ".folded", "w") as f:
+        for frames, count in sorted(stacks.items()):
+            f.write("%s %d\n" % (";".join(frames), count * period))
+
+    total = sum(stacks.values())
+    self_count = collections.Counter()
+    inclusive_count = collections.Counter()
+    category_count = collections.Counter()
+    for frames, count in stacks.items():
+        self_count[frames[-1]] += count
+        category_count[classify(frames[-1])] += count
+        for name in set(frames):
+            inclusive_count[name] += count
+
+    lines = ["Samples: %d (one every %d instructions)" % (total, period), "",
+             "%8s %8s  %s" % ("self %", "total %", "function")]
+    for name, count in self_count.most_common():
+        lines.append("%7.2f%% %7.2f%%  %s" %
+                     (100.0 * count / total,
+                      100.0 * inclusive_count[name] / total, name))
+    lines += ["", "%8s  %s" % ("self %", "category")]
+    for category, count in category_count.most_common():
+        lines.append("%7.2f%%  %s" % (100.0 * count / total, category))
+    with open(prefix + "_flat.txt", "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+def main():
+    args = parser.parse_args()
+    if args.period < 1:
+        parser.error("--period must be positive")
+    symbolize = Symbolizer(read_symbols(args.elf))
+    with open(args.trace, "r", errors="replace") as trace:
+        stacks = profile(trace, symbolize, args.period)
+    if not stacks:
+        sys.exit("no samples in %s" % args.trace)
+    write_profile(args.output, stacks, args.period)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,245 @@
+#!/usr/bin/env python3
+# Copyright 2022 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Keep a pool of Renode instances alive and run ELFs on them.
+
+Every Renode run of test_runner.py pays several seconds of Mono startup before
+the first instruction. The server listens on a Unix socket and keeps up to
+`--jobs` instances with springbok.resc loaded. Each request resets the machine
+of an idle instance, loads the ELF through the `reset` macro of springbok.resc
+and runs it, so requests from parallel clients (such as the lit workers) are
+sharded across the pool. Instances are started on demand, with the ELF of the
+request that needs them.
+
+test_runner.py uses the server when given `--server <socket>` or the
+RENODE_SERVER environment variable.
+
+Example:
+  ROOTDIR=$(pwd) ./build_tools/renode_server.py \\
+    --renode-path build/renode/renode --socket /tmp/renode.sock &
+  RENODE_SERVER=/tmp/renode.sock lit -j $(nproc) -a samples
+"""
+import argparse
+import io
+import json
+import os
+import queue
+import socketserver
+import tempfile
+import threading
+
+import pexpect
+
+
+parser = argparse.ArgumentParser(
+    description="Serve springbok test runs from a pool of Renode instances.")
+parser.add_argument("--renode-path", required=True,
+                    help="Path to renode simulator")
+parser.add_argument("--socket", required=True,
+                    help="Path of the Unix socket to listen on")
+parser.add_argument("--jobs", type=int, default=os.cpu_count(),
+                    help="Number of Renode instances (default: CPU count)")
+parser.add_argument("--quick_test",
+                    help="allow quickest test time", action="store_true")
+
+TERMINATION_STRINGS = [
+    "main returned",
+    "Exception occurred",
+    "ReadByte from non existing peripheral",
+]
+PROMPT = r"\(springbok\)"
+STARTUP_TIMEOUT = 120
+
+
+class RenodeInstance:
+    """ A Renode process with the springbok machine created. """
+    def __init__(self, renode_path, rootdir, quick_test, elf):
+        # springbok.resc loads $bin, so the first ELF is loaded at startup.
+        script = """
+$bin=@%s
+path set @%s
+include @sim/config/springbok.resc""" % (os.path.realpath(elf), rootdir)
+        if quick_test:
+            script += """
+sysbus.cpu2 PerformanceInMips 2000
+emulation SetGlobalQuantum "1" """
+        file_desc, self.script_path = tempfile.mkstemp(suffix=".resc")
+        with os.fdopen(file_desc, "w") as tmp:
+            tmp.write(script)
+        self.child = None
+        try:
+            self.child = pexpect.spawn(
+                " ".join([renode_path, "--disable-xwt", "--console",
+                          "--plain", self.script_path]),
+                encoding="utf-8")
+            self.child.expect(PROMPT, timeout=STARTUP_TIMEOUT)
+        except (pexpect.exceptions.ExceptionPexpect, OSError):
+            if self.child:
+                self.child.close(force=True)
+            os.remove(self.script_path)
+            raise
+        self.drain()
+        self.loaded = True
+
+    def drain(self):
+        """ Read whatever the monitor printed so far. """
+        try:
+            while True:
+                self.child.read_nonblocking(65536, timeout=0.5)
+        except pexpect.exceptions.TIMEOUT:
+            pass
+
+    def run(self, elf, timeout):
+        """ Run the ELF from a reset machine and return its log.
+
+        Raises pexpect's TIMEOUT or EOF, with the log so far in `log`, when
+        the run does not finish.
+        """
+        buffer = io.StringIO()
+        self.child.logfile_read = buffer
+        commands = ["start", "sysbus.vec_controlblock WriteDoubleWord 0xc 0"]
+        if not self.loaded:
+            commands = ["pause",
+                        "machine Reset",
+                        "$bin=@%s" % os.path.realpath(elf),
+                        "runMacro $reset"] + commands
+        self.loaded = False
+        try:
+            for command in commands:
+                self.child.sendline(command)
+            self.child.expect(TERMINATION_STRINGS, timeout=timeout)
+            # Finish the line, which holds the return code.
+            self.child.expect("\n", timeout=timeout)
+            self.child.sendline("pause")
+            self.drain()
+        except (pexpect.exceptions.TIMEOUT, pexpect.exceptions.EOF) as exc:
+            exc.log = buffer.getvalue()
+            raise
+        finally:
+            self.child.logfile_read = None
+        return buffer.getvalue()
+
+    def close(self):
+        try:
+            self.child.sendline("q")
+            self.child.expect(pexpect.EOF, timeout=10)
+        except (pexpect.exceptions.TIMEOUT, pexpect.exceptions.EOF):
+            pass
+        self.child.close(force=True)
+        os.remove(self.script_path)
+
+
+class Pool:
+    """ The Renode instances, started on demand up to --jobs. """
+    def __init__(self, args, rootdir):
+        self.args = args
+        self.rootdir = rootdir
+        self.idle = queue.Queue()
+        self.instances = []
+        self.lock = threading.Lock()
+
+    def acquire(self, elf):
+        while True:
+            with self.lock:
+                try:
+                    return self.idle.get_nowait()
+                except queue.Empty:
+                    if len(self.instances) < self.args.jobs:
+                        # Reserve the slot of the new instance.
+                        self.instances.append(None)
+                        break
+            # Poll, since a failed instance frees its slot instead of
+            # returning to the idle queue.
+            try:
+                return self.idle.get(timeout=1)
+            except queue.Empty:
+                pass
+        instance = None
+        try:
+            instance = RenodeInstance(self.args.renode_path, self.rootdir,
+                                      self.args.quick_test, elf)
+        finally:
+            with self.lock:
+                self.instances.remove(None)
+                if instance:
+                    self.instances.append(instance)
+        return instance
+
+    def run(self, request):
+        try:
+            instance = self.acquire(request["elf"])
+        except (pexpect.exceptions.ExceptionPexpect, OSError) as exc:
+            # acquire freed the slot, the next request tries a new instance.
+            reason = str(exc).splitlines()[0] if str(exc) else \
+                type(exc).__name__
+            return {"output": "", "error": "renode did not start: %s" % reason}
+        try:
+            response = {"output": instance.run(request["elf"],
+                                               request.get("timeout", 1000))}
+        except (pexpect.exceptions.TIMEOUT, pexpect.exceptions.EOF) as exc:
+            response = {"output": exc.log, "error":
+                        "timeout" if isinstance(exc, pexpect.exceptions.TIMEOUT)
+                        else "renode exited"}
+            # The instance is in an unknown state, the next request that
+            # needs one starts a new instance.
+            with self.lock:
+                self.instances.remove(instance)
+            instance.close()
+            return response
+        self.idle.put(instance)
+        return response
+
+    def close(self):
+        for instance in self.instances:
+            if instance:
+                instance.close()
+
+
+class RequestHandler(socketserver.StreamRequestHandler):
+    """ One JSON request per connection, answered with one JSON response. """
+    def handle(self):
+        request = json.loads(self.rfile.readline())
+        response = self.server.pool.run(request)
+        self.wfile.write((json.dumps(response) + "\n").encode())
+
+
+def main():
+    args = parser.parse_args()
+    rootdir = os.environ.get("ROOTDIR")
+    if rootdir is None:
+        parser.error("ROOTDIR environment variable not set.")
+    if args.jobs < 1:
+        parser.error("--jobs must be positive")
+    if os.path.exists(args.socket):
+        os.remove(args.socket)
+
+    pool = Pool(args, os.path.realpath(rootdir))
+    print("Serving up to %d Renode instances on %s" % (args.jobs, args.socket),
+          flush=True)
+    server = socketserver.ThreadingUnixStreamServer(args.socket,
+                                                    RequestHandler)
+    server.pool = pool
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        server.server_close()
+        pool.close()
+        os.remove(args.socket)
+
+
+if __name__ == "__main__":
+    main()
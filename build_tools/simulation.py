@@ -0,0 +1,57 @@
+# Copyright 2022 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Renode runs shared by the benchmarking scripts.
+
+The scripts take --renode-path and --timeout and run their executables through
+test_runner.py, which uses the Renode server when RENODE_SERVER is set.
+"""
+import os
+import re
+import subprocess
+import sys
+
+
+def root_dir(parser):
+    """Return the ROOTDIR of the repository, or exit through `parser`."""
+    rootdir = os.environ.get("ROOTDIR")
+    if rootdir is None:
+        parser.error("ROOTDIR environment variable not set.")
+    return os.path.realpath(rootdir)
+
+
+def run(args, rootdir, elf, runner_args=()):
+    """Run the executable and return its log, or None if it failed.
+
+    `runner_args` are extra test_runner.py options, such as --multihart.
+    """
+    cmd = [sys.executable, os.path.join(rootdir, "build_tools",
+                                        "test_runner.py"),
+           elf, "--renode-path", args.renode_path,
+           "--timeout", str(args.timeout)] + list(runner_args)
+    result = subprocess.run(cmd, stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT, encoding="utf-8",
+                            errors="replace", check=False)
+    return result.stdout if result.returncode == 0 else None
+
+
+def inference_cycles(log):
+    """Return the inference cycles the log reports, or None."""
+    cycles = re.search(r"Inference cycles: (\d+)", log or "")
+    return int(cycles.group(1)) if cycles else None
+
+
+def simulate(args, rootdir, elf):
+    """Run the executable and return its inference cycles, or None."""
+    return inference_cycles(run(args, rootdir, elf))
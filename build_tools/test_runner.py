@@ -15,8 +15,12 @@
 
 """Runs test within Renode simulator."""
 import argparse
+import json
 import os
 import re
+import shutil
+import socket
+import subprocess
 import sys
 import tempfile
 
@@ -37,6 +41,43 @@ parser.add_argument("--timeout", type=int,
                     help="Timeout for test", default=1000)
 parser.add_argument("--quick_test",
                     help="allow quickest test time", action="store_true")
+parser.add_argument("--profile-output",
+                    help="Output prefix of the flat profile and folded stacks")
+parser.add_argument("--profile-period", type=int, default=100,
+                    help="Instructions between profile samples (default: 100)")
+parser.add_argument("--multihart",
+                    help="run on the multi-hart platform", action="store_true")
+parser.add_argument("--json-output",
+                    help="Path to the JSON report of the run, with the opcode "
+                    "mix, the vector length utilization, the energy "
+                    "estimate and the memory traffic")
+parser.add_argument("--energy", action="store_true",
+                    help="Enable the energy model of the simulator, so the "
+                    "executable logs its inference energy (implied by "
+                    "--json-output)")
+parser.add_argument("--energy-costs",
+                    help="Renode script setting the per-event costs of the "
+                    "energy model, e.g. `sysbus.cpu2 ScalarOpEnergy 3.5`")
+parser.add_argument("--memory-traffic", action="store_true",
+                    help="Enable the memory traffic counters of the "
+                    "simulator, so the executable logs its inference bytes "
+                    "by TCM and access type (implied by --json-output)")
+parser.add_argument("--server", default=os.environ.get("RENODE_SERVER"),
+                    help="Socket of a renode_server.py to run the test on "
+                    "(default: $RENODE_SERVER). Runs with tracing, "
+                    "profiling, a JSON report, snapshots, a dataset, the "
+                    "energy model, the memory traffic counters or on the "
+                    "multi-hart platform still start their own Renode")
+parser.add_argument("--dataset",
+                    help="Directory of gen_dataset.py to serve to the "
+                    "executable, which then runs over all of its records")
+snapshot_group = parser.add_mutually_exclusive_group()
+snapshot_group.add_argument("--snapshot-save",
+                            help="Save a snapshot of the machine right "
+                            "before the first inference, then run on")
+snapshot_group.add_argument("--snapshot-load",
+                            help="Restore a snapshot of --snapshot-save and "
+                            "run only the inference from there")
 
 args = parser.parse_args()
 
@@ -46,18 +87,42 @@ class Simulation: # pylint: disable=too-few-public-methods
         self.simulator_cmd = simulator_cmd
         self.buffer = io.StringIO()
         self.child = None
+        self.answers = {}
+        self.prompt = r"\(springbok\)"
+        # (pattern, commands) pairs: when the log shows the pattern, the
+        # commands are sent to the monitor. Handled in order.
+        self.stops = []
         self.termination_strings = [
             "main returned",
             "Exception occurred",
             "ReadByte from non existing peripheral",
         ]
 
-    def run(self, timeout=1000):
-        """ Run the simulation command and quit the simulation."""
+    def run(self, timeout=1000, queries=()):
+        """ Run the simulation command and quit the simulation.
+
+        Each of `queries` is a (command, header) pair run in the monitor once
+        the test is done. Its answer, from the header regex to the next
+        prompt, is stored in self.answers.
+        """
         self.child = pexpect.spawn(self.simulator_cmd, encoding="utf-8")
         self.child.logfile = self.buffer
+        self.answers = {}
         try:
-            self.child.expect(self.termination_strings, timeout=timeout)
+            for pattern, commands in self.stops:
+                if self.child.expect([pattern] + self.termination_strings,
+                                     timeout=timeout) != 0:
+                    break
+                for command in commands:
+                    self.child.sendline(command)
+            else:
+                self.child.expect(self.termination_strings, timeout=timeout)
+            for command, header in queries:
+                self.child.sendline(command)
+                self.child.expect(header, timeout=timeout)
+                answer = self.child.after
+                self.child.expect(self.prompt, timeout=timeout)
+                self.answers[command] = answer + self.child.before
         except pexpect.exceptions.TIMEOUT:
             self.buffer.seek(0)
             message = ("Runner times out with the execution log: \n\n" +
@@ -78,10 +143,21 @@ class RenodeSimulation(Simulation): # pylint: disable=too-few-public-methods
         self.rootdir = os.environ.get("ROOTDIR", default=None)
         if self.rootdir is None:
             parser.error("ROOTDIR environment variable not set.")
-        renode_script = """
+        if args.snapshot_load:
+            # The snapshot holds the whole machine, only the CPU type of
+            # springbok.resc has to be there to restore it.
+            renode_script = """
+path set @%(rootdir)s
+EnsureTypeIsLoaded "Antmicro.Renode.Peripherals.CPU.RiscV32"
+include @sim/config/infrastructure/SpringbokRiscV32.cs
+Load @%(snapshot)s
+mach set "springbok"
+sysbus.cpu2 StopAtMarker 0"""
+        else:
+            renode_script = """
 $bin=@%(elf)s
 path set @%(rootdir)s
-include @sim/config/springbok.resc"""
+include @%(resc)s"""
 
         if args.quick_test:
             renode_script += """
@@ -92,13 +168,75 @@ emulation SetGlobalQuantum "1" """
             renode_script += """
 sysbus.cpu2 EnableExecutionTracing @%(trace_file)s PCAndOpcode """
 
+        # The profiler reads the trace from a FIFO as Renode writes it, so
+        # the trace never lands on disk.
+        self.profile_dir = None
+        self.profile_fifo = ""
+        if args.profile_output:
+            self.profile_dir = tempfile.mkdtemp()
+            self.profile_fifo = os.path.join(self.profile_dir, "trace")
+            renode_script += """
+sysbus.cpu2 EnableExecutionTracing @%(profile_fifo)s PCAndOpcode """
+
+        if args.json_output:
+            renode_script += """
+sysbus.cpu2 EnableVectorLengthStatistics"""
+
+        if args.json_output or args.energy or args.energy_costs:
+            renode_script += """
+sysbus.cpu2 EnableEnergyModel"""
+            if args.energy_costs:
+                renode_script += """
+include @%(energy_costs)s"""
+
+        if args.json_output or args.memory_traffic:
+            renode_script += """
+sysbus.cpu2 EnableMemoryTrafficCounters"""
+
+        if args.dataset:
+            renode_script += """
+sysbus.cpu2 HostFileRoot @%(dataset)s"""
+
+        if args.snapshot_save:
+            # Stop at the marker util.c places after the context and the
+            # inputs are set up (SPRINGBOK_MARKER_INFERENCE), save, and go on
+            # like a restored run would.
+            # Drop the previous snapshot, the run is then checked to have
+            # written a new one.
+            if os.path.exists(args.snapshot_save):
+                os.remove(args.snapshot_save)
+            renode_script += """
+sysbus.cpu2 StopAtMarker 1"""
+            self.stops.append(("halted for the host", [
+                "pause",
+                "Save @%s" % os.path.realpath(args.snapshot_save),
+                "sysbus.cpu2 StopAtMarker 0",
+                "start",
+                "sysbus.vec_controlblock WriteDoubleWord 0xc 0",
+            ]))
+
+        renode_script += """
+start"""
+        # Restored secondary harts are already running.
+        if args.multihart and not args.snapshot_load:
+            renode_script += """
+runMacro $start_secondaries"""
+
         renode_script += """
-start
 sysbus.vec_controlblock WriteDoubleWord 0xc 0"""
         self.script_params = {
             "elf": os.path.realpath(elf),
             "rootdir": self.rootdir,
-            "trace_file": os.path.realpath(args.trace_output) if args.trace_output else ""
+            "resc": ("sim/config/springbok_multihart.resc" if args.multihart
+                     else "sim/config/springbok.resc"),
+            "trace_file": os.path.realpath(args.trace_output) if args.trace_output else "",
+            "profile_fifo": self.profile_fifo,
+            "snapshot": (os.path.realpath(args.snapshot_load)
+                         if args.snapshot_load else ""),
+            "dataset": (os.path.realpath(args.dataset) if args.dataset
+                        else ""),
+            "energy_costs": (os.path.realpath(args.energy_costs)
+                             if args.energy_costs else ""),
         }
         self.renode_script = renode_script % self.script_params
         self.renode_args = [
@@ -110,18 +248,53 @@ sysbus.vec_controlblock WriteDoubleWord 0xc 0"""
         self.renode_simulator_cmd = " ".join(self.renode_args)
         super().__init__(self.renode_simulator_cmd)
 
-    def run(self, timeout=120):
+    def run(self, timeout=120, queries=()):
         file_desc, script_path = tempfile.mkstemp(suffix=".resc")
+        profiler = None
         try:
             with os.fdopen(file_desc, "w") as tmp:
                 tmp.write(self.renode_script)
                 tmp.flush()
+            if self.profile_dir:
+                os.mkfifo(self.profile_fifo)
+                profiler = subprocess.Popen([
+                    sys.executable,
+                    os.path.join(os.path.dirname(os.path.realpath(__file__)),
+                                 "profile_trace.py"),
+                    self.script_params["elf"], self.profile_fifo,
+                    "--output", os.path.realpath(args.profile_output),
+                    "--period", str(args.profile_period)])
             self.simulator_cmd += " %s" % script_path
-            test_output = super().run(timeout=timeout)
+            test_output = super().run(timeout=timeout, queries=queries)
+            if profiler:
+                # Renode closes the trace when it quits.
+                profiler.wait(timeout=timeout)
         finally:
             os.remove(script_path)
+            if profiler and profiler.poll() is None:
+                profiler.kill()
+            if self.profile_dir:
+                shutil.rmtree(self.profile_dir)
         return test_output
 
+def run_on_server(server, elf, timeout):
+    """ Run the test on a renode_server.py and return its log. """
+    request = {"elf": os.path.realpath(elf), "timeout": timeout}
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+        sock.connect(server)
+        sock.sendall((json.dumps(request) + "\n").encode())
+        with sock.makefile("r", encoding="utf-8") as reply:
+            response = json.loads(reply.readline())
+    if "error" in response:
+        message = ("Runner %s with the execution log: \n\n" %
+                   ("times out" if response["error"] == "timeout"
+                    else "fails (%s)" % response["error"]) +
+                   cleanup_message(response["output"]))
+        exc = pexpect.exceptions.TIMEOUT(message)
+        exc.__cause__ = None
+        raise exc
+    return response["output"]
+
 Simulators = {
     "renode": RenodeSimulation,
 }
@@ -136,6 +309,154 @@ def cleanup_message(message: str) -> str:
     output = ansi_escape.sub("", message)
     return output
 
+# Queries of the opcode counters enabled by springbok.resc and of the vector
+# length statistics of SpringbokRiscV32.cs.
+OPCODES_QUERY = ("sysbus.cpu2 GetAllOpcodesCounters", r"Opcode\s*\|\s*Count")
+VECTOR_LENGTH_QUERY = ("sysbus.cpu2 VectorLengthStatistics",
+                       r"vector length statistics:")
+ENERGY_QUERY = ("sysbus.cpu2 EnergyStatistics", r"energy statistics:")
+MEMORY_TRAFFIC_QUERY = ("sysbus.cpu2 MemoryTrafficStatistics",
+                        r"memory traffic statistics:")
+
+VECTOR_LOAD = re.compile(r"^vl(s?e\d|[ou]xei|\d+re|m\.|s?seg|[ou]xseg)")
+VECTOR_STORE = re.compile(r"^vs(s?e\d|[ou]xei|\d+r\.|m\.|s?seg|[ou]xseg)")
+VECTOR_CONFIG = re.compile(r"^vseti?vli?$")
+
+
+def parse_opcode_counters(answer):
+    """ Parse the table of GetAllOpcodesCounters into {opcode: count}. """
+    counters = {}
+    row = re.compile(r"^\|?\s*([a-z][\w.]*)\s*\|\s*(\d+)\s*\|?\s*$")
+    for line in cleanup_message(answer).splitlines():
+        match = row.match(line.strip())
+        if match and int(match.group(2)):
+            counters[match.group(1)] = int(match.group(2))
+    return counters
+
+
+def opcode_mix(counters):
+    """ Split the opcode histogram into scalar and vector classes. """
+    mix = {"scalar": 0, "vector": 0, "vector_load": 0, "vector_store": 0,
+           "vector_config": 0, "vector_arithmetic": 0}
+    for opcode, count in counters.items():
+        # The scalar RV32IMF opcodes never start with a "v".
+        if not opcode.startswith("v"):
+            mix["scalar"] += count
+            continue
+        mix["vector"] += count
+        if VECTOR_LOAD.match(opcode):
+            mix["vector_load"] += count
+        elif VECTOR_STORE.match(opcode):
+            mix["vector_store"] += count
+        elif VECTOR_CONFIG.match(opcode):
+            mix["vector_config"] += count
+        else:
+            mix["vector_arithmetic"] += count
+    total = mix["scalar"] + mix["vector"]
+    mix["vector_fraction"] = mix["vector"] / total if total else 0.0
+    memory = mix["vector_load"] + mix["vector_store"]
+    mix["vector_memory_per_arithmetic"] = (
+        memory / mix["vector_arithmetic"] if mix["vector_arithmetic"] else None)
+    return mix
+
+
+def vector_length(answer):
+    """ Turn the VectorLengthStatistics answer into averages over the vector
+    instructions, VLMAX following the vtype of each. """
+    match = re.search(r"instructions (\d+), vl sum (\d+), vlmax sum (\d+), "
+                      r"vsetvl (\d+)", answer)
+    if not match:
+        return None
+    instructions, vl_sum, vlmax_sum, vsetvl = (int(x) for x in match.groups())
+    return {
+        "vlen": 512,
+        "instructions": instructions,
+        "vsetvl": vsetvl,
+        "average_vl": vl_sum / instructions if instructions else 0.0,
+        "average_vlmax": vlmax_sum / instructions if instructions else 0.0,
+        "utilization": vl_sum / vlmax_sum if vlmax_sum else 0.0,
+    }
+
+
+def energy(answer):
+    """ Turn the EnergyStatistics answer into the event counts and the energy
+    of each component of the whole run, in microjoules. """
+    fields = dict(re.findall(r"(\w+)=([0-9.]+)", answer))
+    if "total_pj" not in fields:
+        return None
+    report = {"total_uj": float(fields["total_pj"]) / 1e6,
+              "components_uj": {}, "events": {}}
+    for key, value in fields.items():
+        if key.endswith("_pj") and key != "total_pj":
+            report["components_uj"][key[:-3]] = float(value) / 1e6
+        elif not key.endswith("_pj"):
+            report["events"][key] = int(value)
+    return report
+
+
+def memory_traffic(answer):
+    """ Turn the MemoryTrafficStatistics answer into the bytes of the whole
+    run by TCM, direction and access type. """
+    fields = re.findall(r"(itcm|dtcm)_(load|store)_(\w+?)=(\d+)", answer)
+    if not fields:
+        return None
+    report = {}
+    for region, direction, kind, value in fields:
+        report.setdefault(region, {}).setdefault(direction, {})[kind] = \
+            int(value)
+    return report
+
+
+def write_report(path, output, return_code, answers):
+    """ Write the JSON report of the run. """
+    report = {"elf": os.path.realpath(args.elf), "return_code": return_code}
+    for key, pattern in (("inference_cycles", r"Inference cycles: (\d+)"),
+                         ("inference_instructions",
+                          r"Inference instructions: (\d+)")):
+        match = re.search(pattern, output)
+        if match:
+            report[key] = int(match.group(1))
+    counters = parse_opcode_counters(answers.get(OPCODES_QUERY[0], ""))
+    report["opcode_mix"] = opcode_mix(counters)
+    report["vector_length"] = vector_length(
+        answers.get(VECTOR_LENGTH_QUERY[0], ""))
+    report["energy"] = energy(answers.get(ENERGY_QUERY[0], ""))
+    report["memory_traffic"] = memory_traffic(
+        answers.get(MEMORY_TRAFFIC_QUERY[0], ""))
+    match = re.search(r"Inference memory bandwidth: (\d+\.\d+) bytes/cycle",
+                      output)
+    if match:
+        report["inference_bytes_per_cycle"] = float(match.group(1))
+    match = re.search(r"Inference energy: (\d+)\.(\d+) nJ", output)
+    if match:
+        report["inference_energy_nj"] = float(match.group(1) + "." +
+                                              match.group(2))
+    report["opcodes"] = dict(sorted(counters.items(),
+                                    key=lambda item: -item[1]))
+    with open(path, "w") as f:
+        json.dump(report, f, indent=2)
+        f.write("\n")
+
+    mix = report["opcode_mix"]
+    print("Vector instructions: %.1f%% (%d loads, %d stores, %d arithmetic)" %
+          (100.0 * mix["vector_fraction"], mix["vector_load"],
+           mix["vector_store"], mix["vector_arithmetic"]))
+    if report["vector_length"]:
+        print("Average VL: %.1f of VLMAX %.1f" %
+              (report["vector_length"]["average_vl"],
+               report["vector_length"]["average_vlmax"]))
+    if report["energy"]:
+        print("Energy: %.3f uJ for the whole run" %
+              report["energy"]["total_uj"])
+    if report["memory_traffic"]:
+        totals = {direction: sum(sum(region.get(direction, {}).values())
+                                 for region in
+                                 report["memory_traffic"].values())
+                  for direction in ("load", "store")}
+        print("Memory traffic: %d bytes loaded, %d bytes stored in the whole "
+              "run" % (totals["load"], totals["store"]))
+
+
 def main():
     """ Run a test and check for Pass or Fail """
     simulator_path = simulators_paths["renode"]
@@ -143,9 +464,18 @@ def main():
         parser.error(
             "Must provide path to Renode simulator")
 
-    simulator_class = Simulators["renode"]
-    simulator = simulator_class(simulator_path, args.elf)
-    output = simulator.run(timeout=args.timeout)
+    if args.server and not (args.trace_output or args.profile_output or
+                            args.json_output or args.multihart or
+                            args.snapshot_save or args.snapshot_load or
+                            args.dataset or args.energy or
+                            args.energy_costs or args.memory_traffic):
+        output = run_on_server(args.server, args.elf, args.timeout)
+    else:
+        simulator_class = Simulators["renode"]
+        simulator = simulator_class(simulator_path, args.elf)
+        queries = ((OPCODES_QUERY, VECTOR_LENGTH_QUERY, ENERGY_QUERY,
+                    MEMORY_TRAFFIC_QUERY) if args.json_output else ())
+        output = simulator.run(timeout=args.timeout, queries=queries)
     output = cleanup_message(output)
     print(output)
     failure_strings = [
@@ -155,11 +485,17 @@ def main():
     ]
     if any(x in output for x in failure_strings):
         sys.exit(1)
+    if args.snapshot_save and not os.path.exists(args.snapshot_save):
+        print("The run never reached the snapshot marker.")
+        sys.exit(1)
     # Grab the return code from the output string with regex
     # Syntax: "main returned: ", <code> (<hex_code>)
     return_string = re.compile(
         r"\"main returned:\s\",(?P<ret_code>\s[0-9]+\s*)")
     code = return_string.search(output)
+    if args.json_output:
+        write_report(args.json_output, output, int(code.group(1)),
+                     simulator.answers)
     sys.exit(int(code.group(1)))
 
 
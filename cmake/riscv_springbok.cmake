@@ -22,6 +22,9 @@ if(NOT DEFINED SPRINGBOK_LINKER_SCRIPT)
   message(FATAL_ERROR "Please specifiy SPRINGBOK_LINKER_SCRIPT path first")
 endif()
 
+# Footprint reports of all the executables, see build_tools/elf_footprint.py.
+add_custom_target(springbok_footprint)
+
 function(add_executable executable)
   cmake_parse_arguments(AE "ALIAS;IMPORTED" "" "" ${ARGN})
   if(AE_ALIAS OR AE_IMPORTED)
@@ -31,5 +34,20 @@ function(add_executable executable)
     target_link_libraries(${executable} PRIVATE springbok)
     target_link_options(${executable} PRIVATE "-T${SPRINGBOK_LINKER_SCRIPT}")
     target_link_options(${executable} PRIVATE "-nostartfiles")
+    # The map attributes every section to its archive for the footprint.
+    target_link_options(${executable} PRIVATE
+      "LINKER:-Map=$<TARGET_FILE:${executable}>.map")
+    add_custom_target(${executable}_footprint
+      COMMAND
+        ${CMAKE_SOURCE_DIR}/build_tools/elf_footprint.py
+        $<TARGET_FILE:${executable}>
+        --map $<TARGET_FILE:${executable}>.map
+        --output $<TARGET_FILE:${executable}>_footprint.json
+      DEPENDS
+        ${executable}
+        ${CMAKE_SOURCE_DIR}/build_tools/elf_footprint.py
+        ${CMAKE_SOURCE_DIR}/build_tools/elf32.py
+    )
+    add_dependencies(springbok_footprint ${executable}_footprint)
   endif()
 endfunction()
@@ -0,0 +1,104 @@
+# Copyright 2022 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+include(CMakeParseArguments)
+
+# springbok_model_header()
+#
+# CMake function to generate the MlModel descriptor header of a model from the
+# signature of its entry function. The header `<NAME>.h` holds the shapes and
+# byte sizes of the inputs and outputs, and the static input storage.
+#
+# Parameters:
+# NAME: Name of target.
+# SRC: MLIR input of iree-compile.
+# ENTRY: Entry function (default: the first public function).
+# MODEL_NAME: Model name reported at runtime (default: NAME).
+# DYNAMIC_DIM_MAX: Upper bounds of the dynamic input dimensions, in order of
+#     appearance in the signature. They size the static input storage.
+# DEPENDS: List of other targets and files required to generate the header.
+#
+# Examples:
+# springbok_model_header(
+#   NAME
+#     simple_float_mul_model
+#   SRC
+#     "simple_float_mul.mlir"
+# )
+#
+function(springbok_model_header)
+  cmake_parse_arguments(
+    _RULE
+    ""
+    "NAME;SRC;ENTRY;MODEL_NAME"
+    "DYNAMIC_DIM_MAX;DEPENDS"
+    ${ARGN}
+  )
+
+  iree_package_ns(_PACKAGE_NS)
+  iree_package_name(_PACKAGE_NAME)
+  iree_package_dir(_PACKAGE_DIR)
+
+  set(_LIB_NAME "${_PACKAGE_NAME}_${_RULE_NAME}")
+  set(_GEN_TARGET "${_LIB_NAME}_gen")
+  set(_H_FILE_NAME "${_RULE_NAME}.h")
+  string(TOUPPER "${_PACKAGE_NAME}_${_RULE_NAME}_H_" _GUARD)
+
+  set(_GEN_HEADER_SCRIPT "${CMAKE_SOURCE_DIR}/build_tools/gen_mlmodel_header.py")
+  string(REGEX REPLACE "_model$" "" _SYMBOL_NAME "${_RULE_NAME}")
+  set(_ARGS)
+  list(APPEND _ARGS "--i=${_RULE_SRC}")
+  list(APPEND _ARGS "--o=${_H_FILE_NAME}")
+  list(APPEND _ARGS "--n=${_SYMBOL_NAME}")
+  list(APPEND _ARGS "--g=${_GUARD}")
+  if(_RULE_ENTRY)
+    list(APPEND _ARGS "--e=${_RULE_ENTRY}")
+  endif()
+  if(_RULE_MODEL_NAME)
+    list(APPEND _ARGS "--m=${_RULE_MODEL_NAME}")
+  endif()
+  foreach(_DIM ${_RULE_DYNAMIC_DIM_MAX})
+    list(APPEND _ARGS "--d=${_DIM}")
+  endforeach()
+
+  add_custom_command(
+    OUTPUT
+      ${_H_FILE_NAME}
+    COMMAND
+      ${_GEN_HEADER_SCRIPT} ${_ARGS}
+    DEPENDS
+      ${_GEN_HEADER_SCRIPT}
+      ${_RULE_SRC}
+      ${_RULE_DEPENDS}
+  )
+
+  add_custom_target(
+    ${_GEN_TARGET}
+    DEPENDS
+      "${_H_FILE_NAME}"
+  )
+
+  add_library(${_LIB_NAME}
+    ${_H_FILE_NAME}
+  )
+  add_dependencies(${_LIB_NAME} ${_GEN_TARGET})
+
+  SET_TARGET_PROPERTIES(
+    ${_LIB_NAME}
+    PROPERTIES
+    LINKER_LANGUAGE C
+  )
+
+  add_library(${_PACKAGE_NS}::${_RULE_NAME} ALIAS ${_LIB_NAME})
+endfunction()
@@ -27,6 +27,21 @@ include(CMakeParseArguments)
 # RVV_OFF: Indicate RVV is OFF (default: ON)
 # VMVX: Compile VMVX backend
 # INLINE_HAL: Use inline HAL.
+# DATA_TILING: Also compile `<NAME>_bytecode_module_static_data_tiling` and
+#     `<NAME>_c_module_static_data_tiling`, the static modules with their
+#     weights prepacked in the data-tiled layout.
+# ENTRY: Entry function described by the generated `<NAME>_model` header
+#     (default: the first public function).
+# MODEL_NAME: Model name reported at runtime (default: NAME).
+# DYNAMIC_DIM_MAX: Upper bounds of the dynamic input dimensions of the entry
+#     function, in order of appearance.
+# OVERLAY_WINDOW: Also add `<NAME>_bytecode_module_static_overlay_lib` and
+#     `<NAME>_c_module_static_overlay_lib`, the static libraries with their
+#     dispatch functions in code overlays for an ITCM overlay window of this
+#     size.
+# EXT_CONSTANTS: Also add `<NAME>_bytecode_module_static_c_ext`, the
+#     embedded bytecode module with the constants of the model linked into the
+#     external memory.
 #
 # Examples:
 # springbok_modules(
@@ -57,9 +72,9 @@ include(CMakeParseArguments)
 function(springbok_modules)
   cmake_parse_arguments(
     _RULE
-    "RVV_OFF;VMVX;INLINE_HAL"
-    "NAME;SRC;C_IDENTIFIER"
-    "FLAGS"
+    "RVV_OFF;VMVX;INLINE_HAL;DATA_TILING;EXT_CONSTANTS"
+    "NAME;SRC;C_IDENTIFIER;ENTRY;MODEL_NAME;OVERLAY_WINDOW"
+    "FLAGS;DYNAMIC_DIM_MAX"
     ${ARGN}
   )
 
@@ -91,6 +106,10 @@ function(springbok_modules)
     set(_INLINE_HAL_ARG "INLINE_HAL")
   endif()
 
+  if (${_RULE_EXT_CONSTANTS})
+    set(_EXT_CONSTANTS_ARG "EXT_CONSTANTS")
+  endif()
+
   springbok_static_module(
     NAME
       "${_RULE_NAME}_bytecode_module_static"
@@ -102,6 +121,9 @@ function(springbok_modules)
       ${_RULE_FLAGS}
     "${_RVV_OFF_ARG}"
     "${_INLINE_HAL_ARG}"
+    "${_EXT_CONSTANTS_ARG}"
+    OVERLAY_WINDOW
+      "${_RULE_OVERLAY_WINDOW}"
     DEPENDS
       "${_INPUT_FILENAME}"
   )
@@ -116,10 +138,72 @@ function(springbok_modules)
     "${_RVV_OFF_ARG}"
     "${_INLINE_HAL_ARG}"
     EMITC
+    OVERLAY_WINDOW
+      "${_RULE_OVERLAY_WINDOW}"
     DEPENDS
       "${_INPUT_FILENAME}"
   )
 
+  # The MlModel descriptor comes from the signature of the entry function. A
+  # TFLite source is described by its import, which springbok_static_module
+  # writes next to the bytecode module.
+  string(FIND "${_INPUT_FILENAME}" ".tflite" _IS_TFLITE REVERSE)
+  if(${_IS_TFLITE} GREATER 0)
+    set(_SIGNATURE_SRC
+      "${CMAKE_CURRENT_BINARY_DIR}/${_RULE_NAME}_bytecode_module_static.mlir")
+  else()
+    get_filename_component(_SIGNATURE_SRC "${_INPUT_FILENAME}" REALPATH)
+  endif()
+
+  springbok_model_header(
+    NAME
+      "${_RULE_NAME}_model"
+    SRC
+      "${_SIGNATURE_SRC}"
+    ENTRY
+      "${_RULE_ENTRY}"
+    MODEL_NAME
+      "${_RULE_MODEL_NAME}"
+    DYNAMIC_DIM_MAX
+      ${_RULE_DYNAMIC_DIM_MAX}
+  )
+
+  # The data-tiled variants compile the same input, imported once for a TFLite
+  # source. Their entry function has the same signature, so they share the
+  # model header.
+  if (${_RULE_DATA_TILING})
+    springbok_static_module(
+      NAME
+        "${_RULE_NAME}_bytecode_module_static_data_tiling"
+      SRC
+        "${_SIGNATURE_SRC}"
+      C_IDENTIFIER
+        "${_RULE_C_IDENTIFIER}_bytecode_module_static_data_tiling"
+      FLAGS
+        ${_RULE_FLAGS}
+      "${_RVV_OFF_ARG}"
+      "${_INLINE_HAL_ARG}"
+      DATA_TILING
+      DEPENDS
+        "${_SIGNATURE_SRC}"
+    )
+
+    springbok_static_module(
+      NAME
+        "${_RULE_NAME}_c_module_static_data_tiling"
+      SRC
+        "${_SIGNATURE_SRC}"
+      FLAGS
+        ${_RULE_FLAGS}
+      "${_RVV_OFF_ARG}"
+      "${_INLINE_HAL_ARG}"
+      DATA_TILING
+      EMITC
+      DEPENDS
+        "${_SIGNATURE_SRC}"
+    )
+  endif()
+
   if (${_RULE_VMVX})
     springbok_vmvx_module(
       NAME
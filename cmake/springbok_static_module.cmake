@@ -23,6 +23,17 @@
 # RVV_OFF: Indicate RVV is OFF (default: ON)
 # EMITC: Uses EmitC to output C code instead of VM bytecode.
 # INLINE_HAL: Use inline HAL.
+# DATA_TILING: Encode the matmul operands in the data-tiled layout of the
+#     target, so the matmuls lower to mmt4d tiled for the Springbok VLEN. The
+#     constant weights are packed at compile time and stored packed.
+# OVERLAY_WINDOW: Also add `<NAME>_overlay_lib`, the static library with its
+#     dispatch functions moved into code overlays that fit an ITCM overlay
+#     window of this size (see build_tools/gen_overlays.py). Executables link
+#     it with the same `__overlay_window__`.
+# EXT_CONSTANTS: Also add `<NAME>_c_ext`, the embedded bytecode module with
+#     its rodata, the constants of the model among it, renamed to
+#     .ext_rodata, which springbok.ld links into the external memory.
+#     Executables link it in place of `<NAME>_c`. Ignored with EMITC.
 #
 # Examples:
 # springbok_static_module(
@@ -41,8 +52,8 @@
 function(springbok_static_module)
   cmake_parse_arguments(
     _RULE
-    "RVV_OFF;EMITC;INLINE_HAL"
-    "NAME;SRC;C_IDENTIFIER"
+    "RVV_OFF;EMITC;INLINE_HAL;DATA_TILING;EXT_CONSTANTS"
+    "NAME;SRC;C_IDENTIFIER;OVERLAY_WINDOW"
     "FLAGS;DEPENDS"
     ${ARGN}
   )
@@ -73,13 +84,27 @@ function(springbok_static_module)
   iree_package_name(_PACKAGE_NAME)
   iree_package_ns(_PACKAGE_NS)
 
-  set(_CPU_FEATURES "+m,+f,+zvl512b,+zve32x")
+  set(_CPU_FEATURES "+m,+f,+zvl${SPRINGBOK_RVV_VLEN}b,+zve32x")
   if (${_RULE_RVV_OFF})
     set(_CPU_FEATURES "+m,+f")
   endif()
 
   # Set common iree-compile flags
   set(_COMPILER_ARGS ${_RULE_FLAGS})
+  # The codegen cache variables override the per-model RVV flags, which LLVM
+  # only accepts once.
+  if (NOT ${_RULE_RVV_OFF})
+    list(TRANSFORM _COMPILER_ARGS REPLACE "^(-+riscv-v-vector-bits-min=).*"
+      "\\1${SPRINGBOK_RVV_VLEN}")
+    if (SPRINGBOK_RVV_LMUL_MAX)
+      list(FILTER _COMPILER_ARGS EXCLUDE REGEX
+        "^-+riscv-v-fixed-length-vector-lmul-max=")
+      list(APPEND _COMPILER_ARGS
+        "-riscv-v-fixed-length-vector-lmul-max=${SPRINGBOK_RVV_LMUL_MAX}")
+    endif()
+  endif()
+  separate_arguments(_CODEGEN_FLAGS UNIX_COMMAND "${SPRINGBOK_CODEGEN_FLAGS}")
+  list(APPEND _COMPILER_ARGS ${_CODEGEN_FLAGS})
   list(APPEND _COMPILER_ARGS "--iree-hal-target-backends=llvm-cpu")
   list(APPEND _COMPILER_ARGS "--iree-llvm-debug-symbols=false")
   list(APPEND _COMPILER_ARGS "--iree-vm-bytecode-module-strip-source-map=true")
@@ -92,6 +117,14 @@ function(springbok_static_module)
   if (${_RULE_INLINE_HAL})
     list(APPEND _COMPILER_ARGS "--iree-execution-model=inline-dynamic")
   endif()
+  if (${_RULE_DATA_TILING})
+    # The set_encoding of a constant weight is hoisted out of the entry
+    # function and evaluated by the compiler, which leaves the packed weight
+    # in the module rodata instead of packing it at every inference.
+    list(APPEND _COMPILER_ARGS "--iree-flow-enable-data-tiling")
+    list(APPEND _COMPILER_ARGS "--iree-opt-const-expr-hoisting")
+    list(APPEND _COMPILER_ARGS "--iree-opt-const-eval")
+  endif()
 
   if(_RULE_EMITC)
     set(_O_FILE_NAME "${_RULE_NAME}_c.o")
@@ -152,6 +185,35 @@ function(springbok_static_module)
         "${_RULE_C_IDENTIFIER}"
       PUBLIC
     )
+
+    if(_RULE_EXT_CONSTANTS)
+      set(_C_LIB_NAME "${_PACKAGE_NAME}_${_MODULE_NAME}_c")
+      set(_EXT_NAME "${_MODULE_NAME}_c_ext")
+      set(_EXT_LIB_NAME "${_PACKAGE_NAME}_${_EXT_NAME}")
+      set(_EXT_A_FILE_NAME "${CMAKE_CURRENT_BINARY_DIR}/lib${_EXT_LIB_NAME}.a")
+      add_custom_command(
+        OUTPUT
+          ${_EXT_A_FILE_NAME}
+        COMMAND
+          ${CMAKE_OBJCOPY}
+          "--rename-section=.rodata=.ext_rodata"
+          "$<TARGET_FILE:${_C_LIB_NAME}>"
+          ${_EXT_A_FILE_NAME}
+        DEPENDS
+          ${_C_LIB_NAME}
+      )
+      add_custom_target(${_EXT_LIB_NAME}_objcopy DEPENDS ${_EXT_A_FILE_NAME})
+
+      # The embedded module header comes from the build of `<NAME>_c`.
+      add_library(${_EXT_LIB_NAME} STATIC IMPORTED GLOBAL)
+      SET_TARGET_PROPERTIES(
+        ${_EXT_LIB_NAME}
+        PROPERTIES
+        IMPORTED_LOCATION ${_EXT_A_FILE_NAME}
+      )
+      add_dependencies(${_EXT_LIB_NAME} ${_EXT_LIB_NAME}_objcopy)
+      add_library(${_PACKAGE_NS}::${_EXT_NAME} ALIAS ${_EXT_LIB_NAME})
+    endif()
   endif(_RULE_EMITC)
 
   set(_NAME "${_RULE_NAME}_lib")
@@ -168,4 +230,36 @@ function(springbok_static_module)
 
   # Set alias for this static library to be used later in the function.
   add_library(${_PACKAGE_NS}::${_NAME} ALIAS ${_LIB_NAME})
+
+  if(_RULE_OVERLAY_WINDOW)
+    set(_OVERLAY_O_FILE_NAME "${_RULE_NAME}_overlay.o")
+    set(_GEN_OVERLAYS_SCRIPT "${CMAKE_SOURCE_DIR}/build_tools/gen_overlays.py")
+    add_custom_command(
+      OUTPUT
+        ${_OVERLAY_O_FILE_NAME}
+      COMMAND
+        ${_GEN_OVERLAYS_SCRIPT}
+        "--i=${_O_FILE_NAME}"
+        "--o=${_OVERLAY_O_FILE_NAME}"
+        "--w=${_RULE_OVERLAY_WINDOW}"
+        "--objcopy=${CMAKE_OBJCOPY}"
+      DEPENDS
+        ${_GEN_OVERLAYS_SCRIPT}
+        "${CMAKE_SOURCE_DIR}/build_tools/elf32.py"
+        ${_O_FILE_NAME}
+    )
+
+    set(_OVERLAY_NAME "${_RULE_NAME}_overlay_lib")
+    set(_OVERLAY_LIB_NAME "${_PACKAGE_NAME}_${_OVERLAY_NAME}")
+    add_library(${_OVERLAY_LIB_NAME}
+      STATIC
+      ${_OVERLAY_O_FILE_NAME}
+    )
+    SET_TARGET_PROPERTIES(
+      ${_OVERLAY_LIB_NAME}
+      PROPERTIES
+      LINKER_LANGUAGE C
+    )
+    add_library(${_PACKAGE_NS}::${_OVERLAY_NAME} ALIAS ${_OVERLAY_LIB_NAME})
+  endif()
 endfunction()
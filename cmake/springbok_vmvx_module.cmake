@@ -21,6 +21,8 @@
 # DEPENDS: List of other targets and files required for this binary.
 # EMITC: Uses EmitC to output C code instead of VM bytecode.
 # INLINE_HAL: Use inline HAL.
+# UKERNELS_OFF: Compile without the VMVX microkernels, even with
+#     SPRINGBOK_VMVX_UKERNELS.
 #
 # Examples:
 # springbok_vmvx_module(
@@ -38,7 +40,7 @@
 function(springbok_vmvx_module)
   cmake_parse_arguments(
     _RULE
-    "EMITC;INLINE_HAL"
+    "EMITC;INLINE_HAL;UKERNELS_OFF"
     "NAME;SRC;C_IDENTIFIER"
     "FLAGS;DEPENDS"
     ${ARGN}
@@ -78,6 +80,9 @@ function(springbok_vmvx_module)
   else()
     list(APPEND _COMPILER_ARGS "--iree-hal-target-backends=vmvx")
   endif()
+  if (${SPRINGBOK_VMVX_UKERNELS} AND NOT ${_RULE_UKERNELS_OFF})
+    list(APPEND _COMPILER_ARGS "--iree-vmvx-enable-microkernels")
+  endif()
 
   if(_RULE_EMITC)
     set(_MODULE_NAME "${_RULE_NAME}_emitc")
@@ -18,7 +18,7 @@
 
 #include "iree/hal/drivers/local_sync/sync_device.h"
 #include "iree/hal/local/loaders/static_library_loader.h"
-#include "samples/util/model_api.h"
+#include "samples/util/pipeline.h"
 
 // A function to create the HAL device from the different backend targets.
 // The HAL device and loader are returned based on the implementation, and they
@@ -32,13 +32,14 @@ iree_status_t create_sample_device(iree_allocator_t host_allocator,
   iree_hal_sync_device_params_t params;
   iree_hal_sync_device_params_initialize(&params);
 
-  // Load the statically embedded library
-  const iree_hal_executable_library_query_fn_t libraries[] = {library_query()};
+  // Load the statically embedded libraries, one per model of a pipeline.
+  iree_hal_executable_library_query_fn_t libraries[ML_PIPELINE_MAX_STAGES];
+  iree_host_size_t library_count = pipeline_library_queries(libraries);
 
   if (iree_status_is_ok(status)) {
     status = iree_hal_static_library_loader_create(
-        IREE_ARRAYSIZE(libraries), libraries,
-        iree_hal_executable_import_provider_null(), host_allocator, loader);
+        library_count, libraries, iree_hal_executable_import_provider_null(),
+        host_allocator, loader);
   }
 
   // Use the default host allocator for buffer allocations.
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Static library loading in IREE, with the dispatch functions of overlaid
+// libraries paged into the ITCM overlay window on demand.
+
+#include "iree/hal/drivers/local_sync/sync_device.h"
+#include "iree/hal/local/loaders/static_library_loader.h"
+#include "samples/device/library_wrapper.h"
+#include "samples/device/overlay_manager.h"
+#include "samples/util/pipeline.h"
+
+// A function to create the HAL device from the different backend targets.
+// The HAL device and loader are returned based on the implementation, and they
+// must be released by the caller.
+iree_status_t create_sample_device(iree_allocator_t host_allocator,
+                                   iree_hal_device_t** out_device,
+                                   iree_hal_executable_loader_t** loader) {
+  iree_status_t status = iree_ok_status();
+
+  // Set paramters for the device created in the next step.
+  iree_hal_sync_device_params_t params;
+  iree_hal_sync_device_params_initialize(&params);
+
+  // Load the statically embedded libraries, one per model of a pipeline,
+  // through the wrapper so their dispatches reach the overlay manager.
+  iree_hal_executable_library_query_fn_t libraries[ML_PIPELINE_MAX_STAGES];
+  iree_host_size_t library_count = pipeline_library_queries(libraries);
+  for (iree_host_size_t i = 0; i < library_count; ++i) {
+    libraries[i] = library_wrapper_wrap(libraries[i]);
+  }
+  overlay_manager_install();
+
+  if (iree_status_is_ok(status)) {
+    status = iree_hal_static_library_loader_create(
+        library_count, libraries, iree_hal_executable_import_provider_null(),
+        host_allocator, loader);
+  }
+
+  // Use the default host allocator for buffer allocations.
+  iree_string_view_t identifier = iree_make_cstring_view("sync");
+  iree_hal_allocator_t* device_allocator = NULL;
+  if (iree_status_is_ok(status)) {
+    status = iree_hal_allocator_create_heap(identifier, host_allocator,
+                                            host_allocator, &device_allocator);
+  }
+
+  // Create the device and release the executor and loader afterwards.
+  if (iree_status_is_ok(status)) {
+    status = iree_hal_sync_device_create(
+        identifier, &params, /*loader_count=*/1, loader, device_allocator,
+        host_allocator, out_device);
+  }
+
+  iree_hal_allocator_release(device_allocator);
+  return status;
+}
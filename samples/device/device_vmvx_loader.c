@@ -19,6 +19,9 @@
 #include "iree/hal/drivers/local_sync/sync_device.h"
 #include "iree/hal/local/loaders/vmvx_module_loader.h"
 #include "samples/device/device.h"
+#if defined(SPRINGBOK_VMVX_UKERNELS)
+#include "samples/device/vmvx_ukernel_module.h"
+#endif
 
 // A function to create the HAL device from the different backend targets.
 // The HAL device and loader are returned based on the implementation, and they
@@ -33,11 +36,28 @@ iree_status_t create_sample_device(iree_allocator_t host_allocator,
   iree_vm_instance_t* instance = NULL;
   iree_status_t status = iree_vm_instance_create(host_allocator, &instance);
 
+#if defined(SPRINGBOK_VMVX_UKERNELS)
+  // The RVV microkernel module is also named "vmvx". User modules are
+  // registered after the reference one, so the imports resolve to it.
+  iree_vm_module_t* ukernel_module = NULL;
+  if (iree_status_is_ok(status)) {
+    status =
+        create_vmvx_ukernel_module(instance, host_allocator, &ukernel_module);
+  }
+
+  if (iree_status_is_ok(status)) {
+    status = iree_hal_vmvx_module_loader_create(
+        instance, /*user_module_count=*/1, &ukernel_module, host_allocator,
+        loader);
+  }
+  iree_vm_module_release(ukernel_module);
+#else
   if (iree_status_is_ok(status)) {
     status = iree_hal_vmvx_module_loader_create(
         instance, /*user_module_count=*/0, /*user_modules=*/NULL,
         host_allocator, loader);
   }
+#endif  // defined(SPRINGBOK_VMVX_UKERNELS)
   iree_vm_instance_release(instance);
 
   // Use the default host allocator for buffer allocations.
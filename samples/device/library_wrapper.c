@@ -0,0 +1,145 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "samples/device/library_wrapper.h"
+
+#include <springbok.h>
+
+static library_dispatch_hook_t dispatch_hook = NULL;
+
+// Every wrapped export gets a slot. The slot index is baked into one of the
+// trampolines below, which is what the library copy exposes to the loader.
+static library_export_t exports[LIBRARY_WRAPPER_MAX_EXPORTS];
+static iree_host_size_t export_count = 0;
+
+static int library_wrapper_dispatch(
+    uint32_t index, const iree_hal_executable_environment_v0_t* environment,
+    const iree_hal_executable_dispatch_state_v0_t* dispatch_state,
+    const iree_hal_executable_workgroup_state_v0_t* workgroup_state) {
+  const library_export_t* library_export = &exports[index];
+  if (dispatch_hook) {
+    return dispatch_hook(library_export, environment, dispatch_state,
+                         workgroup_state);
+  }
+  return library_export_call(library_export, environment, dispatch_state,
+                             workgroup_state);
+}
+
+#define TRAMPOLINE(hi, lo)                                               \
+  static int trampoline_##hi##lo(                                        \
+      const iree_hal_executable_environment_v0_t* environment,           \
+      const iree_hal_executable_dispatch_state_v0_t* dispatch_state,     \
+      const iree_hal_executable_workgroup_state_v0_t* workgroup_state) { \
+    return library_wrapper_dispatch(0x##hi##lo, environment,             \
+                                    dispatch_state, workgroup_state);    \
+  }
+#define TRAMPOLINE_PTR(hi, lo) trampoline_##hi##lo,
+#define TRAMPOLINE_ROW(M, hi)                                             \
+  M(hi, 0) M(hi, 1) M(hi, 2) M(hi, 3) M(hi, 4) M(hi, 5) M(hi, 6) M(hi, 7) \
+  M(hi, 8) M(hi, 9) M(hi, a) M(hi, b) M(hi, c) M(hi, d) M(hi, e) M(hi, f)
+#define TRAMPOLINE_TABLE(M)                                      \
+  TRAMPOLINE_ROW(M, 0) TRAMPOLINE_ROW(M, 1) TRAMPOLINE_ROW(M, 2) \
+  TRAMPOLINE_ROW(M, 3) TRAMPOLINE_ROW(M, 4) TRAMPOLINE_ROW(M, 5) \
+  TRAMPOLINE_ROW(M, 6) TRAMPOLINE_ROW(M, 7)
+
+TRAMPOLINE_TABLE(TRAMPOLINE)
+
+static const iree_hal_executable_dispatch_v0_t
+    trampolines[LIBRARY_WRAPPER_MAX_EXPORTS] = {
+        TRAMPOLINE_TABLE(TRAMPOLINE_PTR)};
+
+typedef struct {
+  iree_hal_executable_library_query_fn_t query;
+  // Copy of the original library with its export pointers swapped.
+  iree_hal_executable_library_v0_t library;
+  const iree_hal_executable_library_header_t** header;
+} wrapped_library_t;
+
+static wrapped_library_t libraries[LIBRARY_WRAPPER_MAX_LIBRARIES];
+static iree_host_size_t library_count = 0;
+
+static const iree_hal_executable_library_header_t** wrapped_query(
+    uint32_t index, iree_hal_executable_library_version_t max_version,
+    const iree_hal_executable_environment_v0_t* environment) {
+  wrapped_library_t* wrapped = &libraries[index];
+  if (wrapped->header) return wrapped->header;
+
+  const iree_hal_executable_library_header_t** header =
+      wrapped->query(max_version, environment);
+  if (!header) return NULL;
+  const iree_hal_executable_library_v0_t* library =
+      (const iree_hal_executable_library_v0_t*)header;
+  const iree_host_size_t count = library->exports.count;
+  if (export_count + count > LIBRARY_WRAPPER_MAX_EXPORTS) {
+    LOG_WARN("library %s not wrapped: %u exports exceed the limit of %d",
+             (*header)->name, (unsigned)count, LIBRARY_WRAPPER_MAX_EXPORTS);
+    wrapped->header = header;
+    return header;
+  }
+
+  for (iree_host_size_t i = 0; i < count; ++i) {
+    library_export_t* library_export = &exports[export_count + i];
+    library_export->name =
+        library->exports.names ? library->exports.names[i] : NULL;
+    library_export->fn = library->exports.ptrs[i];
+    library_export->library_name = (*header)->name;
+    library_export->library = index;
+    library_export->ordinal = (uint32_t)i;
+    library_export->index = (uint32_t)(export_count + i);
+  }
+  wrapped->library = *library;
+  wrapped->library.exports.ptrs = &trampolines[export_count];
+  export_count += count;
+  wrapped->header =
+      (const iree_hal_executable_library_header_t**)&wrapped->library;
+  return wrapped->header;
+}
+
+// The query function carries no user data, so each library slot has its own.
+#define QUERY(index)                                                  \
+  static const iree_hal_executable_library_header_t** query_##index( \
+      iree_hal_executable_library_version_t max_version,             \
+      const iree_hal_executable_environment_v0_t* environment) {     \
+    return wrapped_query(index, max_version, environment);           \
+  }
+QUERY(0)
+QUERY(1)
+QUERY(2)
+QUERY(3)
+
+static const iree_hal_executable_library_query_fn_t
+    queries[LIBRARY_WRAPPER_MAX_LIBRARIES] = {query_0, query_1, query_2,
+                                              query_3};
+
+iree_hal_executable_library_query_fn_t library_wrapper_wrap(
+    iree_hal_executable_library_query_fn_t query) {
+  for (iree_host_size_t i = 0; i < library_count; ++i) {
+    if (libraries[i].query == query) return queries[i];
+  }
+  if (library_count == LIBRARY_WRAPPER_MAX_LIBRARIES) {
+    LOG_WARN("library wrapper is full; library left unwrapped");
+    return query;
+  }
+  libraries[library_count].query = query;
+  return queries[library_count++];
+}
+
+library_dispatch_hook_t library_wrapper_set_hook(
+    library_dispatch_hook_t hook) {
+  library_dispatch_hook_t previous = dispatch_hook;
+  dispatch_hook = hook;
+  return previous;
+}
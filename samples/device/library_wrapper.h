@@ -0,0 +1,72 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLES_DEVICE_LIBRARY_WRAPPER_H_
+#define SAMPLES_DEVICE_LIBRARY_WRAPPER_H_
+
+// Wraps a statically linked executable library so every workgroup call of its
+// exports goes through a runtime hook. The hook sees the export being called
+// and decides how (and where) to run it.
+
+#include "iree/hal/local/executable_library.h"
+
+// Upper bound on the exports of all the wrapped libraries together.
+#define LIBRARY_WRAPPER_MAX_EXPORTS 128
+// Upper bound on the number of wrapped libraries.
+#define LIBRARY_WRAPPER_MAX_LIBRARIES 4
+
+typedef struct {
+  // Export name, or NULL if the library was built without names.
+  const char* name;
+  // The generated dispatch function.
+  iree_hal_executable_dispatch_v0_t fn;
+  // Name of the library, the prefix of its `<name>_library_query` function.
+  const char* library_name;
+  // Index of the wrapped library, in wrapping order.
+  uint32_t library;
+  // Ordinal of the export within its library.
+  uint32_t ordinal;
+  // Index of the export across all the wrapped libraries, below
+  // LIBRARY_WRAPPER_MAX_EXPORTS.
+  uint32_t index;
+} library_export_t;
+
+typedef int (*library_dispatch_hook_t)(
+    const library_export_t* library_export,
+    const iree_hal_executable_environment_v0_t* environment,
+    const iree_hal_executable_dispatch_state_v0_t* dispatch_state,
+    const iree_hal_executable_workgroup_state_v0_t* workgroup_state);
+
+// Returns a query function that serves a copy of the library returned by
+// `query`, with each export replaced by a trampoline into the hook. If the
+// wrapper runs out of slots the original library is served unchanged.
+iree_hal_executable_library_query_fn_t library_wrapper_wrap(
+    iree_hal_executable_library_query_fn_t query);
+
+// Installs `hook` for all wrapped libraries and returns the previous one, so
+// hooks can be chained. With no hook the exports are called directly.
+library_dispatch_hook_t library_wrapper_set_hook(library_dispatch_hook_t hook);
+
+// Calls the export without any hook.
+static inline int library_export_call(
+    const library_export_t* library_export,
+    const iree_hal_executable_environment_v0_t* environment,
+    const iree_hal_executable_dispatch_state_v0_t* dispatch_state,
+    const iree_hal_executable_workgroup_state_v0_t* workgroup_state) {
+  return library_export->fn(environment, dispatch_state, workgroup_state);
+}
+
+#endif  // SAMPLES_DEVICE_LIBRARY_WRAPPER_H_
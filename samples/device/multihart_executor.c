@@ -0,0 +1,191 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "samples/device/multihart_executor.h"
+
+#include <springbok.h>
+
+#define MULTIHART_MAX_HARTS 8
+
+// Provided by springbok.ld from __secondary_hart_count__.
+extern const char _secondary_hart_count[];
+
+// The core has no A extension, so the harts synchronize without atomics:
+// every field below has exactly one writer, and the writer publishes with a
+// fence before bumping a sequence number that the readers poll.
+typedef struct {
+  // Written by the primary hart.
+  volatile uint32_t job_seq;
+  // Harts the job is split across, the primary and the first secondary harts.
+  uint32_t hart_count;
+  const library_export_t* library_export;
+  const iree_hal_executable_environment_v0_t* environment;
+  const iree_hal_executable_dispatch_state_v0_t* dispatch_state;
+  const iree_hal_executable_workgroup_state_v0_t* workgroup_state;
+  // Slot i is written by hart i.
+  volatile uint32_t ready[MULTIHART_MAX_HARTS];
+  volatile uint32_t done_seq[MULTIHART_MAX_HARTS];
+  volatile int result[MULTIHART_MAX_HARTS];
+} multihart_pool_t;
+
+static multihart_pool_t pool;
+
+// Dispatch statistics, reported at exit.
+static uint32_t parallel_dispatches = 0;
+static uint32_t serial_dispatches = 0;
+static uint32_t dispatch_cycles = 0;
+// Most harts a dispatch was split across.
+static uint32_t used_harts = 1;
+
+static inline void fence(void) {
+  __asm__ volatile("fence rw, rw" ::: "memory");
+}
+
+uint32_t multihart_hart_count(void) {
+  uint32_t count = 1 + (uint32_t)(uintptr_t)_secondary_hart_count;
+  return count < MULTIHART_MAX_HARTS ? count : MULTIHART_MAX_HARTS;
+}
+
+// Runs this hart's contiguous chunk of the workgroup grid.
+static int run_chunk(uint32_t hart, uint32_t hart_count) {
+  const iree_hal_executable_dispatch_state_v0_t* dispatch_state =
+      pool.dispatch_state;
+  const uint32_t count_x = dispatch_state->workgroup_count_x;
+  const uint32_t count_y = dispatch_state->workgroup_count_y;
+  const uint32_t count_xy = count_x * count_y;
+  const uint32_t total = count_xy * dispatch_state->workgroup_count_z;
+  const uint32_t begin = (uint32_t)((uint64_t)total * hart / hart_count);
+  const uint32_t end = (uint32_t)((uint64_t)total * (hart + 1) / hart_count);
+
+  iree_hal_executable_workgroup_state_v0_t workgroup_state =
+      *pool.workgroup_state;
+  workgroup_state.processor_id = hart;
+  for (uint32_t i = begin; i < end; ++i) {
+    workgroup_state.workgroup_id_x = i % count_x;
+    workgroup_state.workgroup_id_y = (i / count_x) % count_y;
+    workgroup_state.workgroup_id_z = (uint16_t)(i / count_xy);
+    int ret = library_export_call(pool.library_export, pool.environment,
+                                  dispatch_state, &workgroup_state);
+    if (ret) return ret;
+  }
+  return 0;
+}
+
+// Entry point of the secondary harts, called from crt0 with a stack of their
+// own. They stay here for the lifetime of the program, except the ones past
+// the slots of the pool, which return to be parked by crt0. A hart only takes
+// part in the jobs posted after it was ready.
+void springbok_secondary_main(uint32_t hart) {
+  if (hart >= MULTIHART_MAX_HARTS) {
+    return;
+  }
+  uint32_t seen_seq = pool.job_seq;
+  fence();
+  pool.ready[hart] = 1;
+  for (;;) {
+    uint32_t seq;
+    while ((seq = pool.job_seq) == seen_seq) {
+    }
+    fence();
+    seen_seq = seq;
+    if (hart < pool.hart_count) {
+      pool.result[hart] = run_chunk(hart, pool.hart_count);
+      fence();
+    }
+    pool.done_seq[hart] = seq;
+  }
+}
+
+// Harts a dispatch can be split across: the primary one and the secondary
+// harts up to the first one that never started, such as all of them when the
+// platform has a single hart.
+static uint32_t ready_hart_count(void) {
+  const uint32_t hart_count = multihart_hart_count();
+  uint32_t ready = 1;
+  while (ready < hart_count && pool.ready[ready]) {
+    ++ready;
+  }
+  fence();
+  return ready;
+}
+
+static int multihart_dispatch_hook(
+    const library_export_t* library_export,
+    const iree_hal_executable_environment_v0_t* environment,
+    const iree_hal_executable_dispatch_state_v0_t* dispatch_state,
+    const iree_hal_executable_workgroup_state_v0_t* workgroup_state) {
+  const uint32_t hart_count = multihart_hart_count();
+  // Workgroup local memory is handed out per call by the device, so
+  // dispatches that use it stay on the primary hart.
+  if (hart_count == 1 || workgroup_state->local_memory_size != 0) {
+    if ((workgroup_state->workgroup_id_x | workgroup_state->workgroup_id_y |
+         workgroup_state->workgroup_id_z) == 0) {
+      ++serial_dispatches;
+    }
+    return library_export_call(library_export, environment, dispatch_state,
+                               workgroup_state);
+  }
+  // The whole grid already ran as part of workgroup (0, 0, 0).
+  if (workgroup_state->workgroup_id_x | workgroup_state->workgroup_id_y |
+      workgroup_state->workgroup_id_z) {
+    return 0;
+  }
+
+  // Without the secondary harts, the executable runs on a platform that does
+  // not match its build, and the primary hart alone would hide it.
+  const uint32_t ready = ready_hart_count();
+  if (ready == 1) {
+    LOG_ERROR("multihart: none of the %u secondary harts started",
+              (unsigned)(hart_count - 1));
+    return 1;
+  }
+
+  uint32_t start = springbok_ccount();
+  pool.hart_count = ready;
+  pool.library_export = library_export;
+  pool.environment = environment;
+  pool.dispatch_state = dispatch_state;
+  pool.workgroup_state = workgroup_state;
+  fence();
+  const uint32_t seq = pool.job_seq + 1;
+  pool.job_seq = seq;
+
+  int ret = run_chunk(/*hart=*/0, ready);
+  for (uint32_t hart = 1; hart < ready; ++hart) {
+    while (pool.done_seq[hart] != seq) {
+    }
+  }
+  fence();
+  for (uint32_t hart = 1; hart < ready && !ret; ++hart) {
+    ret = pool.result[hart];
+  }
+  dispatch_cycles += springbok_ccount() - start;
+  ++parallel_dispatches;
+  used_harts = ready > used_harts ? ready : used_harts;
+  return ret;
+}
+
+__attribute__((destructor)) static void multihart_report(void) {
+  LOG_INFO("multihart: %u harts, %u parallel and %u serial dispatches",
+           (unsigned)used_harts, (unsigned)parallel_dispatches,
+           (unsigned)serial_dispatches);
+  LOG_INFO("multihart: %u cycles in parallel dispatches",
+           (unsigned)dispatch_cycles);
+}
+
+void multihart_executor_install(void) {
+  library_wrapper_set_hook(multihart_dispatch_hook);
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLES_DEVICE_MULTIHART_EXECUTOR_H_
+#define SAMPLES_DEVICE_MULTIHART_EXECUTOR_H_
+
+// Workgroup-parallel executor for the multi-hart Springbok platform.
+//
+// The sync device runs the workgroups of a dispatch one after the other on
+// the primary hart. With the executor installed, the call for workgroup
+// (0, 0, 0) runs the whole grid instead, split into contiguous chunks across
+// the primary hart and the secondary harts started by crt0. The calls for the
+// remaining workgroups then return right away.
+//
+// The number of harts comes from the __secondary_hart_count__ link option,
+// up to 8 with the primary one. A dispatch is split only across the secondary
+// harts that started, and fails if none did, as when the executable runs on a
+// single-hart platform.
+
+#include <stdint.h>
+
+#include "samples/device/library_wrapper.h"
+
+// Number of harts (primary included) the executor splits dispatches across.
+uint32_t multihart_hart_count(void);
+
+// Installs the executor as the dispatch hook of the wrapped libraries.
+void multihart_executor_install(void);
+
+#endif  // SAMPLES_DEVICE_MULTIHART_EXECUTOR_H_
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "samples/device/overlay_manager.h"
+
+#include <springbok.h>
+#include <string.h>
+
+// Entry of the .overlay_table gen_overlays.py adds to an overlaid object.
+typedef struct {
+  uint32_t name_hash;  // FNV-1a of "<library>:<function>".
+  uint32_t slot;
+} overlay_table_entry_t;
+
+// Provided by springbok.ld.
+extern const overlay_table_entry_t _soverlay_table[];
+extern const overlay_table_entry_t _eoverlay_table[];
+extern char _soverlay_window[];
+extern const char _overlay_window_length[];
+
+#define SLOT_SYMBOLS(n)                          \
+  extern const char __load_start_overlay##n[]; \
+  extern const char __load_stop_overlay##n[];
+SLOT_SYMBOLS(0)
+SLOT_SYMBOLS(1)
+SLOT_SYMBOLS(2)
+SLOT_SYMBOLS(3)
+SLOT_SYMBOLS(4)
+SLOT_SYMBOLS(5)
+SLOT_SYMBOLS(6)
+SLOT_SYMBOLS(7)
+
+static const char* const kLoadStart[OVERLAY_SLOT_COUNT] = {
+    __load_start_overlay0, __load_start_overlay1, __load_start_overlay2,
+    __load_start_overlay3, __load_start_overlay4, __load_start_overlay5,
+    __load_start_overlay6, __load_start_overlay7,
+};
+static const char* const kLoadStop[OVERLAY_SLOT_COUNT] = {
+    __load_stop_overlay0, __load_stop_overlay1, __load_stop_overlay2,
+    __load_stop_overlay3, __load_stop_overlay4, __load_stop_overlay5,
+    __load_stop_overlay6, __load_stop_overlay7,
+};
+
+// Slot of each wrapped export, looked up on its first call: 0 until then,
+// the slot + 1 for an overlaid export, SLOT_RESIDENT for the others.
+#define SLOT_RESIDENT (OVERLAY_SLOT_COUNT + 1)
+static uint8_t export_slots[LIBRARY_WRAPPER_MAX_EXPORTS];
+
+// Slot in the window, -1 for none.
+static int window_slot = -1;
+
+// Residency statistics, reported at exit.
+static uint32_t slot_dispatches[OVERLAY_SLOT_COUNT];
+static uint32_t slot_loads[OVERLAY_SLOT_COUNT];
+static uint32_t dispatches = 0;
+static uint32_t hits = 0;
+static uint32_t loaded_bytes = 0;
+static uint32_t load_cycles = 0;
+
+static uint32_t slot_size(uint32_t slot) {
+  return (uint32_t)(kLoadStop[slot] - kLoadStart[slot]);
+}
+
+static uint32_t fnv1a(uint32_t hash, const char* text) {
+  for (; *text; ++text) {
+    hash = (hash ^ (uint8_t)*text) * 0x01000193u;
+  }
+  return hash;
+}
+
+// Export names repeat across libraries, so the hash covers the library name.
+static uint32_t name_hash(const library_export_t* library_export) {
+  uint32_t hash = fnv1a(0x811c9dc5u, library_export->library_name);
+  hash = fnv1a(hash, ":");
+  return fnv1a(hash, library_export->name);
+}
+
+static uint8_t lookup_slot(const library_export_t* library_export) {
+  if (!library_export->name || !library_export->library_name) {
+    return SLOT_RESIDENT;
+  }
+  uint32_t hash = name_hash(library_export);
+  for (const overlay_table_entry_t* entry = _soverlay_table;
+       entry < _eoverlay_table; ++entry) {
+    if (entry->name_hash == hash && entry->slot < OVERLAY_SLOT_COUNT &&
+        slot_size(entry->slot) > 0) {
+      return (uint8_t)(entry->slot + 1);
+    }
+  }
+  return SLOT_RESIDENT;
+}
+
+// Copy `slot` from its load address into the window. The window is fetched
+// from as well as written, so the store has to reach the instruction stream.
+static void load_slot(uint32_t slot) {
+  uint32_t start = springbok_ccount();
+  memcpy(_soverlay_window, kLoadStart[slot], slot_size(slot));
+  __asm__ volatile("fence.i" ::: "memory");
+  window_slot = (int)slot;
+  ++slot_loads[slot];
+  loaded_bytes += slot_size(slot);
+  load_cycles += springbok_ccount() - start;
+}
+
+static int overlay_dispatch_hook(
+    const library_export_t* library_export,
+    const iree_hal_executable_environment_v0_t* environment,
+    const iree_hal_executable_dispatch_state_v0_t* dispatch_state,
+    const iree_hal_executable_workgroup_state_v0_t* workgroup_state) {
+  uint8_t* export_slot = &export_slots[library_export->index];
+  if (*export_slot == 0) {
+    *export_slot = lookup_slot(library_export);
+  }
+  if (*export_slot != SLOT_RESIDENT) {
+    const uint32_t slot = *export_slot - 1;
+    const bool first = (workgroup_state->workgroup_id_x |
+                        workgroup_state->workgroup_id_y |
+                        workgroup_state->workgroup_id_z) == 0;
+    if (first) {
+      ++dispatches;
+      ++slot_dispatches[slot];
+    }
+    if (window_slot != (int)slot) {
+      load_slot(slot);
+    } else if (first) {
+      ++hits;
+    }
+  }
+  return library_export_call(library_export, environment, dispatch_state,
+                             workgroup_state);
+}
+
+__attribute__((destructor)) static void overlay_report(void) {
+  LOG_INFO("overlay: %u-byte window at 0x%08x",
+           (unsigned)(uintptr_t)_overlay_window_length,
+           (unsigned)(uintptr_t)_soverlay_window);
+  for (uint32_t slot = 0; slot < OVERLAY_SLOT_COUNT; ++slot) {
+    if (slot_size(slot) > 0) {
+      LOG_INFO("overlay slot %u: %u bytes, %u dispatches, %u loads",
+               (unsigned)slot, (unsigned)slot_size(slot),
+               (unsigned)slot_dispatches[slot], (unsigned)slot_loads[slot]);
+    }
+  }
+  uint32_t basis_points =
+      dispatches ? (uint64_t)hits * 10000 / dispatches : 0;
+  LOG_INFO("overlay: %u dispatches, %u resident hits (%u.%02u%%)",
+           (unsigned)dispatches, (unsigned)hits,
+           (unsigned)(basis_points / 100), (unsigned)(basis_points % 100));
+  LOG_INFO("overlay: %u bytes paged in, %u cycles", (unsigned)loaded_bytes,
+           (unsigned)load_cycles);
+}
+
+void overlay_manager_install(void) {
+  library_wrapper_set_hook(overlay_dispatch_hook);
+}
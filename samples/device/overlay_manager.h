@@ -0,0 +1,42 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLES_DEVICE_OVERLAY_MANAGER_H_
+#define SAMPLES_DEVICE_OVERLAY_MANAGER_H_
+
+// Code overlays for static libraries larger than the ITCM.
+//
+// build_tools/gen_overlays.py moves the dispatch functions of a static library
+// object into .overlay<slot> sections, which springbok.ld links to run at the
+// overlay window at the top of the ITCM and loads into DTCM, and records the
+// slot of every dispatch function in the .overlay_table of the object. With
+// the manager installed, a dispatch whose slot is not the one in the window
+// copies its slot from DTCM into the window before its first workgroup runs.
+//
+// The window size comes from the __overlay_window__ link option, and must be
+// the one the library objects were packed for.
+
+#include <stdint.h>
+
+#include "samples/device/library_wrapper.h"
+
+// Number of slots, the .overlay<n> output sections of springbok.ld.
+#define OVERLAY_SLOT_COUNT 8
+
+// Installs the manager as the dispatch hook of the wrapped libraries.
+void overlay_manager_install(void);
+
+#endif  // SAMPLES_DEVICE_OVERLAY_MANAGER_H_
@@ -0,0 +1,884 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// RVV implementation of the VMVX microkernel module.
+//
+// The function names and calling conventions mirror iree/modules/vmvx so the
+// compiled VMVX programs resolve their imports here instead of in the
+// reference module. The vector unit is zve32x (integer only, ELEN=32), so the
+// integer ops, copies, fills and int8 matmuls are vectorized while the float
+// ops stay scalar.
+
+#include "samples/device/vmvx_ukernel_module.h"
+
+#include <math.h>
+#include <riscv_vector.h>
+#include <string.h>
+
+#include "iree/vm/native_module.h"
+#include "iree/vm/shims.h"
+
+#define VMVX_UKERNEL_MODULE_VERSION 0x00000000u
+
+// Bit 0 of the matmul/mmt4d flags: accumulate into the existing output.
+#define VMVX_MATMUL_FLAG_ACCUMULATE 1u
+
+//===----------------------------------------------------------------------===//
+// Module type and state
+//===----------------------------------------------------------------------===//
+
+typedef struct {
+  iree_allocator_t host_allocator;
+} vmvx_ukernel_module_t;
+
+#define VMVX_UKERNEL_MODULE_CAST(module)        \
+  (vmvx_ukernel_module_t*)((uint8_t*)(module) + \
+                           iree_vm_native_module_size())
+
+typedef struct {
+  iree_allocator_t host_allocator;
+} vmvx_ukernel_module_state_t;
+
+static void IREE_API_PTR vmvx_ukernel_module_destroy(void* base_module) {}
+
+static iree_status_t IREE_API_PTR vmvx_ukernel_module_alloc_state(
+    void* self, iree_allocator_t host_allocator,
+    iree_vm_module_state_t** out_module_state) {
+  vmvx_ukernel_module_state_t* state = NULL;
+  IREE_RETURN_IF_ERROR(
+      iree_allocator_malloc(host_allocator, sizeof(*state), (void**)&state));
+  state->host_allocator = host_allocator;
+  *out_module_state = (iree_vm_module_state_t*)state;
+  return iree_ok_status();
+}
+
+static void IREE_API_PTR vmvx_ukernel_module_free_state(
+    void* self, iree_vm_module_state_t* module_state) {
+  vmvx_ukernel_module_state_t* state =
+      (vmvx_ukernel_module_state_t*)module_state;
+  iree_allocator_free(state->host_allocator, state);
+}
+
+//===----------------------------------------------------------------------===//
+// Argument structs and shims
+//===----------------------------------------------------------------------===//
+// Named after their role rather than their type string so they cannot collide
+// with the shims IREE defines for its own vmvx module.
+
+// rIIIrIIIrIIIII: lhs, rhs, out 2D strided views and the 2D size.
+IREE_VM_ABI_FIXED_STRUCT(sbk_binary2d, {
+  iree_vm_ref_t lhs_ref;
+  int64_t lhs_offset;
+  int64_t lhs_stride0;
+  int64_t lhs_stride1;
+  iree_vm_ref_t rhs_ref;
+  int64_t rhs_offset;
+  int64_t rhs_stride0;
+  int64_t rhs_stride1;
+  iree_vm_ref_t out_ref;
+  int64_t out_offset;
+  int64_t out_stride0;
+  int64_t out_stride1;
+  int64_t size0;
+  int64_t size1;
+});
+
+// rIIIrIIIII: in, out 2D strided views and the 2D size.
+IREE_VM_ABI_FIXED_STRUCT(sbk_unary2d, {
+  iree_vm_ref_t in_ref;
+  int64_t in_offset;
+  int64_t in_stride0;
+  int64_t in_stride1;
+  iree_vm_ref_t out_ref;
+  int64_t out_offset;
+  int64_t out_stride0;
+  int64_t out_stride1;
+  int64_t size0;
+  int64_t size1;
+});
+
+// irIIII: fill value, out view with a row stride and the 2D size.
+IREE_VM_ABI_FIXED_STRUCT(sbk_fill2d, {
+  int32_t value;
+  iree_vm_ref_t out_ref;
+  int64_t out_offset;
+  int64_t out_row_stride;
+  int64_t size0;
+  int64_t size1;
+});
+
+// rIIrIIrIIIIIi: row-major lhs (MxK), rhs (KxN), out (MxN) and flags.
+IREE_VM_ABI_FIXED_STRUCT(sbk_matmul, {
+  iree_vm_ref_t lhs_ref;
+  int64_t lhs_offset;
+  int64_t lhs_row_stride;
+  iree_vm_ref_t rhs_ref;
+  int64_t rhs_offset;
+  int64_t rhs_row_stride;
+  iree_vm_ref_t out_ref;
+  int64_t out_offset;
+  int64_t out_row_stride;
+  int64_t m;
+  int64_t n;
+  int64_t k;
+  int32_t flags;
+});
+
+// rIIrIIrIIIIIiiii: tiled lhs (MxKxM0xK0), rhs (NxKxN0xK0), out (MxNxM0xN0),
+// the tile sizes and flags.
+IREE_VM_ABI_FIXED_STRUCT(sbk_mmt4d, {
+  iree_vm_ref_t lhs_ref;
+  int64_t lhs_offset;
+  int64_t lhs_row_stride;
+  iree_vm_ref_t rhs_ref;
+  int64_t rhs_offset;
+  int64_t rhs_row_stride;
+  iree_vm_ref_t out_ref;
+  int64_t out_offset;
+  int64_t out_row_stride;
+  int64_t m;
+  int64_t n;
+  int64_t k;
+  int32_t m0;
+  int32_t n0;
+  int32_t k0;
+  int32_t flags;
+});
+
+IREE_VM_ABI_DEFINE_SHIM(sbk_binary2d, v);
+IREE_VM_ABI_DEFINE_SHIM(sbk_unary2d, v);
+IREE_VM_ABI_DEFINE_SHIM(sbk_fill2d, v);
+IREE_VM_ABI_DEFINE_SHIM(sbk_matmul, v);
+IREE_VM_ABI_DEFINE_SHIM(sbk_mmt4d, v);
+
+//===----------------------------------------------------------------------===//
+// Buffer mapping
+//===----------------------------------------------------------------------===//
+
+// Number of elements spanned by `rows` rows of `row_length` elements each,
+// `row_stride` elements apart.
+static iree_host_size_t span_length(int64_t rows, int64_t row_stride,
+                                    int64_t row_length) {
+  if (rows <= 0 || row_length <= 0) return 0;
+  return (iree_host_size_t)((rows - 1) * row_stride + row_length);
+}
+
+// Number of elements spanned by a 2D strided view.
+static iree_host_size_t span_length_2d(int64_t size0, int64_t stride0,
+                                       int64_t size1, int64_t stride1) {
+  if (size1 <= 0) return 0;
+  return span_length(size0, stride0, (size1 - 1) * stride1 + 1);
+}
+
+static iree_status_t map_ro(iree_vm_ref_t ref, int64_t offset,
+                            iree_host_size_t length,
+                            iree_host_size_t element_size,
+                            const void** out_ptr) {
+  *out_ptr = NULL;
+  iree_vm_buffer_t* buffer = NULL;
+  IREE_RETURN_IF_ERROR(iree_vm_buffer_check_deref(ref, &buffer));
+  if (length == 0) return iree_ok_status();
+  iree_const_byte_span_t span = iree_const_byte_span_empty();
+  IREE_RETURN_IF_ERROR(
+      iree_vm_buffer_map_ro(buffer, (iree_host_size_t)offset * element_size,
+                            length * element_size, element_size, &span));
+  *out_ptr = span.data;
+  return iree_ok_status();
+}
+
+static iree_status_t map_rw(iree_vm_ref_t ref, int64_t offset,
+                            iree_host_size_t length,
+                            iree_host_size_t element_size, void** out_ptr) {
+  *out_ptr = NULL;
+  iree_vm_buffer_t* buffer = NULL;
+  IREE_RETURN_IF_ERROR(iree_vm_buffer_check_deref(ref, &buffer));
+  if (length == 0) return iree_ok_status();
+  iree_byte_span_t span = iree_byte_span_empty();
+  IREE_RETURN_IF_ERROR(
+      iree_vm_buffer_map_rw(buffer, (iree_host_size_t)offset * element_size,
+                            length * element_size, element_size, &span));
+  *out_ptr = span.data;
+  return iree_ok_status();
+}
+
+//===----------------------------------------------------------------------===//
+// Elementwise ops
+//===----------------------------------------------------------------------===//
+
+typedef enum {
+  BINARY_I32_ADD,
+  BINARY_I32_SUB,
+  BINARY_I32_MUL,
+  BINARY_I32_DIVS,
+  BINARY_I32_DIVU,
+  BINARY_I32_AND,
+  BINARY_I32_OR,
+  BINARY_I32_XOR,
+  BINARY_I32_SHL,
+  BINARY_I32_SHRS,
+  BINARY_I32_SHRU,
+} binary_i32_op_t;
+
+static vint32m8_t binary_i32(binary_i32_op_t op, vint32m8_t a, vint32m8_t b,
+                             size_t vl) {
+  vuint32m8_t ua = vreinterpret_v_i32m8_u32m8(a);
+  vuint32m8_t ub = vreinterpret_v_i32m8_u32m8(b);
+  switch (op) {
+    case BINARY_I32_ADD:
+      return vadd_vv_i32m8(a, b, vl);
+    case BINARY_I32_SUB:
+      return vsub_vv_i32m8(a, b, vl);
+    case BINARY_I32_MUL:
+      return vmul_vv_i32m8(a, b, vl);
+    case BINARY_I32_DIVS:
+      return vdiv_vv_i32m8(a, b, vl);
+    case BINARY_I32_DIVU:
+      return vreinterpret_v_u32m8_i32m8(vdivu_vv_u32m8(ua, ub, vl));
+    case BINARY_I32_AND:
+      return vand_vv_i32m8(a, b, vl);
+    case BINARY_I32_OR:
+      return vor_vv_i32m8(a, b, vl);
+    case BINARY_I32_XOR:
+      return vxor_vv_i32m8(a, b, vl);
+    case BINARY_I32_SHL:
+      return vsll_vv_i32m8(a, ub, vl);
+    case BINARY_I32_SHRS:
+      return vsra_vv_i32m8(a, ub, vl);
+    case BINARY_I32_SHRU:
+      return vreinterpret_v_u32m8_i32m8(vsrl_vv_u32m8(ua, ub, vl));
+  }
+  return a;
+}
+
+static iree_status_t binary2d_i32(binary_i32_op_t op,
+                                  const iree_vm_abi_sbk_binary2d_t* args) {
+  const int32_t* lhs = NULL;
+  const int32_t* rhs = NULL;
+  int32_t* out = NULL;
+  IREE_RETURN_IF_ERROR(
+      map_ro(args->lhs_ref, args->lhs_offset,
+             span_length_2d(args->size0, args->lhs_stride0, args->size1,
+                            args->lhs_stride1),
+             sizeof(int32_t), (const void**)&lhs));
+  IREE_RETURN_IF_ERROR(
+      map_ro(args->rhs_ref, args->rhs_offset,
+             span_length_2d(args->size0, args->rhs_stride0, args->size1,
+                            args->rhs_stride1),
+             sizeof(int32_t), (const void**)&rhs));
+  IREE_RETURN_IF_ERROR(
+      map_rw(args->out_ref, args->out_offset,
+             span_length_2d(args->size0, args->out_stride0, args->size1,
+                            args->out_stride1),
+             sizeof(int32_t), (void**)&out));
+
+  const bool contiguous = args->lhs_stride1 == 1 && args->rhs_stride1 == 1 &&
+                          args->out_stride1 == 1;
+  const ptrdiff_t lhs_bstride = args->lhs_stride1 * sizeof(int32_t);
+  const ptrdiff_t rhs_bstride = args->rhs_stride1 * sizeof(int32_t);
+  const ptrdiff_t out_bstride = args->out_stride1 * sizeof(int32_t);
+  for (int64_t i = 0; i < args->size0; ++i) {
+    const int32_t* l = lhs + i * args->lhs_stride0;
+    const int32_t* r = rhs + i * args->rhs_stride0;
+    int32_t* o = out + i * args->out_stride0;
+    for (size_t j = 0, n = (size_t)args->size1; j < n;) {
+      size_t vl = vsetvl_e32m8(n - j);
+      vint32m8_t a, b;
+      if (contiguous) {
+        a = vle32_v_i32m8(l + j, vl);
+        b = vle32_v_i32m8(r + j, vl);
+        vse32_v_i32m8(o + j, binary_i32(op, a, b, vl), vl);
+      } else {
+        a = vlse32_v_i32m8(l + j * args->lhs_stride1, lhs_bstride, vl);
+        b = vlse32_v_i32m8(r + j * args->rhs_stride1, rhs_bstride, vl);
+        vsse32_v_i32m8(o + j * args->out_stride1, out_bstride,
+                       binary_i32(op, a, b, vl), vl);
+      }
+      j += vl;
+    }
+  }
+  return iree_ok_status();
+}
+
+typedef enum {
+  BINARY_F32_ADD,
+  BINARY_F32_SUB,
+  BINARY_F32_MUL,
+  BINARY_F32_DIV,
+} binary_f32_op_t;
+
+static iree_status_t binary2d_f32(binary_f32_op_t op,
+                                  const iree_vm_abi_sbk_binary2d_t* args) {
+  const float* lhs = NULL;
+  const float* rhs = NULL;
+  float* out = NULL;
+  IREE_RETURN_IF_ERROR(
+      map_ro(args->lhs_ref, args->lhs_offset,
+             span_length_2d(args->size0, args->lhs_stride0, args->size1,
+                            args->lhs_stride1),
+             sizeof(float), (const void**)&lhs));
+  IREE_RETURN_IF_ERROR(
+      map_ro(args->rhs_ref, args->rhs_offset,
+             span_length_2d(args->size0, args->rhs_stride0, args->size1,
+                            args->rhs_stride1),
+             sizeof(float), (const void**)&rhs));
+  IREE_RETURN_IF_ERROR(
+      map_rw(args->out_ref, args->out_offset,
+             span_length_2d(args->size0, args->out_stride0, args->size1,
+                            args->out_stride1),
+             sizeof(float), (void**)&out));
+
+  // No vector floating point on zve32x; keep these scalar.
+  for (int64_t i = 0; i < args->size0; ++i) {
+    for (int64_t j = 0; j < args->size1; ++j) {
+      float a = lhs[i * args->lhs_stride0 + j * args->lhs_stride1];
+      float b = rhs[i * args->rhs_stride0 + j * args->rhs_stride1];
+      float* o = &out[i * args->out_stride0 + j * args->out_stride1];
+      switch (op) {
+        case BINARY_F32_ADD:
+          *o = a + b;
+          break;
+        case BINARY_F32_SUB:
+          *o = a - b;
+          break;
+        case BINARY_F32_MUL:
+          *o = a * b;
+          break;
+        case BINARY_F32_DIV:
+          *o = a / b;
+          break;
+      }
+    }
+  }
+  return iree_ok_status();
+}
+
+typedef enum {
+  UNARY_F32_ABS,
+  UNARY_F32_NEG,
+  UNARY_F32_CEIL,
+  UNARY_F32_FLOOR,
+  UNARY_F32_EXP,
+  UNARY_F32_LOG,
+  UNARY_F32_RSQRT,
+  UNARY_I32_CTLZ,
+} unary_op_t;
+
+// abs and neg only touch the sign bit, so they run on the integer vector unit.
+static void sign_bit_row(unary_op_t op, const int32_t* in, ptrdiff_t in_stride,
+                         int32_t* out, ptrdiff_t out_stride, size_t n) {
+  const bool contiguous = in_stride == 1 && out_stride == 1;
+  for (size_t j = 0; j < n;) {
+    size_t vl = vsetvl_e32m8(n - j);
+    vint32m8_t v =
+        contiguous ? vle32_v_i32m8(in + j, vl)
+                   : vlse32_v_i32m8(in + j * in_stride,
+                                    in_stride * sizeof(int32_t), vl);
+    v = op == UNARY_F32_ABS ? vand_vx_i32m8(v, INT32_MAX, vl)
+                            : vxor_vx_i32m8(v, INT32_MIN, vl);
+    if (contiguous) {
+      vse32_v_i32m8(out + j, v, vl);
+    } else {
+      vsse32_v_i32m8(out + j * out_stride, out_stride * sizeof(int32_t), v,
+                     vl);
+    }
+    j += vl;
+  }
+}
+
+static iree_status_t unary2d(unary_op_t op,
+                             const iree_vm_abi_sbk_unary2d_t* args) {
+  const void* in = NULL;
+  void* out = NULL;
+  IREE_RETURN_IF_ERROR(
+      map_ro(args->in_ref, args->in_offset,
+             span_length_2d(args->size0, args->in_stride0, args->size1,
+                            args->in_stride1),
+             sizeof(uint32_t), &in));
+  IREE_RETURN_IF_ERROR(
+      map_rw(args->out_ref, args->out_offset,
+             span_length_2d(args->size0, args->out_stride0, args->size1,
+                            args->out_stride1),
+             sizeof(uint32_t), &out));
+
+  for (int64_t i = 0; i < args->size0; ++i) {
+    if (op == UNARY_F32_ABS || op == UNARY_F32_NEG) {
+      sign_bit_row(op, (const int32_t*)in + i * args->in_stride0,
+                   (ptrdiff_t)args->in_stride1,
+                   (int32_t*)out + i * args->out_stride0,
+                   (ptrdiff_t)args->out_stride1, (size_t)args->size1);
+      continue;
+    }
+    for (int64_t j = 0; j < args->size1; ++j) {
+      const int64_t in_index = i * args->in_stride0 + j * args->in_stride1;
+      const int64_t out_index = i * args->out_stride0 + j * args->out_stride1;
+      if (op == UNARY_I32_CTLZ) {
+        uint32_t a = ((const uint32_t*)in)[in_index];
+        ((int32_t*)out)[out_index] = a == 0 ? 32 : __builtin_clz(a);
+        continue;
+      }
+      float a = ((const float*)in)[in_index];
+      float* o = &((float*)out)[out_index];
+      switch (op) {
+        case UNARY_F32_CEIL:
+          *o = ceilf(a);
+          break;
+        case UNARY_F32_FLOOR:
+          *o = floorf(a);
+          break;
+        case UNARY_F32_EXP:
+          *o = expf(a);
+          break;
+        case UNARY_F32_LOG:
+          *o = logf(a);
+          break;
+        case UNARY_F32_RSQRT:
+          *o = 1.0f / sqrtf(a);
+          break;
+        default:
+          break;
+      }
+    }
+  }
+  return iree_ok_status();
+}
+
+#define BINARY_EXPORT(name, impl, op)                                     \
+  IREE_VM_ABI_EXPORT(name, vmvx_ukernel_module_state_t, sbk_binary2d, v) { \
+    return impl(op, args);                                                \
+  }
+#define UNARY_EXPORT(name, op)                                           \
+  IREE_VM_ABI_EXPORT(name, vmvx_ukernel_module_state_t, sbk_unary2d, v) { \
+    return unary2d(op, args);                                            \
+  }
+
+BINARY_EXPORT(vmvx_add2d_f32, binary2d_f32, BINARY_F32_ADD)
+BINARY_EXPORT(vmvx_sub2d_f32, binary2d_f32, BINARY_F32_SUB)
+BINARY_EXPORT(vmvx_mul2d_f32, binary2d_f32, BINARY_F32_MUL)
+BINARY_EXPORT(vmvx_div2d_f32, binary2d_f32, BINARY_F32_DIV)
+BINARY_EXPORT(vmvx_add2d_i32, binary2d_i32, BINARY_I32_ADD)
+BINARY_EXPORT(vmvx_sub2d_i32, binary2d_i32, BINARY_I32_SUB)
+BINARY_EXPORT(vmvx_mul2d_i32, binary2d_i32, BINARY_I32_MUL)
+BINARY_EXPORT(vmvx_divs2d_i32, binary2d_i32, BINARY_I32_DIVS)
+BINARY_EXPORT(vmvx_divu2d_i32, binary2d_i32, BINARY_I32_DIVU)
+BINARY_EXPORT(vmvx_and2d_i32, binary2d_i32, BINARY_I32_AND)
+BINARY_EXPORT(vmvx_or2d_i32, binary2d_i32, BINARY_I32_OR)
+BINARY_EXPORT(vmvx_xor2d_i32, binary2d_i32, BINARY_I32_XOR)
+BINARY_EXPORT(vmvx_shl2d_i32, binary2d_i32, BINARY_I32_SHL)
+BINARY_EXPORT(vmvx_shrs2d_i32, binary2d_i32, BINARY_I32_SHRS)
+BINARY_EXPORT(vmvx_shru2d_i32, binary2d_i32, BINARY_I32_SHRU)
+UNARY_EXPORT(vmvx_abs2d_f32, UNARY_F32_ABS)
+UNARY_EXPORT(vmvx_neg2d_f32, UNARY_F32_NEG)
+UNARY_EXPORT(vmvx_ceil2d_f32, UNARY_F32_CEIL)
+UNARY_EXPORT(vmvx_floor2d_f32, UNARY_F32_FLOOR)
+UNARY_EXPORT(vmvx_exp2d_f32, UNARY_F32_EXP)
+UNARY_EXPORT(vmvx_log2d_f32, UNARY_F32_LOG)
+UNARY_EXPORT(vmvx_rsqrt2d_f32, UNARY_F32_RSQRT)
+UNARY_EXPORT(vmvx_ctlz2d_i32, UNARY_I32_CTLZ)
+
+//===----------------------------------------------------------------------===//
+// Copy and fill
+//===----------------------------------------------------------------------===//
+
+static iree_status_t copy2d(iree_host_size_t element_size,
+                            const iree_vm_abi_sbk_unary2d_t* args) {
+  const uint8_t* in = NULL;
+  uint8_t* out = NULL;
+  IREE_RETURN_IF_ERROR(
+      map_ro(args->in_ref, args->in_offset,
+             span_length_2d(args->size0, args->in_stride0, args->size1,
+                            args->in_stride1),
+             element_size, (const void**)&in));
+  IREE_RETURN_IF_ERROR(
+      map_rw(args->out_ref, args->out_offset,
+             span_length_2d(args->size0, args->out_stride0, args->size1,
+                            args->out_stride1),
+             element_size, (void**)&out));
+
+  const size_t n = (size_t)args->size1;
+  const ptrdiff_t in_bstride = args->in_stride1 * element_size;
+  const ptrdiff_t out_bstride = args->out_stride1 * element_size;
+  for (int64_t i = 0; i < args->size0; ++i) {
+    const uint8_t* src = in + i * args->in_stride0 * element_size;
+    uint8_t* dst = out + i * args->out_stride0 * element_size;
+    if (args->in_stride1 == 1 && args->out_stride1 == 1) {
+      // Contiguous rows go through the BSP's vectorized memcpy.
+      memcpy(dst, src, n * element_size);
+      continue;
+    }
+    for (size_t j = 0; j < n;) {
+      size_t vl;
+      switch (element_size) {
+        case 1:
+          vl = vsetvl_e8m8(n - j);
+          vsse8_v_u8m8(dst + j * out_bstride, out_bstride,
+                       vlse8_v_u8m8(src + j * in_bstride, in_bstride, vl), vl);
+          break;
+        case 2:
+          vl = vsetvl_e16m8(n - j);
+          vsse16_v_u16m8(
+              (uint16_t*)(dst + j * out_bstride), out_bstride,
+              vlse16_v_u16m8((const uint16_t*)(src + j * in_bstride),
+                             in_bstride, vl),
+              vl);
+          break;
+        case 4:
+          vl = vsetvl_e32m8(n - j);
+          vsse32_v_u32m8(
+              (uint32_t*)(dst + j * out_bstride), out_bstride,
+              vlse32_v_u32m8((const uint32_t*)(src + j * in_bstride),
+                             in_bstride, vl),
+              vl);
+          break;
+        default:
+          // 64-bit elements exceed ELEN=32; copy them scalar.
+          vl = 1;
+          memcpy(dst + j * out_bstride, src + j * in_bstride, element_size);
+          break;
+      }
+      j += vl;
+    }
+  }
+  return iree_ok_status();
+}
+
+#define COPY_EXPORT(name, element_size)                                  \
+  IREE_VM_ABI_EXPORT(name, vmvx_ukernel_module_state_t, sbk_unary2d, v) { \
+    return copy2d(element_size, args);                                   \
+  }
+
+COPY_EXPORT(vmvx_copy2d_x8, sizeof(uint8_t))
+COPY_EXPORT(vmvx_copy2d_x16, sizeof(uint16_t))
+COPY_EXPORT(vmvx_copy2d_x32, sizeof(uint32_t))
+COPY_EXPORT(vmvx_copy2d_x64, sizeof(uint64_t))
+
+IREE_VM_ABI_EXPORT(vmvx_fill2d_x32, vmvx_ukernel_module_state_t, sbk_fill2d,
+                   v) {
+  int32_t* out = NULL;
+  IREE_RETURN_IF_ERROR(map_rw(
+      args->out_ref, args->out_offset,
+      span_length(args->size0, args->out_row_stride, args->size1),
+      sizeof(int32_t), (void**)&out));
+  const size_t n = (size_t)args->size1;
+  // vl only shrinks while strip-mining, so one full-width splat covers all
+  // the stores below.
+  vint32m8_t value = vmv_v_x_i32m8(args->value, vsetvlmax_e32m8());
+  for (int64_t i = 0; i < args->size0; ++i) {
+    int32_t* row = out + i * args->out_row_stride;
+    for (size_t j = 0; j < n;) {
+      size_t vl = vsetvl_e32m8(n - j);
+      vse32_v_i32m8(row + j, value, vl);
+      j += vl;
+    }
+  }
+  return iree_ok_status();
+}
+
+//===----------------------------------------------------------------------===//
+// Matmul
+//===----------------------------------------------------------------------===//
+
+// out[M][N] = (accumulate ? out : 0) + lhs[M][K] * rhs[K][N]
+IREE_VM_ABI_EXPORT(vmvx_matmul_f32f32f32, vmvx_ukernel_module_state_t,
+                   sbk_matmul, v) {
+  const float* lhs = NULL;
+  const float* rhs = NULL;
+  float* out = NULL;
+  IREE_RETURN_IF_ERROR(
+      map_ro(args->lhs_ref, args->lhs_offset,
+             span_length(args->m, args->lhs_row_stride, args->k),
+             sizeof(float), (const void**)&lhs));
+  IREE_RETURN_IF_ERROR(
+      map_ro(args->rhs_ref, args->rhs_offset,
+             span_length(args->k, args->rhs_row_stride, args->n),
+             sizeof(float), (const void**)&rhs));
+  IREE_RETURN_IF_ERROR(
+      map_rw(args->out_ref, args->out_offset,
+             span_length(args->m, args->out_row_stride, args->n),
+             sizeof(float), (void**)&out));
+  const bool accumulate = args->flags & VMVX_MATMUL_FLAG_ACCUMULATE;
+  for (int64_t i = 0; i < args->m; ++i) {
+    float* out_row = out + i * args->out_row_stride;
+    if (!accumulate) memset(out_row, 0, args->n * sizeof(float));
+    for (int64_t kk = 0; kk < args->k; ++kk) {
+      const float a = lhs[i * args->lhs_row_stride + kk];
+      const float* rhs_row = rhs + kk * args->rhs_row_stride;
+      for (int64_t j = 0; j < args->n; ++j) out_row[j] += a * rhs_row[j];
+    }
+  }
+  return iree_ok_status();
+}
+
+// Same as above for int8 inputs. Each output row is built as a sum of
+// sign-extended rhs rows scaled by one lhs element (vmacc.vx).
+IREE_VM_ABI_EXPORT(vmvx_matmul_i8i8i32, vmvx_ukernel_module_state_t,
+                   sbk_matmul, v) {
+  const int8_t* lhs = NULL;
+  const int8_t* rhs = NULL;
+  int32_t* out = NULL;
+  IREE_RETURN_IF_ERROR(
+      map_ro(args->lhs_ref, args->lhs_offset,
+             span_length(args->m, args->lhs_row_stride, args->k),
+             sizeof(int8_t), (const void**)&lhs));
+  IREE_RETURN_IF_ERROR(
+      map_ro(args->rhs_ref, args->rhs_offset,
+             span_length(args->k, args->rhs_row_stride, args->n),
+             sizeof(int8_t), (const void**)&rhs));
+  IREE_RETURN_IF_ERROR(
+      map_rw(args->out_ref, args->out_offset,
+             span_length(args->m, args->out_row_stride, args->n),
+             sizeof(int32_t), (void**)&out));
+  const bool accumulate = args->flags & VMVX_MATMUL_FLAG_ACCUMULATE;
+  const size_t n = (size_t)args->n;
+  for (int64_t i = 0; i < args->m; ++i) {
+    const int8_t* lhs_row = lhs + i * args->lhs_row_stride;
+    int32_t* out_row = out + i * args->out_row_stride;
+    for (size_t j = 0; j < n;) {
+      size_t vl = vsetvl_e32m4(n - j);
+      vint32m4_t acc = accumulate ? vle32_v_i32m4(out_row + j, vl)
+                                  : vmv_v_x_i32m4(0, vl);
+      for (int64_t kk = 0; kk < args->k; ++kk) {
+        vint8m1_t b = vle8_v_i8m1(rhs + kk * args->rhs_row_stride + j, vl);
+        acc = vmacc_vx_i32m4(acc, lhs_row[kk], vsext_vf4_i32m4(b, vl), vl);
+      }
+      vse32_v_i32m4(out_row + j, acc, vl);
+      j += vl;
+    }
+  }
+  return iree_ok_status();
+}
+
+// out[M][N][M0][N0] = (accumulate ? out : 0) +
+//     sum_k lhs[M][k][M0][K0] * transpose(rhs[N][k][N0][K0])
+IREE_VM_ABI_EXPORT(vmvx_mmt4d_f32f32f32, vmvx_ukernel_module_state_t,
+                   sbk_mmt4d, v) {
+  const int64_t lhs_tile_size = (int64_t)args->m0 * args->k0;
+  const int64_t rhs_tile_size = (int64_t)args->n0 * args->k0;
+  const int64_t out_tile_size = (int64_t)args->m0 * args->n0;
+  const float* lhs = NULL;
+  const float* rhs = NULL;
+  float* out = NULL;
+  IREE_RETURN_IF_ERROR(map_ro(
+      args->lhs_ref, args->lhs_offset,
+      span_length(args->m, args->lhs_row_stride, args->k * lhs_tile_size),
+      sizeof(float), (const void**)&lhs));
+  IREE_RETURN_IF_ERROR(map_ro(
+      args->rhs_ref, args->rhs_offset,
+      span_length(args->n, args->rhs_row_stride, args->k * rhs_tile_size),
+      sizeof(float), (const void**)&rhs));
+  IREE_RETURN_IF_ERROR(map_rw(
+      args->out_ref, args->out_offset,
+      span_length(args->m, args->out_row_stride, args->n * out_tile_size),
+      sizeof(float), (void**)&out));
+  const bool accumulate = args->flags & VMVX_MATMUL_FLAG_ACCUMULATE;
+  for (int64_t i = 0; i < args->m; ++i) {
+    for (int64_t j = 0; j < args->n; ++j) {
+      float* out_tile = out + i * args->out_row_stride + j * out_tile_size;
+      if (!accumulate) memset(out_tile, 0, out_tile_size * sizeof(float));
+      for (int64_t kk = 0; kk < args->k; ++kk) {
+        const float* lhs_tile =
+            lhs + i * args->lhs_row_stride + kk * lhs_tile_size;
+        const float* rhs_tile =
+            rhs + j * args->rhs_row_stride + kk * rhs_tile_size;
+        for (int32_t i0 = 0; i0 < args->m0; ++i0) {
+          for (int32_t j0 = 0; j0 < args->n0; ++j0) {
+            float acc = out_tile[i0 * args->n0 + j0];
+            for (int32_t k0 = 0; k0 < args->k0; ++k0) {
+              acc += lhs_tile[i0 * args->k0 + k0] *
+                     rhs_tile[j0 * args->k0 + k0];
+            }
+            out_tile[i0 * args->n0 + j0] = acc;
+          }
+        }
+      }
+    }
+  }
+  return iree_ok_status();
+}
+
+// The int8 tile product keeps one N0-wide accumulator row per M0 row. The
+// rhs columns are gathered from the transposed tile with a K0-byte stride.
+IREE_VM_ABI_EXPORT(vmvx_mmt4d_i8i8i32, vmvx_ukernel_module_state_t, sbk_mmt4d,
+                   v) {
+  const int64_t lhs_tile_size = (int64_t)args->m0 * args->k0;
+  const int64_t rhs_tile_size = (int64_t)args->n0 * args->k0;
+  const int64_t out_tile_size = (int64_t)args->m0 * args->n0;
+  const int8_t* lhs = NULL;
+  const int8_t* rhs = NULL;
+  int32_t* out = NULL;
+  IREE_RETURN_IF_ERROR(map_ro(
+      args->lhs_ref, args->lhs_offset,
+      span_length(args->m, args->lhs_row_stride, args->k * lhs_tile_size),
+      sizeof(int8_t), (const void**)&lhs));
+  IREE_RETURN_IF_ERROR(map_ro(
+      args->rhs_ref, args->rhs_offset,
+      span_length(args->n, args->rhs_row_stride, args->k * rhs_tile_size),
+      sizeof(int8_t), (const void**)&rhs));
+  IREE_RETURN_IF_ERROR(map_rw(
+      args->out_ref, args->out_offset,
+      span_length(args->m, args->out_row_stride, args->n * out_tile_size),
+      sizeof(int32_t), (void**)&out));
+  const bool accumulate = args->flags & VMVX_MATMUL_FLAG_ACCUMULATE;
+  const size_t n0 = (size_t)args->n0;
+  for (int64_t i = 0; i < args->m; ++i) {
+    for (int64_t j = 0; j < args->n; ++j) {
+      int32_t* out_tile = out + i * args->out_row_stride + j * out_tile_size;
+      const int8_t* lhs_tiles = lhs + i * args->lhs_row_stride;
+      const int8_t* rhs_tiles = rhs + j * args->rhs_row_stride;
+      for (int32_t i0 = 0; i0 < args->m0; ++i0) {
+        int32_t* out_row = out_tile + i0 * args->n0;
+        for (size_t j0 = 0; j0 < n0;) {
+          size_t vl = vsetvl_e32m4(n0 - j0);
+          vint32m4_t acc = accumulate ? vle32_v_i32m4(out_row + j0, vl)
+                                      : vmv_v_x_i32m4(0, vl);
+          for (int64_t kk = 0; kk < args->k; ++kk) {
+            const int8_t* lhs_row =
+                lhs_tiles + kk * lhs_tile_size + i0 * args->k0;
+            const int8_t* rhs_col =
+                rhs_tiles + kk * rhs_tile_size + j0 * args->k0;
+            for (int32_t k0 = 0; k0 < args->k0; ++k0) {
+              vint8m1_t b = vlse8_v_i8m1(rhs_col + k0, args->k0, vl);
+              acc = vmacc_vx_i32m4(acc, lhs_row[k0], vsext_vf4_i32m4(b, vl),
+                                   vl);
+            }
+          }
+          vse32_v_i32m4(out_row + j0, acc, vl);
+          j0 += vl;
+        }
+      }
+    }
+  }
+  return iree_ok_status();
+}
+
+//===----------------------------------------------------------------------===//
+// Module registration
+//===----------------------------------------------------------------------===//
+
+// Exports must stay sorted by name; imports are resolved by binary search.
+#define VMVX_UKERNEL_EXPORTS(EXPORT_FN)                                 \
+  EXPORT_FN("abs.2d.f32", vmvx_abs2d_f32, sbk_unary2d, "rIIIrIIIII")    \
+  EXPORT_FN("add.2d.f32", vmvx_add2d_f32, sbk_binary2d, "rIIIrIIIrIIIII") \
+  EXPORT_FN("add.2d.i32", vmvx_add2d_i32, sbk_binary2d, "rIIIrIIIrIIIII") \
+  EXPORT_FN("and.2d.i32", vmvx_and2d_i32, sbk_binary2d, "rIIIrIIIrIIIII") \
+  EXPORT_FN("ceil.2d.f32", vmvx_ceil2d_f32, sbk_unary2d, "rIIIrIIIII")  \
+  EXPORT_FN("copy.2d.x16", vmvx_copy2d_x16, sbk_unary2d, "rIIIrIIIII")  \
+  EXPORT_FN("copy.2d.x32", vmvx_copy2d_x32, sbk_unary2d, "rIIIrIIIII")  \
+  EXPORT_FN("copy.2d.x64", vmvx_copy2d_x64, sbk_unary2d, "rIIIrIIIII")  \
+  EXPORT_FN("copy.2d.x8", vmvx_copy2d_x8, sbk_unary2d, "rIIIrIIIII")    \
+  EXPORT_FN("ctlz.2d.i32", vmvx_ctlz2d_i32, sbk_unary2d, "rIIIrIIIII")  \
+  EXPORT_FN("div.2d.f32", vmvx_div2d_f32, sbk_binary2d, "rIIIrIIIrIIIII") \
+  EXPORT_FN("divs.2d.i32", vmvx_divs2d_i32, sbk_binary2d,               \
+            "rIIIrIIIrIIIII")                                           \
+  EXPORT_FN("divu.2d.i32", vmvx_divu2d_i32, sbk_binary2d,               \
+            "rIIIrIIIrIIIII")                                           \
+  EXPORT_FN("exp.2d.f32", vmvx_exp2d_f32, sbk_unary2d, "rIIIrIIIII")    \
+  EXPORT_FN("fill.2d.x32", vmvx_fill2d_x32, sbk_fill2d, "irIIII")       \
+  EXPORT_FN("floor.2d.f32", vmvx_floor2d_f32, sbk_unary2d, "rIIIrIIIII") \
+  EXPORT_FN("log.2d.f32", vmvx_log2d_f32, sbk_unary2d, "rIIIrIIIII")    \
+  EXPORT_FN("matmul.f32f32f32", vmvx_matmul_f32f32f32, sbk_matmul,      \
+            "rIIrIIrIIIIIi")                                            \
+  EXPORT_FN("matmul.i8i8i32", vmvx_matmul_i8i8i32, sbk_matmul,          \
+            "rIIrIIrIIIIIi")                                            \
+  EXPORT_FN("mmt4d.f32f32f32", vmvx_mmt4d_f32f32f32, sbk_mmt4d,         \
+            "rIIrIIrIIIIIiiii")                                         \
+  EXPORT_FN("mmt4d.i8i8i32", vmvx_mmt4d_i8i8i32, sbk_mmt4d,             \
+            "rIIrIIrIIIIIiiii")                                         \
+  EXPORT_FN("mul.2d.f32", vmvx_mul2d_f32, sbk_binary2d, "rIIIrIIIrIIIII") \
+  EXPORT_FN("mul.2d.i32", vmvx_mul2d_i32, sbk_binary2d, "rIIIrIIIrIIIII") \
+  EXPORT_FN("neg.2d.f32", vmvx_neg2d_f32, sbk_unary2d, "rIIIrIIIII")    \
+  EXPORT_FN("or.2d.i32", vmvx_or2d_i32, sbk_binary2d, "rIIIrIIIrIIIII") \
+  EXPORT_FN("rsqrt.2d.f32", vmvx_rsqrt2d_f32, sbk_unary2d, "rIIIrIIIII") \
+  EXPORT_FN("shl.2d.i32", vmvx_shl2d_i32, sbk_binary2d, "rIIIrIIIrIIIII") \
+  EXPORT_FN("shrs.2d.i32", vmvx_shrs2d_i32, sbk_binary2d,               \
+            "rIIIrIIIrIIIII")                                           \
+  EXPORT_FN("shru.2d.i32", vmvx_shru2d_i32, sbk_binary2d,               \
+            "rIIIrIIIrIIIII")                                           \
+  EXPORT_FN("sub.2d.f32", vmvx_sub2d_f32, sbk_binary2d, "rIIIrIIIrIIIII") \
+  EXPORT_FN("sub.2d.i32", vmvx_sub2d_i32, sbk_binary2d, "rIIIrIIIrIIIII") \
+  EXPORT_FN("xor.2d.i32", vmvx_xor2d_i32, sbk_binary2d, "rIIIrIIIrIIIII")
+
+static const iree_vm_native_function_ptr_t vmvx_ukernel_module_funcs_[] = {
+#define EXPORT_FN(name, target_fn, shim_types, cconv)          \
+  {                                                            \
+      .shim = (iree_vm_native_function_shim_t)                 \
+          iree_vm_shim_##shim_types##_v,                       \
+      .target = (iree_vm_native_function_target_t)(target_fn), \
+  },
+    VMVX_UKERNEL_EXPORTS(EXPORT_FN)
+#undef EXPORT_FN
+};
+
+static const iree_vm_native_export_descriptor_t
+    vmvx_ukernel_module_exports_[] = {
+#define EXPORT_FN(name, target_fn, shim_types, cconv)                   \
+  {                                                                     \
+      .local_name = iree_string_view_literal(name),                     \
+      .calling_convention = iree_string_view_literal("0" cconv "_v"),   \
+      .attr_count = 0,                                                  \
+      .attrs = NULL,                                                    \
+  },
+        VMVX_UKERNEL_EXPORTS(EXPORT_FN)
+#undef EXPORT_FN
+};
+
+static const iree_vm_native_module_descriptor_t
+    vmvx_ukernel_module_descriptor_ = {
+        .name = iree_string_view_literal("vmvx"),
+        .version = VMVX_UKERNEL_MODULE_VERSION,
+        .attr_count = 0,
+        .attrs = NULL,
+        .dependency_count = 0,
+        .dependencies = NULL,
+        .import_count = 0,
+        .imports = NULL,
+        .export_count = IREE_ARRAYSIZE(vmvx_ukernel_module_exports_),
+        .exports = vmvx_ukernel_module_exports_,
+        .function_count = IREE_ARRAYSIZE(vmvx_ukernel_module_funcs_),
+        .functions = vmvx_ukernel_module_funcs_,
+};
+
+iree_status_t create_vmvx_ukernel_module(iree_vm_instance_t* instance,
+                                         iree_allocator_t host_allocator,
+                                         iree_vm_module_t** out_module) {
+  IREE_ASSERT_ARGUMENT(out_module);
+  *out_module = NULL;
+
+  static const iree_vm_module_t interface = {
+      .destroy = vmvx_ukernel_module_destroy,
+      .alloc_state = vmvx_ukernel_module_alloc_state,
+      .free_state = vmvx_ukernel_module_free_state,
+  };
+
+  iree_host_size_t total_size =
+      iree_vm_native_module_size() + sizeof(vmvx_ukernel_module_t);
+  iree_vm_module_t* base_module = NULL;
+  IREE_RETURN_IF_ERROR(
+      iree_allocator_malloc(host_allocator, total_size, (void**)&base_module));
+  memset(base_module, 0, total_size);
+  iree_status_t status = iree_vm_native_module_initialize(
+      &interface, &vmvx_ukernel_module_descriptor_, instance, host_allocator,
+      base_module);
+  if (!iree_status_is_ok(status)) {
+    iree_allocator_free(host_allocator, base_module);
+    return status;
+  }
+
+  vmvx_ukernel_module_t* module = VMVX_UKERNEL_MODULE_CAST(base_module);
+  module->host_allocator = host_allocator;
+
+  *out_module = base_module;
+  return iree_ok_status();
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLES_DEVICE_VMVX_UKERNEL_MODULE_H_
+#define SAMPLES_DEVICE_VMVX_UKERNEL_MODULE_H_
+
+#include "iree/base/api.h"
+#include "iree/vm/api.h"
+
+// Create a native VM module named "vmvx" that implements the VMVX microkernel
+// imports with RVV. It exports the same functions as IREE's reference vmvx
+// module, so it can be registered after it (as a VMVX loader user module, or
+// directly in an inline HAL context) and take over the import resolution.
+// The module must be released by the caller.
+iree_status_t create_vmvx_ukernel_module(iree_vm_instance_t* instance,
+                                         iree_allocator_t host_allocator,
+                                         iree_vm_module_t** out_module);
+
+#endif  // SAMPLES_DEVICE_VMVX_UKERNEL_MODULE_H_
@@ -0,0 +1,274 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "samples/device/weight_streamer.h"
+
+#include <springbok.h>
+#include <stdlib.h>
+
+// Provided by springbok.ld.
+extern const char _sext_rodata[];
+extern const char _eext_rodata[];
+// Value of the __stream_buffer_size__ link option, 0 without one.
+extern const char __stream_buffer_size__[] __attribute__((weak));
+
+// Spans start on this alignment, so the staged bindings keep the alignment of
+// the constants they point to.
+#define SPAN_ALIGNMENT 64
+
+// Bytes of external memory, empty if `length` is 0.
+typedef struct {
+  uintptr_t start;
+  uint32_t length;
+} span_t;
+
+typedef struct {
+  uint8_t* data;
+  // Span the buffer holds, or holds once the copy engine is done with it.
+  span_t span;
+} staging_buffer_t;
+
+// A span seen in a dispatch and the one the next dispatch needed.
+typedef struct {
+  span_t span;
+  int32_t next;  // Index of the next record, -1 until known.
+} span_record_t;
+
+static staging_buffer_t buffers[2];
+static uint32_t buffer_size = 0;
+// Buffer the last staged dispatch ran from; the other one takes the prefetch.
+static int current = 0;
+
+// Spans in the order of their first use.
+static span_record_t records[WEIGHT_STREAMER_MAX_SPANS];
+static uint32_t record_count = 0;
+static int32_t last_record = -1;
+
+// Dispatch being run, and its state with the bindings redirected into the
+// staging buffer, valid while `staged`.
+static const iree_hal_executable_dispatch_state_v0_t* source_state = NULL;
+static iree_hal_executable_dispatch_state_v0_t staged_state;
+static void* staged_ptrs[WEIGHT_STREAMER_MAX_BINDINGS];
+static bool staged = false;
+
+// Streaming statistics, reported at exit.
+static uint32_t external_dispatches = 0;
+static uint32_t ahead = 0;
+static uint32_t on_demand = 0;
+static uint32_t in_place = 0;
+static uint32_t copied_bytes = 0;
+static uint32_t in_place_bytes = 0;
+static uint32_t stall_cycles = 0;
+
+static bool is_external(const void* ptr) {
+  return (const char*)ptr >= _sext_rodata && (const char*)ptr < _eext_rodata;
+}
+
+// Span of external memory the bindings of `dispatch_state` point into.
+static span_t external_span(
+    const iree_hal_executable_dispatch_state_v0_t* dispatch_state) {
+  uintptr_t start = UINTPTR_MAX;
+  uintptr_t end = 0;
+  for (uint32_t i = 0; i < dispatch_state->binding_count; ++i) {
+    uintptr_t ptr = (uintptr_t)dispatch_state->binding_ptrs[i];
+    if (is_external((const void*)ptr)) {
+      start = ptr < start ? ptr : start;
+      end = ptr + dispatch_state->binding_lengths[i] > end
+                ? ptr + dispatch_state->binding_lengths[i]
+                : end;
+    }
+  }
+  if (end == 0) {
+    return (span_t){0, 0};
+  }
+  start &= ~(uintptr_t)(SPAN_ALIGNMENT - 1);
+  return (span_t){start, (uint32_t)(end - start)};
+}
+
+static bool span_contains(span_t outer, span_t inner) {
+  return outer.length > 0 && inner.start >= outer.start &&
+         inner.start + inner.length <= outer.start + outer.length;
+}
+
+// Record `span` as the one after the span of the previous dispatch, and
+// return its index, -1 once the records are full.
+static int32_t record_span(span_t span) {
+  int32_t index = -1;
+  for (uint32_t i = 0; i < record_count && index < 0; ++i) {
+    if (records[i].span.start == span.start &&
+        records[i].span.length == span.length) {
+      index = (int32_t)i;
+    }
+  }
+  if (index < 0 && record_count < WEIGHT_STREAMER_MAX_SPANS) {
+    index = (int32_t)record_count++;
+    records[index].span = span;
+    records[index].next = -1;
+  }
+  if (last_record >= 0 && index >= 0) {
+    records[last_record].next = index;
+  }
+  last_record = index;
+  return index;
+}
+
+// The span that followed `span` before, or else a buffer of the bytes after
+// it.
+static span_t predict_next(span_t span, int32_t index) {
+  if (index >= 0 && records[index].next >= 0) {
+    return records[records[index].next].span;
+  }
+  uintptr_t start =
+      (span.start + span.length) & ~(uintptr_t)(SPAN_ALIGNMENT - 1);
+  uintptr_t end = start + buffer_size;
+  if (end > (uintptr_t)_eext_rodata) {
+    end = (uintptr_t)_eext_rodata;
+  }
+  return (span_t){start, end > start ? (uint32_t)(end - start) : 0};
+}
+
+// Start the copy engine on `span` into `buffer`.
+static void copy_span(staging_buffer_t* buffer, span_t span) {
+  const uint32_t args[3] = {(uint32_t)(uintptr_t)buffer->data,
+                            (uint32_t)span.start, span.length};
+  if (springbok_dma(SPRINGBOK_DMA_COPY, args) < 0) {
+    buffer->span = (span_t){0, 0};
+    return;
+  }
+  buffer->span = span;
+  copied_bytes += span.length;
+}
+
+// Run the dispatch of `span` on its own bindings. The core then streams the
+// span from the external memory itself, which is charged as a read of the
+// copy engine, waited for before the dispatch like a copy on demand.
+static void read_in_place(span_t span) {
+  const uint32_t args[2] = {(uint32_t)span.start, span.length};
+  springbok_dma(SPRINGBOK_DMA_READ, args);
+  stall_cycles += springbok_dma(SPRINGBOK_DMA_WAIT, NULL);
+  ++in_place;
+  in_place_bytes += span.length;
+}
+
+// Start the copy engine on the span of the dispatch after the one of `span`,
+// into the buffer the current dispatch does not run from.
+static void prefetch_next(span_t span, int32_t index) {
+  span_t next = predict_next(span, index);
+  staging_buffer_t* other = &buffers[current ^ 1];
+  if (next.length > 0 && next.length <= buffer_size &&
+      !span_contains(buffers[current].span, next) &&
+      !span_contains(other->span, next)) {
+    copy_span(other, next);
+  }
+}
+
+// Stage the external span of the dispatch and redirect its bindings into the
+// staging buffer, then prefetch the span of the next dispatch. Returns false
+// if the dispatch runs on its own bindings.
+static bool stage_dispatch(
+    const iree_hal_executable_dispatch_state_v0_t* dispatch_state) {
+  span_t span = external_span(dispatch_state);
+  if (span.length == 0) {
+    return false;
+  }
+  ++external_dispatches;
+  int32_t index = record_span(span);
+  if (span.length > buffer_size ||
+      dispatch_state->binding_count > WEIGHT_STREAMER_MAX_BINDINGS) {
+    read_in_place(span);
+    prefetch_next(span, index);
+    return false;
+  }
+
+  staging_buffer_t* buffer = NULL;
+  for (int i = 0; i < 2 && !buffer; ++i) {
+    if (span_contains(buffers[i].span, span)) {
+      buffer = &buffers[i];
+    }
+  }
+  if (buffer) {
+    ++ahead;
+  } else {
+    // The span of the last dispatch may still serve the next one.
+    buffer = &buffers[current ^ 1];
+    copy_span(buffer, span);
+    if (buffer->span.length == 0) {
+      read_in_place(span);
+      return false;
+    }
+    ++on_demand;
+  }
+  stall_cycles += springbok_dma(SPRINGBOK_DMA_WAIT, NULL);
+  current = (int)(buffer - buffers);
+
+  staged_state = *dispatch_state;
+  for (uint32_t i = 0; i < dispatch_state->binding_count; ++i) {
+    char* ptr = (char*)dispatch_state->binding_ptrs[i];
+    staged_ptrs[i] =
+        is_external(ptr) ? buffer->data + ((uintptr_t)ptr - buffer->span.start)
+                         : (uint8_t*)ptr;
+  }
+  staged_state.binding_ptrs = staged_ptrs;
+
+  prefetch_next(span, index);
+  return true;
+}
+
+static int streamer_dispatch_hook(
+    const library_export_t* library_export,
+    const iree_hal_executable_environment_v0_t* environment,
+    const iree_hal_executable_dispatch_state_v0_t* dispatch_state,
+    const iree_hal_executable_workgroup_state_v0_t* workgroup_state) {
+  if ((workgroup_state->workgroup_id_x | workgroup_state->workgroup_id_y |
+       workgroup_state->workgroup_id_z) == 0) {
+    source_state = dispatch_state;
+    staged = stage_dispatch(dispatch_state);
+  }
+  if (staged && dispatch_state == source_state) {
+    dispatch_state = &staged_state;
+  }
+  return library_export_call(library_export, environment, dispatch_state,
+                             workgroup_state);
+}
+
+__attribute__((destructor)) static void streamer_report(void) {
+  LOG_INFO("weight streaming: %u-byte buffers, %u bytes of external constants",
+           (unsigned)buffer_size, (unsigned)(_eext_rodata - _sext_rodata));
+  LOG_INFO("weight streaming: %u dispatches, %u staged ahead, %u on demand, "
+           "%u in place",
+           (unsigned)external_dispatches, (unsigned)ahead, (unsigned)on_demand,
+           (unsigned)in_place);
+  LOG_INFO("weight streaming: %u bytes copied, %u bytes read in place, "
+           "%u cycles stalled",
+           (unsigned)copied_bytes, (unsigned)in_place_bytes,
+           (unsigned)stall_cycles);
+}
+
+void weight_streamer_install(void) {
+  buffer_size = (uint32_t)(uintptr_t)__stream_buffer_size__;
+  if (buffer_size == 0) {
+    buffer_size = WEIGHT_STREAMER_BUFFER_SIZE;
+  }
+  for (int i = 0; i < 2; ++i) {
+    buffers[i].data = aligned_alloc(SPAN_ALIGNMENT, buffer_size);
+    if (!buffers[i].data) {
+      LOG_ERROR("weight streaming: no room for a %u-byte buffer",
+                (unsigned)buffer_size);
+      return;
+    }
+  }
+  library_wrapper_set_hook(streamer_dispatch_hook);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLES_DEVICE_WEIGHT_STREAMER_H_
+#define SAMPLES_DEVICE_WEIGHT_STREAMER_H_
+
+// Streams the weights of a model linked into the external memory through
+// DTCM, a layer at a time.
+//
+// A module built with EXT_CONSTANTS keeps its constants in .ext_rodata, and
+// the heap allocator maps them in place, so the weight bindings of a dispatch
+// point into the external memory. With the streamer installed, the first
+// workgroup of such a dispatch finds the span of external memory its bindings
+// cover staged in one of two DTCM buffers, and every workgroup runs with the
+// bindings redirected there. Right after, the copy engine starts on the span
+// of the next dispatch into the other buffer, so it loads while the current
+// dispatch computes.
+//
+// The next span is the one that followed the current span before, once a
+// first inference has recorded their order, and otherwise a buffer of the
+// bytes right after the current span, as the compiler lays the constants out
+// in the order the dispatches use them. A span the prefetch missed is copied
+// on demand. A span larger than a buffer is read in place, at the cost of a
+// read of the copy engine of the simulator.
+//
+// Each buffer holds __stream_buffer_size__ bytes (a link option, default
+// WEIGHT_STREAMER_BUFFER_SIZE) of the heap.
+
+#include <stdint.h>
+
+#include "samples/device/library_wrapper.h"
+
+#define WEIGHT_STREAMER_BUFFER_SIZE (256 * 1024)
+// Upper bound on the weight spans the prefetch remembers the order of.
+#define WEIGHT_STREAMER_MAX_SPANS 256
+// Upper bound on the bindings of a staged dispatch.
+#define WEIGHT_STREAMER_MAX_BINDINGS 32
+
+// Installs the streamer as the dispatch hook of the wrapped libraries.
+void weight_streamer_install(void);
+
+#endif  // SAMPLES_DEVICE_WEIGHT_STREAMER_H_
@@ -24,18 +24,4 @@ typedef struct {
   float best_out;
 } MnistOutput;
 
-const MlModel kModel = {
-    .num_input = 1,
-    .num_input_dim = {4},
-    .input_shape = {{1, 28, 28, 1}},
-    .input_length = {28 * 28 * 1},
-    .input_size_bytes = {sizeof(float)},
-    .num_output = 1,
-    .output_length = {10},
-    .output_size_bytes = sizeof(float),
-    .hal_element_type = IREE_HAL_ELEMENT_TYPE_FLOAT_32,
-    .entry_func = "module.predict",
-    .model_name = "mnist",
-};
-
 #endif  // SAMPLES_FLOAT_MODEL_MNIST_H_
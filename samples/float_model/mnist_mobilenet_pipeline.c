@@ -0,0 +1,202 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// mnist gate ahead of the mobilenet_v1_0.25_224 float model. Each frame is
+// written into the mobilenet input once, and the mnist input averages its 8x8
+// blocks into 28x28 grayscale, so both stages read the same frame and
+// mobilenet only runs on the frames mnist is confident about.
+
+#include <springbok.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "samples/float_model/mnist_bytecode_module_static.h"
+#include "samples/float_model/mnist_bytecode_module_static_c.h"
+#include "samples/float_model/mnist_input_c.h"
+#include "samples/float_model/mnist_model.h"
+#include "samples/float_model/mobilenet_v1_bytecode_module_static.h"
+#include "samples/float_model/mobilenet_v1_bytecode_module_static_c.h"
+#define MOBILENET_V1_DESCRIPTOR kMobilenetModel
+#include "samples/float_model/mobilenet_v1_model.h"
+#include "samples/util/pipeline.h"
+
+// Confidence mnist needs in its top digit for mobilenet to run on the frame,
+// more than all the other digits together.
+#define GATE_THRESHOLD 0.5f
+#define NUM_FRAMES 8
+
+#define FRAME_SIZE 224
+#define FRAME_CHANNELS 3
+#define GATE_SIZE 28
+#define GATE_SCALE (FRAME_SIZE / GATE_SIZE)
+
+_Static_assert(MOBILENET_V1_INPUT_0_LENGTH ==
+                   FRAME_SIZE * FRAME_SIZE * FRAME_CHANNELS,
+               "frame does not match the mobilenet input");
+_Static_assert(MNIST_INPUT_0_LENGTH == GATE_SIZE * GATE_SIZE,
+               "gate input does not match the mnist input");
+_Static_assert(sizeof(mnist_input) == MNIST_INPUT_0_SIZE_BYTES,
+               "input digit does not match the mnist input");
+
+static iree_status_t create_mobilenet_module(iree_vm_instance_t *instance,
+                                             iree_vm_module_t **module) {
+  const struct iree_file_toc_t *module_file_toc =
+      samples_float_model_mobilenet_v1_bytecode_module_static_create();
+  return iree_vm_bytecode_module_create(
+      instance,
+      iree_make_const_byte_span(module_file_toc->data, module_file_toc->size),
+      iree_allocator_null(), iree_allocator_system(), module);
+}
+
+iree_status_t create_module(iree_vm_instance_t *instance,
+                            iree_vm_module_t **module) {
+  const struct iree_file_toc_t *module_file_toc =
+      samples_float_model_mnist_bytecode_module_static_create();
+  return iree_vm_bytecode_module_create(
+      instance,
+      iree_make_const_byte_span(module_file_toc->data, module_file_toc->size),
+      iree_allocator_null(), iree_allocator_system(), module);
+}
+
+iree_hal_executable_library_query_fn_t library_query(void) {
+  return &mnist_linked_llvm_cpu_library_query;
+}
+
+// Write a frame into the mobilenet input: the mnist test digit scaled up in
+// gray if `with_digit`, black, the -1 end of the input range, otherwise.
+static void write_frame(bool with_digit) {
+  float *frame = (float *)kMobilenetModel.inputs[0].data;
+  // The embedded digit is a byte array, without the alignment of a float.
+  float digit[GATE_SIZE * GATE_SIZE];
+  memcpy(digit, mnist_input, sizeof(digit));
+  for (int y = 0; y < FRAME_SIZE; ++y) {
+    for (int x = 0; x < FRAME_SIZE; ++x) {
+      float value =
+          with_digit
+              ? -1.0f + 2.0f * digit[(y / GATE_SCALE) * GATE_SIZE +
+                                     x / GATE_SCALE]
+              : -1.0f;
+      for (int c = 0; c < FRAME_CHANNELS; ++c) {
+        frame[(y * FRAME_SIZE + x) * FRAME_CHANNELS + c] = value;
+      }
+    }
+  }
+}
+
+// Average the 8x8 blocks of the frame in the mobilenet input into the mnist
+// input, in grayscale and in the 0 to 1 range of mnist.
+static void downscale_frame(void) {
+  const float *frame = (const float *)kMobilenetModel.inputs[0].data;
+  float *gate = (float *)kModel.inputs[0].data;
+  for (int y = 0; y < GATE_SIZE; ++y) {
+    for (int x = 0; x < GATE_SIZE; ++x) {
+      float sum = 0.0f;
+      for (int dy = 0; dy < GATE_SCALE; ++dy) {
+        const float *row = &frame[((y * GATE_SCALE + dy) * FRAME_SIZE +
+                                   x * GATE_SCALE) *
+                                  FRAME_CHANNELS];
+        for (int i = 0; i < GATE_SCALE * FRAME_CHANNELS; ++i) {
+          sum += row[i];
+        }
+      }
+      float mean = sum / (GATE_SCALE * GATE_SCALE * FRAME_CHANNELS);
+      gate[y * GATE_SIZE + x] = (mean + 1.0f) * 0.5f;
+    }
+  }
+}
+
+iree_status_t load_input_data(const MlModel *model, iree_host_size_t index,
+                              iree_byte_span_t buffer) {
+  if (model == &kMobilenetModel) {
+    write_frame(true);
+  } else {
+    downscale_frame();
+  }
+  return iree_ok_status();
+}
+
+// The odd frames show the digit and the even ones are black, so mobilenet runs
+// on half of the frames.
+static iree_status_t load_frame(const MlPipeline *pipeline, uint32_t frame) {
+  write_frame(frame % 2 == 1);
+  downscale_frame();
+  return iree_ok_status();
+}
+
+// Top digit probability of mnist, 0 on a black frame, which has no digit for
+// mnist to read.
+static float gate_confidence(const MlModel *model,
+                             const iree_hal_buffer_mapping_t *outputs) {
+  const float *gate = (const float *)kModel.inputs[0].data;
+  bool blank = true;
+  for (int i = 0; i < GATE_SIZE * GATE_SIZE && blank; ++i) {
+    blank = gate[i] <= 0.0f;
+  }
+  if (blank) {
+    return 0.0f;
+  }
+  const float *scores = (const float *)outputs[0].contents.data;
+  float best = 0.0f;
+  for (int i = 0; i < model->outputs[0].length; ++i) {
+    best = scores[i] > best ? scores[i] : best;
+  }
+  return best;
+}
+
+iree_status_t process_output(const MlModel *model,
+                             iree_hal_buffer_mapping_t *buffers,
+                             uint32_t *output_length) {
+  // find the label index with best prediction
+  const float *scores = (const float *)buffers[0].contents.data;
+  int best_idx = 0;
+  for (int i = 1; i < model->outputs[0].length; ++i) {
+    if (scores[i] > scores[best_idx]) {
+      best_idx = i;
+    }
+  }
+  if (model == &kMobilenetModel) {
+    LOG_INFO("Image prediction result is: id: %d", best_idx + 1);
+  } else {
+    LOG_INFO("Digit recognition result is: digit: %d", best_idx);
+  }
+  *output_length = model->outputs[0].size_bytes;
+  return iree_ok_status();
+}
+
+static const MlPipelineStage kStages[] = {
+    {
+        .model = &kModel,
+        .create_module = create_module,
+        .library_query = &mnist_linked_llvm_cpu_library_query,
+        .confidence = gate_confidence,
+        .threshold = GATE_THRESHOLD,
+    },
+    {
+        .model = &kMobilenetModel,
+        .create_module = create_mobilenet_module,
+        .library_query = &mobilenet_v1_linked_llvm_cpu_library_query,
+    },
+};
+
+static const MlPipeline kPipeline = {
+    .name = "mnist_mobilenet_pipeline",
+    .num_stages = IREE_ARRAYSIZE(kStages),
+    .stages = kStages,
+    .num_frames = NUM_FRAMES,
+    .load_frame = load_frame,
+};
+
+const MlPipeline *ml_pipeline(void) { return &kPipeline; }
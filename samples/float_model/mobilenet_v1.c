@@ -15,15 +15,16 @@
  */
 
 // Mobilenet_v1_0.25_224 float model
-// MlModel struct initialization to include model I/O info.
 // Bytecode loading, input/output processes.
 
 #include "mobilenet_v1.h"
 
 #include <springbok.h>
+#include <string.h>
 
 // Compiled module embedded here to avoid file IO:
 #include "samples/float_model/mobilenet_input_c.h"
+#include "samples/float_model/mobilenet_v1_model.h"
 #if !defined(BUILD_EMITC)
 #include "samples/float_model/mobilenet_v1_bytecode_module_static.h"
 #include "samples/float_model/mobilenet_v1_bytecode_module_static_c.h"
@@ -52,11 +53,12 @@ iree_hal_executable_library_query_fn_t library_query(void) {
   return &mobilenet_v1_linked_llvm_cpu_library_query;
 }
 
-iree_status_t load_input_data(const MlModel *model, void **buffer,
-                              iree_const_byte_span_t **byte_span) {
-  byte_span[0] = malloc(sizeof(iree_const_byte_span_t));
-  *byte_span[0] = iree_make_const_byte_span(
-      mobilenet_input, model->input_size_bytes[0] * model->input_length[0]);
+_Static_assert(sizeof(mobilenet_input) == MOBILENET_V1_INPUT_0_SIZE_BYTES,
+               "input image does not match the model input");
+
+iree_status_t load_input_data(const MlModel *model, iree_host_size_t index,
+                              iree_byte_span_t buffer) {
+  memcpy(buffer.data, mobilenet_input, buffer.data_length);
   return iree_ok_status();
 }
 
@@ -67,7 +69,7 @@ iree_status_t process_output(const MlModel *model,
   // find the label index with best prediction
   float best_out = 0.0;
   int best_idx = -1;
-  for (int i = 0; i < model->output_length[0]; ++i) {
+  for (int i = 0; i < model->outputs[0].length; ++i) {
     float out = ((float *)buffers[0].contents.data)[i];
     if (out > best_out) {
       best_out = out;
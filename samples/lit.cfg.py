@@ -46,3 +46,7 @@ if features_param:
     config.available_features.update(features_param.split(','))
 
 config.environment["TEST_RUNNER_CMD"] = renode_cmd
+
+# Run the tests on a renode_server.py pool when one is up.
+if "RENODE_SERVER" in os.environ:
+    config.environment["RENODE_SERVER"] = os.environ["RENODE_SERVER"]
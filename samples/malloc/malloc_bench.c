@@ -0,0 +1,531 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Allocation latency and fragmentation of the springbok BSP TLSF allocator,
+// compared with a reference of newlib-nano's malloc (a first-fit free list
+// sorted by address, on top of a grow-only sbrk). The BSP replaces newlib's
+// malloc, so the reference follows nano-mallocr.c on a pool of its own, the
+// way memops_bench compares against a byte loop.
+//
+// Two workloads run on each allocator, from a fresh pool of the same size:
+//   inference: what the IREE runtime does across invocations. Small VM and
+//       HAL bookkeeping objects, 64-byte aligned transient tensors freed once
+//       their consumer layer ran, a list grown by realloc, and a few objects
+//       kept alive across invocations.
+//   churn: random sizes allocated, reallocated and freed in random order.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "springbok.h"
+#include "springbok_tlsf.h"
+
+#define POOL_SIZE (1 << 20)
+#define TENSOR_ALIGNMENT 64
+
+static uint8_t tlsf_pool[POOL_SIZE] __attribute__((aligned(64)));
+static uint8_t ref_pool[POOL_SIZE] __attribute__((aligned(64)));
+
+//------------------------------------------------------------------------------
+// Reference: newlib-nano's malloc
+//------------------------------------------------------------------------------
+
+typedef struct ref_chunk {
+  intptr_t size;  // Chunk bytes, header included.
+  struct ref_chunk *next;
+} ref_chunk;
+
+#define REF_CHUNK_OFFSET (offsetof(ref_chunk, next))
+#define REF_CHUNK_ALIGN (sizeof(void *))
+#define REF_MALLOC_ALIGN 8
+#define REF_MALLOC_PADDING (REF_MALLOC_ALIGN - REF_CHUNK_ALIGN)
+#define REF_MIN_CHUNK \
+  (REF_CHUNK_OFFSET + REF_MALLOC_PADDING + sizeof(ref_chunk))
+#define REF_ALIGN_TO(size, align) (((size) + (align)-1) & ~((align)-1))
+
+static ref_chunk *ref_free_list;
+static uint8_t *ref_brk;
+
+static void ref_reset(void) {
+  ref_free_list = NULL;
+  ref_brk = ref_pool;
+}
+
+static void *ref_sbrk(size_t size) {
+  uint8_t *base = (uint8_t *)REF_ALIGN_TO((uintptr_t)ref_brk, REF_CHUNK_ALIGN);
+  if (base + size > ref_pool + POOL_SIZE) {
+    return NULL;
+  }
+  ref_brk = base + size;
+  return base;
+}
+
+static ref_chunk *ref_chunk_of(void *ptr) {
+  ref_chunk *chunk = (ref_chunk *)((uint8_t *)ptr - REF_CHUNK_OFFSET);
+  // A negative size is the offset back to the chunk of an aligned pointer.
+  intptr_t offset = *(intptr_t *)chunk;
+  return offset < 0 ? (ref_chunk *)((uint8_t *)chunk + offset) : chunk;
+}
+
+static void *ref_malloc(size_t size) {
+  size_t alloc_size = REF_ALIGN_TO(size, REF_CHUNK_ALIGN) +
+                      REF_MALLOC_PADDING + REF_CHUNK_OFFSET;
+  if (alloc_size < REF_MIN_CHUNK) {
+    alloc_size = REF_MIN_CHUNK;
+  }
+
+  // First fit, splitting the tail off a larger chunk.
+  ref_chunk *prev = ref_free_list;
+  ref_chunk *chunk = ref_free_list;
+  while (chunk) {
+    intptr_t rem = chunk->size - (intptr_t)alloc_size;
+    if (rem >= 0) {
+      if (rem >= (intptr_t)REF_MIN_CHUNK) {
+        chunk->size = rem;
+        chunk = (ref_chunk *)((uint8_t *)chunk + rem);
+        chunk->size = alloc_size;
+      } else if (prev == chunk) {
+        ref_free_list = chunk->next;
+      } else {
+        prev->next = chunk->next;
+      }
+      break;
+    }
+    prev = chunk;
+    chunk = chunk->next;
+  }
+
+  if (!chunk) {
+    chunk = ref_sbrk(alloc_size);
+    if (!chunk) {
+      return NULL;
+    }
+    chunk->size = alloc_size;
+  }
+
+  uint8_t *ptr = (uint8_t *)chunk + REF_CHUNK_OFFSET;
+  uint8_t *aligned = (uint8_t *)REF_ALIGN_TO((uintptr_t)ptr, REF_MALLOC_ALIGN);
+  if (aligned != ptr) {
+    *(intptr_t *)((uint8_t *)chunk + (aligned - ptr)) = -(aligned - ptr);
+  }
+  return aligned;
+}
+
+static void ref_free(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+  ref_chunk *chunk = ref_chunk_of(ptr);
+  if (!ref_free_list || chunk < ref_free_list) {
+    if (ref_free_list &&
+        (uint8_t *)chunk + chunk->size == (uint8_t *)ref_free_list) {
+      chunk->size += ref_free_list->size;
+      chunk->next = ref_free_list->next;
+    } else {
+      chunk->next = ref_free_list;
+    }
+    ref_free_list = chunk;
+    return;
+  }
+
+  // Insert in address order, merging with the neighbors.
+  ref_chunk *prev = ref_free_list;
+  while (prev->next && prev->next <= chunk) {
+    prev = prev->next;
+  }
+  if ((uint8_t *)prev + prev->size == (uint8_t *)chunk) {
+    prev->size += chunk->size;
+    if ((uint8_t *)prev + prev->size == (uint8_t *)prev->next) {
+      prev->size += prev->next->size;
+      prev->next = prev->next->next;
+    }
+  } else if (prev->next &&
+             (uint8_t *)chunk + chunk->size == (uint8_t *)prev->next) {
+    chunk->size += prev->next->size;
+    chunk->next = prev->next->next;
+    prev->next = chunk;
+  } else {
+    chunk->next = prev->next;
+    prev->next = chunk;
+  }
+}
+
+static void *ref_memalign(size_t alignment, size_t size) {
+  if (alignment <= REF_MALLOC_ALIGN) {
+    return ref_malloc(size);
+  }
+  size_t padded = REF_ALIGN_TO(size, REF_CHUNK_ALIGN) + alignment -
+                  REF_MALLOC_ALIGN;
+  uint8_t *ptr = ref_malloc(padded);
+  if (!ptr) {
+    return NULL;
+  }
+  ref_chunk *chunk = ref_chunk_of(ptr);
+  uint8_t *aligned = (uint8_t *)REF_ALIGN_TO((uintptr_t)ptr, alignment);
+  intptr_t front_size = aligned - REF_CHUNK_OFFSET - (uint8_t *)chunk;
+  if (front_size >= (intptr_t)REF_MIN_CHUNK) {
+    // Free the front of the chunk as a chunk of its own.
+    ref_chunk *front = chunk;
+    chunk = (ref_chunk *)(aligned - REF_CHUNK_OFFSET);
+    chunk->size = front->size - front_size;
+    front->size = front_size;
+    ref_free((uint8_t *)front + REF_CHUNK_OFFSET);
+  } else if (front_size) {
+    *(intptr_t *)(aligned - REF_CHUNK_OFFSET) = -front_size;
+  }
+  return aligned;
+}
+
+static void *ref_realloc(void *ptr, size_t size) {
+  if (!ptr) {
+    return ref_malloc(size);
+  }
+  if (!size) {
+    ref_free(ptr);
+    return NULL;
+  }
+  ref_chunk *chunk = ref_chunk_of(ptr);
+  size_t old_size = (uint8_t *)chunk + chunk->size - (uint8_t *)ptr;
+  // Kept in place while it shrinks by less than half.
+  if (size <= old_size && (old_size >> 1) < size) {
+    return ptr;
+  }
+  void *moved = ref_malloc(size);
+  if (moved) {
+    memcpy(moved, ptr, size < old_size ? size : old_size);
+    ref_free(ptr);
+  }
+  return moved;
+}
+
+// Free bytes in the free list and above the break, and the largest free
+// region. The chunk ending at the break merges with the space above it.
+static void ref_stats(size_t *free_bytes, size_t *largest) {
+  size_t top = ref_pool + POOL_SIZE - ref_brk;
+  *free_bytes = top;
+  *largest = top;
+  for (ref_chunk *chunk = ref_free_list; chunk; chunk = chunk->next) {
+    size_t size = chunk->size;
+    *free_bytes += size;
+    if ((uint8_t *)chunk + size == ref_brk) {
+      size += top;
+    }
+    if (size > *largest) {
+      *largest = size;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Allocators under test
+//------------------------------------------------------------------------------
+
+static springbok_tlsf_t *tlsf;
+
+static void tlsf_reset(void) {
+  tlsf = springbok_tlsf_create(tlsf_pool, POOL_SIZE);
+}
+
+static void *tlsf_malloc(size_t size) {
+  return springbok_tlsf_malloc(tlsf, size);
+}
+
+static void *tlsf_memalign(size_t alignment, size_t size) {
+  return springbok_tlsf_memalign(tlsf, alignment, size);
+}
+
+static void *tlsf_realloc(void *ptr, size_t size) {
+  return springbok_tlsf_realloc(tlsf, ptr, size);
+}
+
+static void tlsf_free(void *ptr) { springbok_tlsf_free(tlsf, ptr); }
+
+static unsigned int tlsf_fragmentation(void) {
+  springbok_tlsf_stats_t stats;
+  springbok_tlsf_stats(tlsf, &stats);
+  return stats.fragmentation_percent;
+}
+
+static unsigned int ref_fragmentation(void) {
+  size_t free_bytes, largest;
+  ref_stats(&free_bytes, &largest);
+  return free_bytes ? (unsigned int)(100ull * (free_bytes - largest) /
+                                     free_bytes)
+                    : 0;
+}
+
+typedef struct {
+  const char *name;
+  void (*reset)(void);
+  void *(*malloc)(size_t);
+  void *(*memalign)(size_t, size_t);
+  void *(*realloc)(void *, size_t);
+  void (*free)(void *);
+  unsigned int (*fragmentation)(void);
+} Allocator;
+
+static const Allocator kAllocators[] = {
+    {"tlsf", tlsf_reset, tlsf_malloc, tlsf_memalign, tlsf_realloc, tlsf_free,
+     tlsf_fragmentation},
+    {"nano", ref_reset, ref_malloc, ref_memalign, ref_realloc, ref_free,
+     ref_fragmentation},
+};
+
+//------------------------------------------------------------------------------
+// Timed calls and checks
+//------------------------------------------------------------------------------
+
+typedef struct {
+  uint32_t calls;
+  uint64_t cycles;
+  uint32_t max_cycles;
+} OpStats;
+
+typedef struct {
+  const Allocator *allocator;
+  OpStats alloc;
+  OpStats realloc;
+  OpStats free;
+  uint32_t failures;
+  // Of the free memory, with the long-lived blocks of the workload allocated.
+  unsigned int fragmentation;
+  int errors;
+} Run;
+
+static void record(OpStats *op, uint32_t cycles) {
+  ++op->calls;
+  op->cycles += cycles;
+  if (cycles > op->max_cycles) {
+    op->max_cycles = cycles;
+  }
+}
+
+// Tags the first and last words of a block, so an overlap with another live
+// block shows up when it is freed.
+static void tag(uint8_t *ptr, size_t size, uint32_t value) {
+  if (size >= 2 * sizeof(value)) {
+    memcpy(ptr, &value, sizeof(value));
+    memcpy(ptr + size - sizeof(value), &value, sizeof(value));
+  }
+}
+
+static int tag_matches(const uint8_t *ptr, size_t size, uint32_t value) {
+  uint32_t head = value, tail = value;
+  if (size >= 2 * sizeof(value)) {
+    memcpy(&head, ptr, sizeof(value));
+    memcpy(&tail, ptr + size - sizeof(value), sizeof(value));
+  }
+  return head == value && tail == value;
+}
+
+typedef struct {
+  uint8_t *ptr;
+  size_t size;
+} Block;
+
+static void timed_alloc(Run *run, Block *block, size_t alignment,
+                        size_t size) {
+  const Allocator *allocator = run->allocator;
+  uint32_t start = springbok_ccount();
+  uint8_t *ptr = alignment ? allocator->memalign(alignment, size)
+                           : allocator->malloc(size);
+  record(&run->alloc, springbok_ccount() - start);
+  block->ptr = ptr;
+  block->size = ptr ? size : 0;
+  if (!ptr) {
+    ++run->failures;
+    return;
+  }
+  if ((uintptr_t)ptr % (alignment ? alignment : 8)) {
+    LOG_ERROR("%s: misaligned block %p", allocator->name, ptr);
+    ++run->errors;
+  }
+  tag(ptr, size, (uint32_t)(uintptr_t)ptr);
+}
+
+static void timed_realloc(Run *run, Block *block, size_t size) {
+  if (block->ptr && !tag_matches(block->ptr, block->size,
+                                 (uint32_t)(uintptr_t)block->ptr)) {
+    LOG_ERROR("%s: block %p overwritten", run->allocator->name, block->ptr);
+    ++run->errors;
+  }
+  uint32_t start = springbok_ccount();
+  uint8_t *ptr = run->allocator->realloc(block->ptr, size);
+  record(&run->realloc, springbok_ccount() - start);
+  if (!ptr) {
+    ++run->failures;
+    return;
+  }
+  block->ptr = ptr;
+  block->size = size;
+  tag(ptr, size, (uint32_t)(uintptr_t)ptr);
+}
+
+static void timed_free(Run *run, Block *block) {
+  if (!block->ptr) {
+    return;
+  }
+  if (!tag_matches(block->ptr, block->size, (uint32_t)(uintptr_t)block->ptr)) {
+    LOG_ERROR("%s: block %p overwritten", run->allocator->name, block->ptr);
+    ++run->errors;
+  }
+  uint32_t start = springbok_ccount();
+  run->allocator->free(block->ptr);
+  record(&run->free, springbok_ccount() - start);
+  block->ptr = NULL;
+  block->size = 0;
+}
+
+static uint32_t random_state;
+
+static uint32_t random_next(void) {
+  random_state = random_state * 1664525u + 1013904223u;
+  return random_state >> 8;
+}
+
+//------------------------------------------------------------------------------
+// Workloads
+//------------------------------------------------------------------------------
+
+#define INVOCATIONS 32
+#define METADATA_PER_INVOCATION 48
+#define RETAINED_BLOCKS (INVOCATIONS / 4)
+
+// Activations of a small quantized CNN, in layer order.
+static const size_t kTensorSizes[] = {
+    150528, 200704, 200704, 100352, 100352, 50176, 50176, 25088,
+    25088,  12544,  12544,  6272,   6272,   1024,  1001,  1001,
+};
+#define TENSORS (sizeof(kTensorSizes) / sizeof(kTensorSizes[0]))
+
+static void inference_workload(Run *run) {
+  Block retained[RETAINED_BLOCKS] = {{0}};
+  for (int invocation = 0; invocation < INVOCATIONS; ++invocation) {
+    Block metadata[METADATA_PER_INVOCATION];
+    Block tensors[TENSORS];
+    Block list = {0};
+    for (int i = 0; i < METADATA_PER_INVOCATION; ++i) {
+      timed_alloc(run, &metadata[i], 0, 16 + random_next() % 177);
+    }
+    for (size_t i = 0; i < TENSORS; ++i) {
+      timed_alloc(run, &tensors[i], TENSOR_ALIGNMENT, kTensorSizes[i]);
+      // Layer i consumed tensor i - 1, the input of layer i - 1 is dead.
+      if (i >= 2) {
+        timed_free(run, &tensors[i - 2]);
+      }
+      if (i % 2 == 0) {
+        timed_realloc(run, &list, (i + 2) * 8 * sizeof(void *));
+      }
+    }
+    if (invocation % 4 == 0) {
+      timed_alloc(run, &retained[invocation / 4], 0, 64 + random_next() % 449);
+    }
+    timed_free(run, &tensors[TENSORS - 2]);
+    timed_free(run, &tensors[TENSORS - 1]);
+    timed_free(run, &list);
+    for (int i = METADATA_PER_INVOCATION - 1; i >= 0; --i) {
+      timed_free(run, &metadata[i]);
+    }
+  }
+  run->fragmentation = run->allocator->fragmentation();
+  for (int i = 0; i < RETAINED_BLOCKS; ++i) {
+    timed_free(run, &retained[i]);
+  }
+}
+
+#define CHURN_OPS 20000
+#define CHURN_SLOTS 256
+
+static void churn_workload(Run *run) {
+  Block slots[CHURN_SLOTS] = {{0}};
+  for (int op = 0; op < CHURN_OPS; ++op) {
+    Block *block = &slots[random_next() % CHURN_SLOTS];
+    // Mostly small objects, with a tail of buffers up to 8KB.
+    size_t size = random_next() % 10 < 7 ? 8 + random_next() % 249
+                                         : 256 + random_next() % 7937;
+    if (!block->ptr) {
+      timed_alloc(run, block,
+                  random_next() % 4 == 0 ? TENSOR_ALIGNMENT : 0, size);
+    } else if (random_next() % 4 == 0) {
+      timed_realloc(run, block, size);
+    } else {
+      timed_free(run, block);
+    }
+  }
+  run->fragmentation = run->allocator->fragmentation();
+  for (int i = 0; i < CHURN_SLOTS; ++i) {
+    timed_free(run, &slots[i]);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+static uint32_t average(const OpStats *op) {
+  return op->calls ? (uint32_t)(op->cycles / op->calls) : 0;
+}
+
+static void report(const char *workload, const Run *run) {
+  LOG_INFO("%-9s %s: alloc %4u avg %6u max, realloc %5u avg %6u max, "
+           "free %4u avg %6u max cycles",
+           workload, run->allocator->name, (unsigned)average(&run->alloc),
+           (unsigned)run->alloc.max_cycles, (unsigned)average(&run->realloc),
+           (unsigned)run->realloc.max_cycles, (unsigned)average(&run->free),
+           (unsigned)run->free.max_cycles);
+  LOG_INFO("%-9s %s: %u failed allocations, %u%% fragmentation", workload,
+           run->allocator->name, (unsigned)run->failures,
+           run->fragmentation);
+}
+
+static int bench(const char *workload, void (*body)(Run *)) {
+  Run runs[2];
+  int errors = 0;
+  for (int i = 0; i < 2; ++i) {
+    Run *run = &runs[i];
+    memset(run, 0, sizeof(*run));
+    run->allocator = &kAllocators[i];
+    run->allocator->reset();
+    random_state = 0x5eed;
+    body(run);
+    report(workload, run);
+    errors += run->errors;
+  }
+
+  uint64_t tlsf_cycles = runs[0].alloc.cycles + runs[0].realloc.cycles +
+                         runs[0].free.cycles;
+  uint64_t ref_cycles = runs[1].alloc.cycles + runs[1].realloc.cycles +
+                        runs[1].free.cycles;
+  LOG_INFO("%-9s nano %u cycles, tlsf %u cycles (x%u.%02u)", workload,
+           (unsigned)ref_cycles, (unsigned)tlsf_cycles,
+           (unsigned)(tlsf_cycles ? ref_cycles / tlsf_cycles : 0),
+           (unsigned)(tlsf_cycles ? (ref_cycles % tlsf_cycles) * 100 /
+                                        tlsf_cycles
+                                  : 0));
+  return errors;
+}
+
+int main() {
+  int errors = 0;
+  errors += bench("inference", inference_workload);
+  errors += bench("churn", churn_workload);
+
+  if (errors) {
+    LOG_ERROR("malloc: %d check(s) failed", errors);
+  } else {
+    LOG_INFO("malloc: all checks passed");
+  }
+  return errors;
+}
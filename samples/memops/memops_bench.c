@@ -0,0 +1,162 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Cycle counts and correctness checks for memcpy/memset/memmove from 16B to
+// 1MB, compared with a byte-at-a-time reference (what newlib-nano provides).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "springbok.h"
+
+#define MAX_SIZE (1 << 20)
+// Extra room so the misaligned and overlapping cases stay in bounds.
+#define PAD 64
+
+static uint8_t src_buf[MAX_SIZE + PAD] __attribute__((aligned(64)));
+static uint8_t dst_buf[MAX_SIZE + PAD] __attribute__((aligned(64)));
+static uint8_t ref_buf[MAX_SIZE + PAD] __attribute__((aligned(64)));
+
+static const size_t kSizes[] = {16,        64,        256,       1 << 10,
+                                4 << 10,   16 << 10,  64 << 10,  256 << 10,
+                                MAX_SIZE};
+
+// Reference routines. Auto-vectorization is disabled so these stay scalar.
+static void ref_memcpy(uint8_t *dst, const uint8_t *src, size_t n) {
+#pragma clang loop vectorize(disable) interleave(disable)
+  for (size_t i = 0; i < n; ++i) dst[i] = src[i];
+}
+
+static void ref_memset(uint8_t *dst, uint8_t c, size_t n) {
+#pragma clang loop vectorize(disable) interleave(disable)
+  for (size_t i = 0; i < n; ++i) dst[i] = c;
+}
+
+static void ref_memmove(uint8_t *dst, const uint8_t *src, size_t n) {
+  if (dst < src) {
+    ref_memcpy(dst, src, n);
+    return;
+  }
+#pragma clang loop vectorize(disable) interleave(disable)
+  for (size_t i = n; i > 0; --i) dst[i - 1] = src[i - 1];
+}
+
+static void fill_pattern(uint8_t *buf, size_t n, uint32_t seed) {
+  for (size_t i = 0; i < n; ++i) {
+    seed = seed * 1664525u + 1013904223u;
+    buf[i] = (uint8_t)(seed >> 24);
+  }
+}
+
+static int check(const char *name, size_t n, const uint8_t *got,
+                 const uint8_t *want, size_t len) {
+  if (memcmp(got, want, len) != 0) {
+    LOG_ERROR("%s mismatch at size %u", name, (unsigned)n);
+    return 1;
+  }
+  return 0;
+}
+
+static void report(const char *name, size_t n, uint32_t ref_cycles,
+                   uint32_t cycles) {
+  LOG_INFO("%-8s %8u B: ref %9u cycles, lib %9u cycles (x%u.%02u)", name,
+           (unsigned)n, (unsigned)ref_cycles, (unsigned)cycles,
+           (unsigned)(cycles ? ref_cycles / cycles : 0),
+           (unsigned)(cycles ? (ref_cycles % cycles) * 100 / cycles : 0));
+}
+
+static int bench_memcpy(size_t n, size_t offset) {
+  const size_t len = n + PAD;
+  fill_pattern(src_buf, len, n);
+  fill_pattern(dst_buf, len, ~n);
+  memcpy(ref_buf, dst_buf, len);
+
+  uint32_t start = springbok_ccount();
+  ref_memcpy(ref_buf + offset, src_buf + 1, n);
+  uint32_t ref_cycles = springbok_ccount() - start;
+
+  start = springbok_ccount();
+  memcpy(dst_buf + offset, src_buf + 1, n);
+  uint32_t cycles = springbok_ccount() - start;
+
+  if (offset == 0) report("memcpy", n, ref_cycles, cycles);
+  return check("memcpy", n, dst_buf, ref_buf, len);
+}
+
+static int bench_memset(size_t n, size_t offset) {
+  const size_t len = n + PAD;
+  fill_pattern(dst_buf, len, n);
+  memcpy(ref_buf, dst_buf, len);
+
+  uint32_t start = springbok_ccount();
+  ref_memset(ref_buf + offset, 0xA5, n);
+  uint32_t ref_cycles = springbok_ccount() - start;
+
+  start = springbok_ccount();
+  memset(dst_buf + offset, 0xA5, n);
+  uint32_t cycles = springbok_ccount() - start;
+
+  if (offset == 0) report("memset", n, ref_cycles, cycles);
+  return check("memset", n, dst_buf, ref_buf, len);
+}
+
+// Moves within one buffer by `shift` bytes, which overlaps the source and
+// destination in both directions for all but the smallest sizes.
+static int bench_memmove(size_t n, int shift) {
+  const size_t len = n + PAD;
+  const size_t base = PAD / 2;
+  fill_pattern(dst_buf, len, n);
+  memcpy(ref_buf, dst_buf, len);
+
+  uint32_t start = springbok_ccount();
+  ref_memmove(ref_buf + base + shift, ref_buf + base, n);
+  uint32_t ref_cycles = springbok_ccount() - start;
+
+  start = springbok_ccount();
+  memmove(dst_buf + base + shift, dst_buf + base, n);
+  uint32_t cycles = springbok_ccount() - start;
+
+  if (shift > 0) report("memmove", n, ref_cycles, cycles);
+  return check("memmove", n, dst_buf, ref_buf, len);
+}
+
+int main() {
+  int errors = 0;
+  for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i) {
+    const size_t n = kSizes[i];
+    errors += bench_memcpy(n, 0);
+    errors += bench_memcpy(n, 3);
+    errors += bench_memset(n, 0);
+    errors += bench_memset(n, 5);
+    errors += bench_memmove(n, 7);
+    errors += bench_memmove(n, -7);
+  }
+  // Zero-length calls must not touch memory.
+  fill_pattern(dst_buf, PAD, 0);
+  memcpy(ref_buf, dst_buf, PAD);
+  memcpy(dst_buf, src_buf, 0);
+  memset(dst_buf, 0, 0);
+  memmove(dst_buf + 1, dst_buf, 0);
+  errors += check("zero-length", 0, dst_buf, ref_buf, PAD);
+
+  if (errors) {
+    LOG_ERROR("memops: %d check(s) failed", errors);
+  } else {
+    LOG_INFO("memops: all checks passed");
+  }
+  return errors;
+}
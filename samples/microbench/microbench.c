@@ -0,0 +1,65 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Input and output processing shared by the operator microbenchmarks.
+
+#include "samples/microbench/microbench.h"
+
+#include <springbok.h>
+
+iree_status_t load_input_data(const MlModel *model, iree_host_size_t index,
+                              iree_byte_span_t buffer) {
+  const MlTensor *input = &model->inputs[index];
+  for (iree_host_size_t i = 0; i < input->length; ++i) {
+    // Small values keep the integer accumulations in range.
+    const int value = (int)((i * 7 + index * 3) % 9) - 4;
+    switch (input->element_type) {
+      case IREE_HAL_ELEMENT_TYPE_SINT_8:
+        ((int8_t *)buffer.data)[i] = (int8_t)value;
+        break;
+      case IREE_HAL_ELEMENT_TYPE_SINT_32:
+        ((int32_t *)buffer.data)[i] = value;
+        break;
+      case IREE_HAL_ELEMENT_TYPE_FLOAT_32:
+        ((float *)buffer.data)[i] = value * 0.25f;
+        break;
+      default:
+        return iree_make_status(IREE_STATUS_UNIMPLEMENTED,
+                                "unsupported input element type");
+    }
+  }
+  return iree_ok_status();
+}
+
+// The checksum compares the outputs of the RVV and scalar builds of a kernel.
+iree_status_t process_output(const MlModel *model,
+                             iree_hal_buffer_mapping_t *buffers,
+                             uint32_t *output_length) {
+  // FNV-1a
+  uint32_t checksum = 2166136261u;
+  uint32_t length = 0;
+  for (iree_host_size_t i = 0; i < model->num_output; ++i) {
+    const uint8_t *data = buffers[i].contents.data;
+    for (iree_host_size_t j = 0; j < buffers[i].contents.data_length; ++j) {
+      checksum = (checksum ^ data[j]) * 16777619u;
+    }
+    length += model->outputs[i].size_bytes;
+  }
+  *output_length = length;
+  LOG_INFO("Microbench ops: %u", (unsigned)kMicrobenchOps);
+  LOG_INFO("Output checksum: 0x%08x", (unsigned)checksum);
+  return iree_ok_status();
+}
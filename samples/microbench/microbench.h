@@ -0,0 +1,33 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLES_MICROBENCH_MICROBENCH_H_
+#define SAMPLES_MICROBENCH_MICROBENCH_H_
+
+// Shared driver of the operator microbenchmarks. Each kernel variant gets a
+// generated microbench_kernel.c.in that provides its module and library; the
+// driver fills the inputs with a fixed pattern and reports the operation
+// count and a checksum of the outputs next to the inference cycles.
+
+#include <stdint.h>
+
+#include "samples/util/util.h"
+
+// Arithmetic operations of one inference of the kernel, a multiply-accumulate
+// counting as two.
+extern const uint32_t kMicrobenchOps;
+
+#endif  // SAMPLES_MICROBENCH_MICROBENCH_H_
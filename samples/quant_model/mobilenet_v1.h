@@ -24,18 +24,4 @@ typedef struct {
   int best_out;
 } MobilenetV1Output;
 
-const MlModel kModel = {
-    .num_input = 1,
-    .num_input_dim = {4},
-    .input_shape = {{1, 224, 224, 3}},
-    .input_length = {224 * 224 * 3},
-    .input_size_bytes = {sizeof(uint8_t)},
-    .num_output = 1,
-    .output_length = {1001},
-    .output_size_bytes = sizeof(uint8_t),
-    .hal_element_type = IREE_HAL_ELEMENT_TYPE_UINT_8,
-    .entry_func = "module.main",
-    .model_name = "mobilenet_v1_0.25_224_quant",
-};
-
 #endif  // SAMPLES_QUANT_MODELS_MOBILENET_V1_H_
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Integer dynamic_mul bytecode loading and input/output processes, invoked at
+// several vector lengths up to the upper bound of its dynamic dimension.
+
+#include "samples/util/util.h"
+
+// Compiled module embedded here to avoid file IO:
+#if !defined(BUILD_EMITC)
+#include "samples/simple_vec_mul/simple_dynamic_mul_bytecode_module_static.h"
+#include "samples/simple_vec_mul/simple_dynamic_mul_bytecode_module_static_c.h"
+#else
+#include "samples/simple_vec_mul/simple_dynamic_mul_c_module_static_c.h"
+#include "samples/simple_vec_mul/simple_dynamic_mul_c_module_static_emitc.h"
+#endif  // !defined(BUILD_EMITC)
+#include "samples/simple_vec_mul/simple_dynamic_mul_model.h"
+
+// Vector lengths of the invocations, up to the upper bound of the model.
+static const iree_hal_dim_t kLengths[] = {512, 1024, 2048,
+                                          SIMPLE_DYNAMIC_MUL_INPUT_0_LENGTH};
+
+iree_status_t create_module(iree_vm_instance_t *instance,
+                            iree_vm_module_t **module) {
+#if !defined(BUILD_EMITC)
+  const struct iree_file_toc_t *module_file_toc =
+      samples_simple_vec_mul_simple_dynamic_mul_bytecode_module_static_create();
+  return iree_vm_bytecode_module_create(
+      instance,
+      iree_make_const_byte_span(module_file_toc->data, module_file_toc->size),
+      iree_allocator_null(), iree_allocator_system(), module);
+#else
+  return module_create(instance, iree_allocator_system(), module);
+#endif  // #if !defined(BUILD_EMITC)
+}
+
+iree_hal_executable_library_query_fn_t library_query(void) {
+  return &dynamic_mul_dispatch_0_library_query;
+}
+
+bool select_input_shapes(const MlModel *model, uint32_t invocation,
+                         iree_hal_dim_t *const *shapes) {
+  if (invocation >= IREE_ARRAYSIZE(kLengths)) {
+    return false;
+  }
+  for (iree_host_size_t i = 0; i < model->num_input; ++i) {
+    shapes[i][0] = kLengths[invocation];
+  }
+  return true;
+}
+
+iree_status_t load_input_data(const MlModel *model, iree_host_size_t index,
+                              iree_byte_span_t buffer) {
+  // Populate initial values
+  // arg0 = 0, 0, 1, 1,..., length / 2 - 1
+  // arg1 = 0, 1, 2, 3,..., length - 1
+  int32_t *data = (int32_t *)buffer.data;
+  for (int i = 0; i < buffer.data_length / sizeof(int32_t); ++i) {
+    data[i] = index == 0 ? i >> 1 : i;
+  }
+  return iree_ok_status();
+}
+
+iree_status_t process_output(const MlModel *model,
+                             iree_hal_buffer_mapping_t *buffers,
+                             uint32_t *output_length) {
+  // The output has the length of the inputs of the invocation.
+  iree_host_size_t length = buffers[0].contents.data_length / sizeof(int32_t);
+  for (int i = 0; i < length; ++i) {
+    if (((const int32_t *)buffers[0].contents.data)[i] != (i >> 1) * i) {
+      return iree_make_status(IREE_STATUS_UNKNOWN, "result mismatches");
+    }
+  }
+  *output_length = buffers[0].contents.data_length;
+  return iree_ok_status();
+}
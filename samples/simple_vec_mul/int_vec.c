@@ -34,20 +34,7 @@
 #include "samples/simple_vec_mul/simple_int_mul_c_module_static_emitc.h"
 #endif  // !defined(BUILD_EMITC)
 #endif  // defined(BUILD_VMVX)
-
-const MlModel kModel = {
-    .num_input = 2,
-    .num_input_dim = {1, 1},
-    .input_shape = {{1024}, {1024}},
-    .input_length = {1024, 1024},
-    .input_size_bytes = {sizeof(int32_t), sizeof(int32_t)},
-    .num_output = 1,
-    .output_length = {1024},
-    .output_size_bytes = sizeof(int32_t),
-    .hal_element_type = IREE_HAL_ELEMENT_TYPE_SINT_32,
-    .entry_func = "module.simple_mul",
-    .model_name = "simple_int_vec_mul",
-};
+#include "samples/simple_vec_mul/simple_int_mul_model.h"
 
 iree_status_t create_module(iree_vm_instance_t *instance,
                             iree_vm_module_t **module) {
@@ -74,24 +61,16 @@ iree_hal_executable_library_query_fn_t library_query(void) {
 }
 #endif  // #if !defined(BUILD_VMVX)
 
-iree_status_t load_input_data(const MlModel *model, void **buffer,
-                              iree_const_byte_span_t **byte_span) {
-  iree_status_t result = alloc_input_buffer(model, buffer);
+iree_status_t load_input_data(const MlModel *model, iree_host_size_t index,
+                              iree_byte_span_t buffer) {
   // Populate initial values
   // arg0 = 0, 0, 1, 1,..., 511
   // arg1 = 0, 1, 2, 3,..., 1023
-  if (iree_status_is_ok(result)) {
-    for (int i = 0; i < model->input_length[0]; ++i) {
-      ((int32_t *)buffer[0])[i] = i >> 1;
-      ((int32_t *)buffer[1])[i] = i;
-    }
+  int32_t *data = (int32_t *)buffer.data;
+  for (int i = 0; i < model->inputs[index].length; ++i) {
+    data[i] = index == 0 ? i >> 1 : i;
   }
-  for (int i = 0; i < model->num_input; ++i) {
-    byte_span[i] = malloc(sizeof(iree_const_byte_span_t));
-    *byte_span[i] = iree_make_const_byte_span(
-        buffer[i], model->input_size_bytes[i] * model->input_length[i]);
-  }
-  return result;
+  return iree_ok_status();
 }
 
 iree_status_t process_output(const MlModel *model,
@@ -0,0 +1,5 @@
+func.func @dynamic_mul(%arg0: tensor<?xi32>, %arg1: tensor<?xi32>) -> tensor<?xi32>
+{
+  %0 = "mhlo.multiply"(%arg0, %arg1) : (tensor<?xi32>, tensor<?xi32>) -> tensor<?xi32>
+  return %0 : tensor<?xi32>
+}
@@ -1,31 +0,0 @@
-/*
- * Copyright 2022 Google LLC
- *
- * Licensed under the Apache License, Version 2.0 (the "License");
- * you may not use this file except in compliance with the License.
- * You may obtain a copy of the License at
- *
- *      http://www.apache.org/licenses/LICENSE-2.0
- *
- * Unless required by applicable law or agreed to in writing, software
- * distributed under the License is distributed on an "AS IS" BASIS,
- * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
- * See the License for the specific language governing permissions and
- * limitations under the License.
- */
-
-#include "samples/util/alloc.h"
-
-iree_status_t alloc_input_buffer(const MlModel *model, void **buffer) {
-  iree_status_t result = iree_ok_status();
-  for (int i = 0; i < model->num_input; ++i) {
-    if (iree_status_is_ok(result)) {
-      buffer[i] = aligned_alloc(sizeof(uint32_t), model->input_size_bytes[i] *
-                                                      model->input_length[i]);
-      if (buffer[i] == NULL) {
-        result = iree_make_status(IREE_STATUS_RESOURCE_EXHAUSTED);
-      }
-    }
-  }
-  return result;
-}
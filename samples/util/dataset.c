@@ -0,0 +1,185 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "samples/util/dataset.h"
+
+#include <fcntl.h>
+#include <springbok.h>
+#include <unistd.h>
+
+#define DATASET_INPUTS "inputs.bin"
+#define DATASET_LABELS "labels.bin"
+
+// Return the size of an open file, leaving it at its start.
+static off_t file_size(int fd) {
+  off_t size = lseek(fd, 0, SEEK_END);
+  lseek(fd, 0, SEEK_SET);
+  return size;
+}
+
+iree_status_t dataset_open(const MlModel *model, Dataset *dataset) {
+  dataset->labels_fd = -1;
+  dataset->num_records = 0;
+  dataset->record_size = 0;
+  dataset->inputs_fd = open(DATASET_INPUTS, O_RDONLY);
+  if (dataset->inputs_fd < 0) {
+    return iree_ok_status();
+  }
+
+  for (iree_host_size_t i = 0; i < model->num_input; ++i) {
+    dataset->record_size += model->inputs[i].size_bytes;
+  }
+  off_t size = file_size(dataset->inputs_fd);
+  if (size <= 0 || size % dataset->record_size != 0) {
+    dataset_close(dataset);
+    return iree_make_status(
+        IREE_STATUS_INVALID_ARGUMENT,
+        DATASET_INPUTS " is not a whole number of %u-byte records",
+        (unsigned)dataset->record_size);
+  }
+  dataset->num_records = size / dataset->record_size;
+
+  dataset->labels_fd = open(DATASET_LABELS, O_RDONLY);
+  if (dataset->labels_fd >= 0 &&
+      file_size(dataset->labels_fd) !=
+          (off_t)(dataset->num_records * sizeof(int32_t))) {
+    dataset_close(dataset);
+    return iree_make_status(
+        IREE_STATUS_INVALID_ARGUMENT,
+        DATASET_LABELS " does not hold one int32 label per record");
+  }
+  return iree_ok_status();
+}
+
+iree_status_t dataset_load_next(const MlModel *model, const Dataset *dataset,
+                                int32_t *label) {
+  // Each input lands in its storage with a single host read.
+  for (iree_host_size_t i = 0; i < model->num_input; ++i) {
+    const MlTensor *input = &model->inputs[i];
+    if (read(dataset->inputs_fd, input->data, input->size_bytes) !=
+        (int)input->size_bytes) {
+      return iree_make_status(IREE_STATUS_DATA_LOSS,
+                              "short read of " DATASET_INPUTS);
+    }
+  }
+  *label = -1;
+  if (dataset->labels_fd >= 0 &&
+      read(dataset->labels_fd, label, sizeof(*label)) != sizeof(*label)) {
+    return iree_make_status(IREE_STATUS_DATA_LOSS,
+                            "short read of " DATASET_LABELS);
+  }
+  return iree_ok_status();
+}
+
+// Index of the largest of `length` elements of `type` at `data`.
+#define ARGMAX(type, data, length, best)                            \
+  for (iree_host_size_t i = 1; i < (length); ++i) {                 \
+    if (((const type *)(data))[i] > ((const type *)(data))[best]) { \
+      (best) = i;                                                   \
+    }                                                               \
+  }
+
+int32_t dataset_top1(const MlModel *model) {
+  const MlTensor *output = &model->outputs[0];
+  const void *data = model->output_mappings[0].contents.data;
+  iree_host_size_t best = 0;
+  switch (output->element_type) {
+    case IREE_HAL_ELEMENT_TYPE_UINT_8:
+      ARGMAX(uint8_t, data, output->length, best);
+      break;
+    case IREE_HAL_ELEMENT_TYPE_SINT_8:
+      ARGMAX(int8_t, data, output->length, best);
+      break;
+    case IREE_HAL_ELEMENT_TYPE_SINT_32:
+      ARGMAX(int32_t, data, output->length, best);
+      break;
+    case IREE_HAL_ELEMENT_TYPE_FLOAT_32:
+      ARGMAX(float, data, output->length, best);
+      break;
+    default:
+      return -1;
+  }
+  return (int32_t)best;
+}
+
+void dataset_close(Dataset *dataset) {
+  if (dataset->inputs_fd >= 0) {
+    close(dataset->inputs_fd);
+    dataset->inputs_fd = -1;
+  }
+  if (dataset->labels_fd >= 0) {
+    close(dataset->labels_fd);
+    dataset->labels_fd = -1;
+  }
+}
+
+iree_status_t run_dataset(const MlModel *model, Dataset *dataset,
+                          Invocation *invocation) {
+  LOG_INFO("Dataset records: %u", (unsigned)dataset->num_records);
+  uint64_t total_cycles = 0;
+  uint64_t start_energy = springbok_energy();
+  uint32_t min_cycles = UINT32_MAX;
+  uint32_t max_cycles = 0;
+  uint32_t labeled = 0;
+  uint32_t correct = 0;
+  iree_status_t result = iree_ok_status();
+  for (uint32_t i = 0; i < dataset->num_records && iree_status_is_ok(result);
+       ++i) {
+    // The input buffers wrap the static storage the record is read into.
+    int32_t label = -1;
+    result = dataset_load_next(model, dataset, &label);
+    uint32_t cycles = 0;
+    if (iree_status_is_ok(result)) {
+      result = invoke_and_map(model, invocation, &cycles);
+    }
+    if (iree_status_is_ok(result)) {
+      int32_t prediction = dataset_top1(model);
+      LOG_INFO("Dataset record %u: label %d, prediction %d, %u cycles",
+               (unsigned)i, (int)label, (int)prediction, (unsigned)cycles);
+      total_cycles += cycles;
+      min_cycles = cycles < min_cycles ? cycles : min_cycles;
+      max_cycles = cycles > max_cycles ? cycles : max_cycles;
+      if (label >= 0) {
+        labeled++;
+        correct += (prediction == label);
+      }
+    }
+    // The next invocation appends its results to an empty list.
+    if (iree_status_is_ok(result)) {
+      result = release_outputs(model, invocation);
+    } else {
+      IREE_IGNORE_ERROR(release_outputs(model, invocation));
+    }
+  }
+
+  if (iree_status_is_ok(result) && dataset->num_records > 0) {
+    LOG_INFO("Dataset inference cycles: mean %u, min %u, max %u",
+             (unsigned)(total_cycles / dataset->num_records),
+             (unsigned)min_cycles, (unsigned)max_cycles);
+    print_energy("Dataset energy per record",
+                 (springbok_energy() - start_energy) / dataset->num_records);
+    if (labeled > 0) {
+      uint32_t basis_points = (uint64_t)correct * 10000 / labeled;
+      LOG_INFO("Dataset top-1 accuracy: %u/%u (%u.%02u%%)", (unsigned)correct,
+               (unsigned)labeled, (unsigned)(basis_points / 100),
+               (unsigned)(basis_points % 100));
+    }
+  }
+  if (iree_status_is_ok(result) && invocation->cache) {
+    result_cache_report(invocation->cache);
+  }
+  return result;
+}
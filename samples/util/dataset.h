@@ -0,0 +1,63 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLES_UTIL_DATASET_H_
+#define SAMPLES_UTIL_DATASET_H_
+
+// Dataset runner mode: when the simulator serves a directory of host files
+// (the HostFileRoot of the core, see springbok_hostfile), the model runs over
+// every record of it in one boot instead of its compiled-in input.
+//
+// The directory holds, as written by build_tools/gen_dataset.py:
+//   inputs.bin  the records, each the inputs of the model back to back in
+//               the layout of their static storage
+//   labels.bin  optional, the int32 label of each record
+//
+// The prediction of a record is the top-1 index of the first output.
+
+#include <stdint.h>
+
+#include "samples/util/model_api.h"
+#include "samples/util/runtime.h"
+
+typedef struct {
+  int inputs_fd;
+  int labels_fd;  // -1 without labels.
+  uint32_t num_records;
+  uint32_t record_size;
+} Dataset;
+
+// Open the dataset served by the simulator. `inputs_fd` is -1 when there is
+// none; a dataset that does not match the inputs of the model is an error.
+iree_status_t dataset_open(const MlModel *model, Dataset *dataset);
+
+// Read the next record into the input storage of the model, and its label (-1
+// without labels).
+iree_status_t dataset_load_next(const MlModel *model, const Dataset *dataset,
+                                int32_t *label);
+
+// Return the top-1 index of the first mapped output of the model.
+int32_t dataset_top1(const MlModel *model);
+
+void dataset_close(Dataset *dataset);
+
+// Run the model over every record of the dataset through `invocation`.
+// Reports the label, top-1 prediction and inference cycles of each record,
+// then the cycles per inference and the top-1 accuracy over the dataset.
+iree_status_t run_dataset(const MlModel *model, Dataset *dataset,
+                          Invocation *invocation);
+
+#endif  // SAMPLES_UTIL_DATASET_H_
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "samples/util/direct_call.h"
+
+iree_status_t direct_call(iree_vm_context_t *context,
+                          iree_vm_function_t function,
+                          iree_byte_span_t arguments,
+                          iree_byte_span_t results) {
+  // The same stack iree_vm_invoke sets up, on the host stack.
+  IREE_VM_INLINE_STACK_INITIALIZE(stack, IREE_VM_INVOCATION_FLAG_NONE,
+                                  iree_vm_context_state_resolver(context),
+                                  iree_allocator_system());
+  iree_vm_function_call_t call = {
+      .function = function,
+      .arguments = arguments,
+      .results = results,
+  };
+  iree_status_t status =
+      function.module->begin_call(function.module->self, stack, call);
+  iree_vm_stack_deinitialize(stack);
+  return status;
+}
+
+bool direct_call_matches(iree_vm_function_t function,
+                         iree_host_size_t num_args,
+                         iree_host_size_t num_results) {
+  // "0" + one "r" per argument + "_" + one "r" per result.
+  iree_string_view_t cconv =
+      iree_vm_function_signature(&function).calling_convention;
+  if (cconv.size != num_args + num_results + 2 || cconv.data[0] != '0' ||
+      cconv.data[num_args + 1] != '_') {
+    return false;
+  }
+  for (iree_host_size_t i = 1; i < cconv.size; ++i) {
+    if (i != num_args + 1 && cconv.data[i] != 'r') {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLES_UTIL_DIRECT_CALL_H_
+#define SAMPLES_UTIL_DIRECT_CALL_H_
+
+// Direct calls of the entry function of a model. iree_vm_invoke takes its
+// arguments and results as ref-counted iree_vm_list_t and marshals them to
+// and from the calling convention of the function on every call. A direct
+// call hands the begin_call of the module the arguments and results already
+// in the register layout of the calling convention, in structs generated
+// with the model header (see build_tools/gen_mlmodel_header.py).
+
+#include "iree/vm/api.h"
+
+// Call `function` of `context` with `arguments` and `results` laid out as its
+// calling convention expects. The results are owned by the caller.
+iree_status_t direct_call(iree_vm_context_t *context,
+                          iree_vm_function_t function,
+                          iree_byte_span_t arguments, iree_byte_span_t results);
+
+// Return whether `function` takes `num_args` refs and returns `num_results`
+// refs, the calling convention the generated direct calls assume.
+bool direct_call_matches(iree_vm_function_t function,
+                         iree_host_size_t num_args,
+                         iree_host_size_t num_results);
+
+#endif  // SAMPLES_UTIL_DIRECT_CALL_H_
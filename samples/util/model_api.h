@@ -23,37 +23,83 @@
 #include "iree/modules/hal/module.h"
 #include "iree/vm/bytecode_module.h"
 
-#define MAX_MODEL_INPUT_NUM 2
-#define MAX_MODEL_INPUT_DIM 4
-#define MAX_MODEL_OUTPUTS 12
-#define MAX_ENTRY_FUNC_NAME 20
+// Modes of the result cache of the dataset and server runs (see
+// result_cache.h).
+#define RESULT_CACHE_NONE 0
+#define RESULT_CACHE_EXACT 1
+#define RESULT_CACHE_PERCEPTUAL 2
 
+// Describes one input or output tensor of the model entry function.
 typedef struct {
-  int num_input;
-  int num_input_dim[MAX_MODEL_INPUT_NUM];
-  iree_hal_dim_t input_shape[MAX_MODEL_INPUT_NUM][MAX_MODEL_INPUT_DIM];
-  int input_length[MAX_MODEL_INPUT_NUM];
-  int input_size_bytes[MAX_MODEL_INPUT_NUM];
-  int num_output;
-  int output_length[MAX_MODEL_OUTPUTS];
-  int output_size_bytes;
-  enum iree_hal_element_types_t hal_element_type;
-  char entry_func[MAX_ENTRY_FUNC_NAME];
-  char model_name[];
+  iree_host_size_t rank;
+  // Dynamic dimensions hold their upper bound for an input, 0 for an output.
+  const iree_hal_dim_t *shape;
+  // Bit i is set when dimension i is dynamic.
+  uint32_t dynamic_dims;
+  // Number of elements and byte size at `shape`, 0 for an output with
+  // dynamic dimensions.
+  iree_host_size_t length;
+  iree_host_size_t size_bytes;
+  iree_hal_element_type_t element_type;
+  // Statically allocated, aligned storage of an input. NULL for outputs.
+  void *data;
+} MlTensor;
+
+// Typed call of the entry function straight into its module, without the
+// iree_vm_list_t marshalling of iree_vm_invoke (see direct_call.h). The
+// output buffer views are returned retained.
+typedef iree_status_t (*MlDirectCallFn)(iree_vm_context_t *context,
+                                        iree_vm_function_t function,
+                                        iree_hal_buffer_view_t *const *inputs,
+                                        iree_hal_buffer_view_t **outputs);
+
+// The descriptor of a model is generated at build time from the signature of
+// its entry function (see build_tools/gen_mlmodel_header.py) and included by
+// the sample as "<package>/<name>_model.h".
+typedef struct {
+  iree_host_size_t num_input;
+  const MlTensor *inputs;
+  iree_host_size_t num_output;
+  const MlTensor *outputs;
+  // Mappings of the output buffers handed to process_output.
+  iree_hal_buffer_mapping_t *output_mappings;
+  const char *entry_func;
+  const char *model_name;
+  // Set in EmitC builds, NULL to go through iree_vm_invoke.
+  MlDirectCallFn direct_call;
+  // Inferences to time through each invocation path before the run, 0 for
+  // none. Set by building the sample with -DBENCHMARK_INVOCATIONS=<n>.
+  uint32_t benchmark_invocations;
+  // RESULT_CACHE_* mode of the dataset and server runs. Set by building the
+  // sample with -DRESULT_CACHE=<mode>.
+  uint32_t result_cache;
 } MlModel;
 
 // Load the statically embedded library
 iree_hal_executable_library_query_fn_t library_query(void);
 
 // Function to create the bytecode or C module.
+typedef iree_status_t (*MlCreateModuleFn)(iree_vm_instance_t *instance,
+                                          iree_vm_module_t **module);
 iree_status_t create_module(iree_vm_instance_t *instance,
                             iree_vm_module_t **module);
 
-// For each ML workload, based on the model configuration, allocate the buffer
-// and prepare the data. It can be loaded from a embedded image binary, a
-// randomly generated stream, or a pointer from the sensor/ISP output.
-iree_status_t load_input_data(const MlModel *model, void **buffer,
-                              iree_const_byte_span_t **byte_span);
+// For each ML workload, fill the storage of input `index` with its data. It
+// can be loaded from a embedded image binary, a randomly generated stream, or
+// a pointer from the sensor/ISP output. `buffer` spans the whole input, at
+// the shape select_input_shapes set for the invocation if any.
+iree_status_t load_input_data(const MlModel *model, iree_host_size_t index,
+                              iree_byte_span_t buffer);
+
+// Optional, for models with dynamic input dimensions. Set the input shapes of
+// invocation `invocation`, where `shapes[i]` holds the rank dimensions of input
+// i, filled with the shape of the descriptor. Dynamic dimensions can be lowered
+// below their upper bound, the static ones are left alone. Return false when
+// there is no such invocation. When a sample defines it, run() invokes the
+// model once per set of shapes, with the input buffers sized from them, rather
+// than once at the upper bounds.
+bool select_input_shapes(const MlModel *model, uint32_t invocation,
+                         iree_hal_dim_t *const *shapes) __attribute__((weak));
 
 // Process the ML execution output into the final data to be sent to the
 // host. `output_length` is set to the total byte size of the model's output.
@@ -61,4 +107,9 @@ iree_status_t process_output(const MlModel *model,
                              iree_hal_buffer_mapping_t *buffers,
                              uint32_t *output_length);
 
+// Optional: the cascade of models to run instead of kModel alone (see
+// pipeline.h). A sample running several models defines it.
+typedef struct MlPipeline MlPipeline;
+const MlPipeline *ml_pipeline(void) __attribute__((weak));
+
 #endif  // SAMPLES_UTIL_MODEL_API_H_
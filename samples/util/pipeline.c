@@ -0,0 +1,121 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "samples/util/pipeline.h"
+
+#include <springbok.h>
+
+#include "samples/util/runtime.h"
+
+iree_status_t run_pipeline(const MlPipeline *pipeline) {
+  iree_host_size_t num_stages = pipeline->num_stages;
+  if (num_stages == 0 || num_stages > ML_PIPELINE_MAX_STAGES) {
+    return iree_make_status(IREE_STATUS_INVALID_ARGUMENT,
+                            "pipeline of %u stages, 1 to %d supported",
+                            (unsigned)num_stages, ML_PIPELINE_MAX_STAGES);
+  }
+  Runtime runtime = {0};
+  Invocation invocations[ML_PIPELINE_MAX_STAGES] = {0};
+  iree_status_t result = runtime_create(&runtime);
+  // Every stage has its own context, the modules of the stages all being
+  // named "module". The frames are loaded into the storage of the stages
+  // directly, so the inputs are only wrapped here. The startup phases of the
+  // module and context are those of the first stage.
+  for (iree_host_size_t i = 0; i < num_stages && iree_status_is_ok(result);
+       ++i) {
+    const MlPipelineStage *stage = &pipeline->stages[i];
+    result = create_invocation(&runtime, stage->model, stage->create_module,
+                               /*load=*/false, &invocations[i]);
+  }
+
+  if (iree_status_is_ok(result)) {
+    runtime_start_inference();
+  }
+
+  uint32_t stage_runs[ML_PIPELINE_MAX_STAGES] = {0};
+  uint64_t stage_cycles[ML_PIPELINE_MAX_STAGES] = {0};
+  uint64_t total_cycles = 0;
+  for (uint32_t frame = 0;
+       frame < pipeline->num_frames && iree_status_is_ok(result); ++frame) {
+    uint32_t frame_start_cycles = springbok_ccount();
+    result = pipeline->load_frame(pipeline, frame);
+    iree_host_size_t ran = 0;
+    bool passed = true;
+    for (iree_host_size_t i = 0;
+         i < num_stages && passed && iree_status_is_ok(result); ++i) {
+      const MlPipelineStage *stage = &pipeline->stages[i];
+      const MlModel *model = stage->model;
+      uint32_t cycles = 0;
+      result = invoke_and_map(model, &invocations[i], &cycles);
+      if (iree_status_is_ok(result)) {
+        result = write_output(model);
+      }
+      if (iree_status_is_ok(result) && stage->confidence &&
+          i + 1 < num_stages) {
+        float confidence = stage->confidence(model, model->output_mappings);
+        passed = confidence >= stage->threshold;
+        LOG_INFO("Pipeline frame %u: %s confidence %u%%, %s", (unsigned)frame,
+                 model->model_name, (unsigned)(confidence * 100.0f),
+                 passed ? "passed" : "stopped");
+      }
+      if (iree_status_is_ok(result)) {
+        stage_runs[i]++;
+        stage_cycles[i] += cycles;
+        ran = i + 1;
+      }
+      // The next frame appends its results to an empty list.
+      if (iree_status_is_ok(result)) {
+        result = release_outputs(model, &invocations[i]);
+      } else {
+        IREE_IGNORE_ERROR(release_outputs(model, &invocations[i]));
+      }
+    }
+    uint32_t frame_cycles = springbok_ccount() - frame_start_cycles;
+    if (iree_status_is_ok(result)) {
+      LOG_INFO("Pipeline frame %u: %u of %u stages, %u cycles",
+               (unsigned)frame, (unsigned)ran, (unsigned)num_stages,
+               (unsigned)frame_cycles);
+      total_cycles += frame_cycles;
+    }
+  }
+
+  if (iree_status_is_ok(result) && pipeline->num_frames > 0) {
+    uint32_t frames = pipeline->num_frames;
+    for (iree_host_size_t i = 0; i < num_stages; ++i) {
+      LOG_INFO("Pipeline stage %s: %u of %u frames, mean %u cycles",
+               pipeline->stages[i].model->model_name, (unsigned)stage_runs[i],
+               (unsigned)frames,
+               (unsigned)(stage_runs[i] ? stage_cycles[i] / stage_runs[i]
+                                        : 0));
+      if (i > 0) {
+        uint32_t basis_points =
+            (uint64_t)(frames - stage_runs[i]) * 10000 / frames;
+        LOG_INFO("Pipeline stage %s skip rate: %u.%02u%%",
+                 pipeline->stages[i].model->model_name,
+                 (unsigned)(basis_points / 100),
+                 (unsigned)(basis_points % 100));
+      }
+    }
+    LOG_INFO("Pipeline cycles per frame: mean %u",
+             (unsigned)(total_cycles / frames));
+  }
+
+  for (iree_host_size_t i = 0; i < num_stages; ++i) {
+    release_invocation(&invocations[i]);
+  }
+  runtime_release(&runtime);
+  return result;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLES_UTIL_PIPELINE_H_
+#define SAMPLES_UTIL_PIPELINE_H_
+
+// Cascade of models run over a sequence of frames. The first stage is a cheap
+// gate, and every later stage runs only when the stage before it ran and was
+// confident enough in its outputs, so uninteresting frames stop early. Each
+// stage has its own module and VM context on the one HAL device. The input
+// buffers of every stage wrap the static storage of its descriptor once, and
+// load_frame refills the storage in place for each frame, so a frame written
+// into the input of a later stage can feed the earlier ones without a copy.
+
+#include "samples/util/model_api.h"
+
+// Upper bound on the stages of a pipeline.
+#define ML_PIPELINE_MAX_STAGES 4
+
+// Confidence of a stage in its mapped outputs, from 0 to 1.
+typedef float (*MlConfidenceFn)(const MlModel *model,
+                                const iree_hal_buffer_mapping_t *outputs);
+
+typedef struct {
+  // The descriptor of the model, which the sample names with
+  // <MODEL>_DESCRIPTOR for all but kModel (see gen_mlmodel_header.py).
+  const MlModel *model;
+  MlCreateModuleFn create_module;
+  // The static library of the module, NULL for VMVX.
+  iree_hal_executable_library_query_fn_t library_query;
+  // Gate of the next stage, which runs when the confidence reaches
+  // `threshold`. NULL to always run the next stage.
+  MlConfidenceFn confidence;
+  float threshold;
+} MlPipelineStage;
+
+struct MlPipeline {
+  // Reported at the end of the run, like the model name of kModel.
+  const char *name;
+  iree_host_size_t num_stages;
+  const MlPipelineStage *stages;
+  uint32_t num_frames;
+  // Fill the input storage of the stages with frame `frame`.
+  iree_status_t (*load_frame)(const struct MlPipeline *pipeline,
+                              uint32_t frame);
+};
+
+// Run the stages of `pipeline` over its frames, each stage only once the one
+// before it passed its gate. Reports the stages each frame ran and its
+// cycles, then the frames each stage ran on, the skip rate of the gated stages
+// and the mean cycles per frame.
+iree_status_t run_pipeline(const MlPipeline *pipeline);
+
+// The static libraries of every stage of the pipeline, or the one of
+// library_query without a pipeline, for the static library loaders. Returns
+// their count.
+static inline iree_host_size_t pipeline_library_queries(
+    iree_hal_executable_library_query_fn_t *queries) {
+  const MlPipeline *pipeline = ml_pipeline ? ml_pipeline() : NULL;
+  if (!pipeline) {
+    queries[0] = library_query();
+    return 1;
+  }
+  iree_host_size_t count = 0;
+  for (iree_host_size_t i = 0; i < pipeline->num_stages; ++i) {
+    if (pipeline->stages[i].library_query) {
+      queries[count++] = pipeline->stages[i].library_query;
+    }
+  }
+  return count;
+}
+
+#endif  // SAMPLES_UTIL_PIPELINE_H_
@@ -0,0 +1,276 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "samples/util/result_cache.h"
+
+#include <springbok.h>
+#include <string.h>
+
+// The hash runs FNV-1a over 32-bit words in HASH_LANES interleaved lanes,
+// independent of each other so the loop vectorizes, then folds the lanes.
+#define HASH_LANES 16
+#define HASH_PRIME 0x01000193u
+#define HASH_BASIS 0x811c9dc5u
+#define FOLD_PRIME 0x100000001b3ull
+
+#define GRID_CELLS (RESULT_CACHE_GRID * RESULT_CACHE_GRID)
+
+// Hash `size` bytes at `data`, which has the alignment of the input storage.
+static uint64_t hash_bytes(const void *data, iree_host_size_t size,
+                           uint64_t hash) {
+  uint32_t lanes[HASH_LANES];
+  for (int lane = 0; lane < HASH_LANES; ++lane) {
+    lanes[lane] = HASH_BASIS + lane;
+  }
+  const uint32_t *words = (const uint32_t *)data;
+  iree_host_size_t num_words = size / sizeof(uint32_t);
+  iree_host_size_t num_blocks = num_words / HASH_LANES;
+  for (iree_host_size_t block = 0; block < num_blocks; ++block) {
+    for (int lane = 0; lane < HASH_LANES; ++lane) {
+      lanes[lane] = (lanes[lane] ^ words[block * HASH_LANES + lane]) *
+                    HASH_PRIME;
+    }
+  }
+  uint32_t tail = HASH_BASIS;
+  for (iree_host_size_t i = num_blocks * HASH_LANES; i < num_words; ++i) {
+    tail = (tail ^ words[i]) * HASH_PRIME;
+  }
+  const uint8_t *bytes = (const uint8_t *)data;
+  for (iree_host_size_t i = num_words * sizeof(uint32_t); i < size; ++i) {
+    tail = (tail ^ bytes[i]) * HASH_PRIME;
+  }
+
+  hash = (hash ^ size) * FOLD_PRIME;
+  for (int lane = 0; lane < HASH_LANES; ++lane) {
+    hash = (hash ^ lanes[lane]) * FOLD_PRIME;
+  }
+  return (hash ^ tail) * FOLD_PRIME;
+}
+
+// Add the elements of `type` at `data` to the grid cell of their row and
+// column, `rows` x `cols` pixels of `channels` elements.
+#define ACCUMULATE_GRID(type, data, rows, cols, channels, sums)             \
+  for (iree_host_size_t row = 0, i = 0; row < (rows); ++row) {              \
+    float *row_sums = &(sums)[row * RESULT_CACHE_GRID / (rows) *            \
+                              RESULT_CACHE_GRID];                           \
+    for (iree_host_size_t col = 0; col < (cols); ++col) {                   \
+      float *sum = &row_sums[col * RESULT_CACHE_GRID / (cols)];             \
+      for (iree_host_size_t c = 0; c < (channels); ++c, ++i) {              \
+        *sum += ((const type *)(data))[i];                                  \
+      }                                                                     \
+    }                                                                       \
+  }
+
+// Sign `input` with the block means of its grid, stretched to 0..255 in
+// `key->cells`, and the range of the means they were stretched over. Returns
+// false for an element type the grid does not read.
+static bool grid_signature(const MlTensor *input, ResultCacheEntry *key) {
+  // The two innermost dimensions before the channels are the rows and
+  // columns, with any batch folded into the rows; a vector is a single row.
+  iree_host_size_t rank = input->rank;
+  iree_host_size_t channels = rank >= 3 ? input->shape[rank - 1] : 1;
+  iree_host_size_t cols = rank >= 3 ? input->shape[rank - 2] : input->length;
+  if (cols * channels == 0 || input->length < cols * channels) {
+    return false;
+  }
+  iree_host_size_t rows = input->length / (cols * channels);
+
+  float sums[GRID_CELLS] = {0};
+  switch (input->element_type) {
+    case IREE_HAL_ELEMENT_TYPE_UINT_8:
+      ACCUMULATE_GRID(uint8_t, input->data, rows, cols, channels, sums);
+      break;
+    case IREE_HAL_ELEMENT_TYPE_SINT_8:
+      ACCUMULATE_GRID(int8_t, input->data, rows, cols, channels, sums);
+      break;
+    case IREE_HAL_ELEMENT_TYPE_SINT_32:
+      ACCUMULATE_GRID(int32_t, input->data, rows, cols, channels, sums);
+      break;
+    case IREE_HAL_ELEMENT_TYPE_FLOAT_32:
+      ACCUMULATE_GRID(float, input->data, rows, cols, channels, sums);
+      break;
+    default:
+      return false;
+  }
+
+  // Mean of each cell, over the pixels it covers.
+  float low = 0.0f;
+  float high = 0.0f;
+  for (int cell = 0; cell < GRID_CELLS; ++cell) {
+    int grid_row = cell / RESULT_CACHE_GRID;
+    int grid_col = cell % RESULT_CACHE_GRID;
+    iree_host_size_t cell_rows =
+        ((grid_row + 1) * rows + RESULT_CACHE_GRID - 1) / RESULT_CACHE_GRID -
+        (grid_row * rows + RESULT_CACHE_GRID - 1) / RESULT_CACHE_GRID;
+    iree_host_size_t cell_cols =
+        ((grid_col + 1) * cols + RESULT_CACHE_GRID - 1) / RESULT_CACHE_GRID -
+        (grid_col * cols + RESULT_CACHE_GRID - 1) / RESULT_CACHE_GRID;
+    iree_host_size_t count = cell_rows * cell_cols * channels;
+    sums[cell] = count ? sums[cell] / count : 0.0f;
+    low = cell == 0 || sums[cell] < low ? sums[cell] : low;
+    high = cell == 0 || sums[cell] > high ? sums[cell] : high;
+  }
+  float scale = high > low ? 255.0f / (high - low) : 0.0f;
+  for (int cell = 0; cell < GRID_CELLS; ++cell) {
+    key->cells[cell] = (uint8_t)((sums[cell] - low) * scale + 0.5f);
+  }
+  key->low = low;
+  key->high = high;
+  return true;
+}
+
+// Sum of the absolute differences of two grids.
+static uint32_t grid_distance(const uint8_t *a, const uint8_t *b) {
+  uint32_t distance = 0;
+  for (int cell = 0; cell < GRID_CELLS; ++cell) {
+    distance += a[cell] > b[cell] ? a[cell] - b[cell] : b[cell] - a[cell];
+  }
+  return distance;
+}
+
+// Whether two signatures are within RESULT_CACHE_TOLERANCE: the distance of
+// their grids, plus how far the range of the cell means moved, counted in
+// stretched cell units for every cell it moves. The stretch alone would map
+// frames of any brightness and contrast, such as all uniform frames, to the
+// same cells.
+static bool signatures_match(const ResultCacheEntry *a,
+                             const ResultCacheEntry *b) {
+  float shift = (a->low > b->low ? a->low - b->low : b->low - a->low) +
+                (a->high > b->high ? a->high - b->high : b->high - a->high);
+  float range = a->high - a->low > b->high - b->low ? a->high - a->low
+                                                    : b->high - b->low;
+  if (shift > 0.0f && range <= 0.0f) {
+    return false;
+  }
+  float level =
+      shift > 0.0f ? shift * 0.5f * GRID_CELLS * 255.0f / range : 0.0f;
+  return grid_distance(a->cells, b->cells) + level <=
+         (float)RESULT_CACHE_TOLERANCE;
+}
+
+static iree_host_size_t outputs_size(const MlModel *model) {
+  iree_host_size_t size = 0;
+  for (iree_host_size_t i = 0; i < model->num_output; ++i) {
+    size += model->outputs[i].size_bytes;
+  }
+  return size;
+}
+
+iree_status_t result_cache_create(const MlModel *model, uint32_t mode,
+                                  ResultCache *cache) {
+  memset(cache, 0, sizeof(*cache));
+  cache->mode = mode;
+  for (iree_host_size_t i = 0; i < model->num_output; ++i) {
+    if (model->outputs[i].dynamic_dims) {
+      return iree_make_status(IREE_STATUS_UNIMPLEMENTED,
+                              "no result cache for dynamic output %u",
+                              (unsigned)i);
+    }
+  }
+  iree_host_size_t size = outputs_size(model);
+  for (int i = 0; i < RESULT_CACHE_ENTRIES; ++i) {
+    IREE_RETURN_IF_ERROR(iree_allocator_malloc(
+        iree_allocator_system(), size, (void **)&cache->entries[i].outputs));
+  }
+  return iree_ok_status();
+}
+
+bool result_cache_lookup(ResultCache *cache, const MlModel *model) {
+  uint32_t start_cycles = springbok_ccount();
+  ResultCacheEntry *key = &cache->key;
+  bool perceptual = cache->mode == RESULT_CACHE_PERCEPTUAL &&
+                    grid_signature(&model->inputs[0], key);
+  key->hash = 0;
+  for (iree_host_size_t i = perceptual ? 1 : 0; i < model->num_input; ++i) {
+    key->hash = hash_bytes(model->inputs[i].data, model->inputs[i].size_bytes,
+                           key->hash);
+  }
+  if (!perceptual) {
+    // An input the grid does not read is hashed instead.
+    memset(key->cells, 0, sizeof(key->cells));
+    key->low = 0.0f;
+    key->high = 0.0f;
+  }
+
+  const ResultCacheEntry *hit = NULL;
+  for (int i = 0; i < RESULT_CACHE_ENTRIES && !hit; ++i) {
+    const ResultCacheEntry *entry = &cache->entries[i];
+    if (entry->valid && entry->hash == key->hash &&
+        signatures_match(entry, key)) {
+      hit = entry;
+    }
+  }
+  if (hit) {
+    const uint8_t *outputs = hit->outputs;
+    for (iree_host_size_t i = 0; i < model->num_output; ++i) {
+      iree_hal_buffer_mapping_t *mapping = &model->output_mappings[i];
+      memset(mapping, 0, sizeof(*mapping));
+      mapping->contents =
+          iree_make_byte_span((void *)outputs, model->outputs[i].size_bytes);
+      outputs += model->outputs[i].size_bytes;
+    }
+    cache->hits++;
+  }
+  cache->lookups++;
+  cache->signature_cycles += springbok_ccount() - start_cycles;
+  return hit != NULL;
+}
+
+void result_cache_store(ResultCache *cache, const MlModel *model,
+                        uint32_t cycles) {
+  ResultCacheEntry *entry = &cache->entries[cache->next];
+  cache->next = (cache->next + 1) % RESULT_CACHE_ENTRIES;
+  entry->valid = 1;
+  entry->hash = cache->key.hash;
+  memcpy(entry->cells, cache->key.cells, sizeof(entry->cells));
+  entry->low = cache->key.low;
+  entry->high = cache->key.high;
+  uint8_t *outputs = entry->outputs;
+  for (iree_host_size_t i = 0; i < model->num_output; ++i) {
+    memcpy(outputs, model->output_mappings[i].contents.data,
+           model->outputs[i].size_bytes);
+    outputs += model->outputs[i].size_bytes;
+  }
+  cache->miss_cycles += cycles;
+}
+
+void result_cache_report(const ResultCache *cache) {
+  if (cache->lookups == 0) {
+    return;
+  }
+  uint32_t misses = cache->lookups - cache->hits;
+  uint32_t basis_points = (uint64_t)cache->hits * 10000 / cache->lookups;
+  LOG_INFO("Result cache: %u hits of %u lookups (%u.%02u%%)",
+           (unsigned)cache->hits, (unsigned)cache->lookups,
+           (unsigned)(basis_points / 100), (unsigned)(basis_points % 100));
+  uint32_t signature_cycles = cache->signature_cycles / cache->lookups;
+  uint32_t miss_cycles = misses ? cache->miss_cycles / misses : 0;
+  // Every hit saves a miss, and every lookup pays for its signature.
+  int64_t saved = (int64_t)cache->hits * miss_cycles - cache->signature_cycles;
+  uint64_t magnitude = saved < 0 ? -saved : saved;
+  LOG_INFO("Result cache: %u cycles per signature, %u cycles per miss, "
+           "%u cycles %s",
+           (unsigned)signature_cycles, (unsigned)miss_cycles,
+           (unsigned)(magnitude > UINT32_MAX ? UINT32_MAX : magnitude),
+           saved < 0 ? "lost" : "saved");
+}
+
+void result_cache_destroy(ResultCache *cache) {
+  for (int i = 0; i < RESULT_CACHE_ENTRIES; ++i) {
+    iree_allocator_free(iree_allocator_system(), cache->entries[i].outputs);
+    cache->entries[i].outputs = NULL;
+  }
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLES_UTIL_RESULT_CACHE_H_
+#define SAMPLES_UTIL_RESULT_CACHE_H_
+
+// Result cache in front of the invocations of the dataset and server modes.
+// Consecutive frames of a camera are often the same, or close to it, so each
+// invocation is keyed on a signature of the inputs in their static storage,
+// and the outputs of the last RESULT_CACHE_ENTRIES misses are kept. A hit
+// hands the cached outputs to the output processing without running the
+// model.
+//
+// RESULT_CACHE_EXACT signs the inputs with a 64-bit hash over independent
+// word lanes, which the vectorizer maps onto RVV. RESULT_CACHE_PERCEPTUAL
+// signs the first input with a RESULT_CACHE_GRID x RESULT_CACHE_GRID grid of
+// block means over its two innermost spatial dimensions, stretched to 0..255
+// like an average hash, and the range of the means, so frames within
+// RESULT_CACHE_TOLERANCE of each other in both hit too. The other inputs are
+// hashed exactly in both modes.
+
+#include <stdint.h>
+
+#include "samples/util/model_api.h"
+
+#define RESULT_CACHE_ENTRIES 4
+#define RESULT_CACHE_GRID 8
+// Largest sum of the absolute differences of the grid cells of two inputs
+// that still hit, the shift of their range of cell means included.
+#if !defined(RESULT_CACHE_TOLERANCE)
+#define RESULT_CACHE_TOLERANCE 64
+#endif
+
+typedef struct {
+  // 0 until the entry holds the outputs of a miss.
+  uint32_t valid;
+  uint64_t hash;
+  uint8_t cells[RESULT_CACHE_GRID * RESULT_CACHE_GRID];
+  // Lowest and highest cell means, which the cells are stretched between.
+  float low;
+  float high;
+  // The outputs of the model back to back.
+  uint8_t *outputs;
+} ResultCacheEntry;
+
+typedef struct {
+  uint32_t mode;  // RESULT_CACHE_EXACT or RESULT_CACHE_PERCEPTUAL.
+  ResultCacheEntry entries[RESULT_CACHE_ENTRIES];
+  // Entry the next miss replaces, round robin.
+  uint32_t next;
+  // Signature of the last lookup, stored with its outputs on a miss.
+  ResultCacheEntry key;
+  uint32_t lookups;
+  uint32_t hits;
+  uint64_t signature_cycles;
+  uint64_t miss_cycles;
+} ResultCache;
+
+// Set up a cache for the outputs of `model`, which must all have a static
+// shape.
+iree_status_t result_cache_create(const MlModel *model, uint32_t mode,
+                                  ResultCache *cache);
+
+// Sign the inputs of the model and look them up. On a hit, point
+// model->output_mappings at the cached outputs and return true.
+bool result_cache_lookup(ResultCache *cache, const MlModel *model);
+
+// Keep the mapped outputs of a miss, which took `cycles` to invoke, under the
+// signature of the last lookup.
+void result_cache_store(ResultCache *cache, const MlModel *model,
+                        uint32_t cycles);
+
+// Log the hit rate and the cycles the hits saved.
+void result_cache_report(const ResultCache *cache);
+
+void result_cache_destroy(ResultCache *cache);
+
+#endif  // SAMPLES_UTIL_RESULT_CACHE_H_
@@ -0,0 +1,476 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "samples/util/runtime.h"
+
+#include <springbok.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "iree/modules/hal/inline/module.h"
+#include "iree/modules/hal/loader/module.h"
+#include "samples/device/device.h"
+#include "samples/util/direct_call.h"
+#if defined(BUILD_INLINE_HAL) && defined(SPRINGBOK_VMVX_UKERNELS)
+#include "samples/device/vmvx_ukernel_module.h"
+#endif
+
+typedef struct {
+  uint32_t return_code;  // Populated in crt0.S
+  uint32_t epc;          // Populated in crt0.S
+  uint32_t length;
+} OutputHeader;
+
+OutputHeader output_header;
+
+static const char *const kStartupPhaseNames[STARTUP_PHASE_COUNT] = {
+    "instance", "device", "module", "context", "inputs",
+};
+
+// Cycle count at the end of each startup phase, 0 until it is marked.
+static uint32_t startup_ccount[STARTUP_PHASE_COUNT];
+
+void mark_startup_phase(StartupPhase phase) {
+  if (startup_ccount[phase] == 0) {
+    startup_ccount[phase] = springbok_ccount();
+  }
+}
+
+// Report the cycles from reset to the first iree_vm_invoke.
+static void print_startup_phases(void) {
+  uint32_t reset = springbok_boot_ccount[SPRINGBOK_BOOT_RESET];
+  uint32_t libc_init = springbok_boot_ccount[SPRINGBOK_BOOT_LIBC_INIT];
+  uint32_t main_entry = springbok_boot_ccount[SPRINGBOK_BOOT_MAIN];
+  LOG_INFO("Startup phase crt0: %u cycles", (unsigned)(libc_init - reset));
+  LOG_INFO("Startup phase libc_init: %u cycles",
+           (unsigned)(main_entry - libc_init));
+  uint32_t previous = main_entry;
+  for (int i = 0; i < STARTUP_PHASE_COUNT; ++i) {
+    LOG_INFO("Startup phase %s: %u cycles", kStartupPhaseNames[i],
+             (unsigned)(startup_ccount[i] - previous));
+    previous = startup_ccount[i];
+  }
+  LOG_INFO("Startup total: %u cycles to the first inference",
+           (unsigned)(previous - reset));
+}
+
+iree_status_t runtime_create(Runtime *runtime) {
+  iree_allocator_t host_allocator = iree_allocator_system();
+  IREE_RETURN_IF_ERROR(
+      iree_vm_instance_create(host_allocator, &runtime->instance));
+
+  // Only the types of the HAL flavor in use are registered.
+#if defined(BUILD_INLINE_HAL)
+  iree_status_t result =
+      iree_hal_module_register_inline_types(runtime->instance);
+#elif defined(BUILD_LOADER_HAL)
+  iree_status_t result =
+      iree_hal_module_register_loader_types(runtime->instance);
+#else
+  iree_status_t result = iree_hal_module_register_all_types(runtime->instance);
+#endif
+  mark_startup_phase(STARTUP_INSTANCE);
+
+  if (iree_status_is_ok(result)) {
+    result =
+        create_sample_device(host_allocator, &runtime->device, &runtime->loader);
+  }
+  mark_startup_phase(STARTUP_DEVICE);
+  return result;
+}
+
+void runtime_release(Runtime *runtime) {
+  if (runtime->device) {
+    IREE_IGNORE_ERROR(iree_hal_allocator_statistics_fprint(
+        stdout, iree_hal_device_allocator(runtime->device)));
+  }
+  iree_hal_device_release(runtime->device);
+  iree_hal_executable_loader_release(runtime->loader);
+  iree_vm_instance_release(runtime->instance);
+}
+
+void runtime_start_inference(void) {
+  mark_startup_phase(STARTUP_INPUTS);
+  // Runs restored from a snapshot taken at this marker start here.
+  springbok_marker(SPRINGBOK_MARKER_INFERENCE);
+  print_startup_phases();
+}
+
+// Create context that will hold the state of the module `create` makes across
+// invocations.
+static iree_status_t create_context(const Runtime *runtime,
+                                    MlCreateModuleFn create,
+                                    iree_vm_context_t **context) {
+  iree_allocator_t host_allocator = iree_allocator_system();
+  iree_vm_instance_t *instance = runtime->instance;
+
+  // Load bytecode or C module.
+  iree_vm_module_t *module = NULL;
+  iree_status_t result = create(instance, &module);
+  mark_startup_phase(STARTUP_MODULE);
+
+#if defined(BUILD_INLINE_HAL) || defined(BUILD_LOADER_HAL)
+  // Create hal_inline_module
+  iree_vm_module_t *hal_inline_module = NULL;
+  if (iree_status_is_ok(result)) {
+    result = iree_hal_inline_module_create(
+        instance, IREE_HAL_INLINE_MODULE_FLAG_NONE,
+        iree_hal_device_allocator(runtime->device), host_allocator,
+        &hal_inline_module);
+  }
+#endif
+#if defined(BUILD_INLINE_HAL) && defined(SPRINGBOK_VMVX_UKERNELS)
+  // vmvx-inline programs call the VMVX microkernels directly from the module.
+  iree_vm_module_t *vmvx_module = NULL;
+  if (iree_status_is_ok(result)) {
+    result = create_vmvx_ukernel_module(instance, host_allocator, &vmvx_module);
+  }
+  iree_vm_module_t *modules[] = {hal_inline_module, vmvx_module, module};
+#elif defined(BUILD_INLINE_HAL)
+  iree_vm_module_t *modules[] = {hal_inline_module, module};
+#elif defined(BUILD_LOADER_HAL)
+  // Create hal_loader_module
+  iree_vm_module_t *hal_loader_module = NULL;
+  iree_hal_executable_loader_t *loader = runtime->loader;
+  if (iree_status_is_ok(result)) {
+    result = iree_hal_loader_module_create(instance, IREE_HAL_MODULE_FLAG_NONE,
+                                           /*loader_count=*/1, &loader,
+                                           host_allocator, &hal_loader_module);
+  }
+  iree_vm_module_t *modules[] = {hal_inline_module, hal_loader_module, module};
+#else
+  // Create hal_module
+  iree_vm_module_t *hal_module = NULL;
+  if (iree_status_is_ok(result)) {
+    result = iree_hal_module_create(instance, runtime->device,
+                                    IREE_HAL_MODULE_FLAG_NONE, host_allocator,
+                                    &hal_module);
+  }
+  iree_vm_module_t *modules[] = {hal_module, module};
+#endif
+
+  // Allocate a context that will hold the module state across invocations.
+  if (iree_status_is_ok(result)) {
+    result = iree_vm_context_create_with_modules(
+        instance, IREE_VM_CONTEXT_FLAG_NONE, IREE_ARRAYSIZE(modules),
+        &modules[0], host_allocator, context);
+  }
+#if defined(BUILD_INLINE_HAL) || defined(BUILD_LOADER_HAL)
+  iree_vm_module_release(hal_inline_module);
+#else
+  iree_vm_module_release(hal_module);
+#endif
+#if defined(BUILD_INLINE_HAL) && defined(SPRINGBOK_VMVX_UKERNELS)
+  iree_vm_module_release(vmvx_module);
+#elif defined(BUILD_LOADER_HAL)
+  iree_vm_module_release(hal_loader_module);
+#endif
+  iree_vm_module_release(module);
+  mark_startup_phase(STARTUP_CONTEXT);
+  return result;
+}
+
+iree_host_size_t shape_length(iree_host_size_t rank,
+                              const iree_hal_dim_t *shape) {
+  iree_host_size_t length = 1;
+  for (iree_host_size_t i = 0; i < rank; ++i) {
+    length *= shape[i];
+  }
+  return length;
+}
+
+// Byte size of `input` at `shape`.
+static iree_host_size_t input_size_bytes(const MlTensor *input,
+                                         const iree_hal_dim_t *shape) {
+  return input->length ? shape_length(input->rank, shape) *
+                             (input->size_bytes / input->length)
+                       : 0;
+}
+
+// Wrap the statically allocated storage of input `index` in a buffer view of
+// `shape`, sized from it. The buffer view must be released by the caller.
+static iree_status_t wrap_input_hal_buffer_view(
+    const MlModel *model, iree_host_size_t index, const iree_hal_dim_t *shape,
+    iree_hal_device_t *device, iree_hal_buffer_view_t **out_buffer_view) {
+  const MlTensor *input = &model->inputs[index];
+  iree_host_size_t size_bytes = input_size_bytes(input, shape);
+
+  // Import the storage in place rather than copying it into a new allocation.
+  // The buffers can be mapped on the CPU and that can also be used
+  // on the device. Not all devices support this, but the ones we have now do.
+  iree_hal_buffer_params_t buffer_params = {
+      .type =
+          IREE_HAL_MEMORY_TYPE_HOST_LOCAL | IREE_HAL_MEMORY_TYPE_DEVICE_VISIBLE,
+      .access = IREE_HAL_MEMORY_ACCESS_READ,
+      .usage = IREE_HAL_BUFFER_USAGE_DEFAULT};
+  iree_hal_external_buffer_t external_buffer = {
+      .type = IREE_HAL_EXTERNAL_BUFFER_TYPE_HOST_ALLOCATION,
+      .flags = IREE_HAL_EXTERNAL_BUFFER_FLAG_NONE,
+      .size = size_bytes,
+      .handle.host_allocation.ptr = input->data,
+  };
+  iree_hal_buffer_t *buffer = NULL;
+  IREE_RETURN_IF_ERROR(iree_hal_allocator_import_buffer(
+      iree_hal_device_allocator(device), buffer_params, &external_buffer,
+      iree_hal_buffer_release_callback_null(), &buffer));
+
+  // Wrap buffers in shaped buffer views.
+  iree_status_t result = iree_hal_buffer_view_create(
+      buffer, input->rank, shape, input->element_type,
+      IREE_HAL_ENCODING_TYPE_DENSE_ROW_MAJOR, iree_allocator_system(),
+      out_buffer_view);
+  iree_hal_buffer_release(buffer);
+  return result;
+}
+
+iree_status_t prepare_input_hal_buffer_view(
+    const MlModel *model, iree_host_size_t index, const iree_hal_dim_t *shape,
+    iree_hal_device_t *device, iree_hal_buffer_view_t **out_buffer_view) {
+  const MlTensor *input = &model->inputs[index];
+  IREE_RETURN_IF_ERROR(load_input_data(
+      model, index,
+      iree_make_byte_span(input->data, input_size_bytes(input, shape))));
+  return wrap_input_hal_buffer_view(model, index, shape, device,
+                                    out_buffer_view);
+}
+
+iree_status_t create_invocation(const Runtime *runtime, const MlModel *model,
+                                MlCreateModuleFn create, bool load,
+                                Invocation *invocation) {
+  IREE_RETURN_IF_ERROR(create_context(runtime, create, &invocation->context));
+  // Lookup the entry point function.
+  // Note that we use the synchronous variant which operates on pure type/shape
+  // erased buffers.
+  IREE_RETURN_IF_ERROR(iree_vm_context_resolve_function(
+      invocation->context, iree_make_cstring_view(model->entry_func),
+      &invocation->function));
+
+  // Setup call inputs with our buffers.
+  iree_status_t result = iree_vm_list_create(
+      /*element_type=*/NULL, /*capacity=*/model->num_input,
+      iree_allocator_system(), &invocation->inputs);
+  for (iree_host_size_t i = 0; i < model->num_input; ++i) {
+    const iree_hal_dim_t *shape = model->inputs[i].shape;
+    iree_hal_buffer_view_t *arg_buffer_view = NULL;
+    if (iree_status_is_ok(result)) {
+      result = load ? prepare_input_hal_buffer_view(
+                          model, i, shape, runtime->device, &arg_buffer_view)
+                    : wrap_input_hal_buffer_view(
+                          model, i, shape, runtime->device, &arg_buffer_view);
+    }
+    if (iree_status_is_ok(result)) {
+      iree_vm_ref_t arg_buffer_view_ref =
+          iree_hal_buffer_view_move_ref(arg_buffer_view);
+      result = iree_vm_list_push_ref_move(invocation->inputs,
+                                          &arg_buffer_view_ref);
+    }
+  }
+
+  // Prepare outputs list to accept the results from the invocation.
+  if (iree_status_is_ok(result)) {
+    result = iree_vm_list_create(
+        /*element_type=*/NULL,
+        /*capacity=*/model->num_output, iree_allocator_system(),
+        &invocation->outputs);
+  }
+
+  if (iree_status_is_ok(result)) {
+    result = iree_allocator_malloc(
+        iree_allocator_system(),
+        (model->num_input + model->num_output) * sizeof(void *),
+        (void **)&invocation->input_views);
+  }
+  if (iree_status_is_ok(result)) {
+    invocation->output_views = invocation->input_views + model->num_input;
+    memset(invocation->output_views, 0, model->num_output * sizeof(void *));
+    for (iree_host_size_t i = 0; i < model->num_input; ++i) {
+      invocation->input_views[i] =
+          (iree_hal_buffer_view_t *)iree_vm_list_get_ref_deref(
+              invocation->inputs, i, iree_hal_buffer_view_get_descriptor());
+    }
+    // The direct call assumes the buffer view in, buffer view out signature
+    // of the descriptor.
+    if (model->direct_call &&
+        direct_call_matches(invocation->function, model->num_input,
+                            model->num_output)) {
+      invocation->direct_call = model->direct_call;
+    } else if (model->direct_call) {
+      LOG_WARN("%s does not take and return buffer views only, calling it "
+               "through iree_vm_invoke",
+               model->entry_func);
+    }
+  }
+  return result;
+}
+
+void release_invocation(Invocation *invocation) {
+  iree_allocator_free(iree_allocator_system(), invocation->input_views);
+  iree_vm_list_release(invocation->inputs);
+  iree_vm_list_release(invocation->outputs);
+  iree_vm_context_release(invocation->context);
+}
+
+iree_status_t invoke(Invocation *invocation) {
+  if (invocation->direct_call) {
+    return invocation->direct_call(invocation->context, invocation->function,
+                                   invocation->input_views,
+                                   invocation->output_views);
+  }
+  return iree_vm_invoke(invocation->context, invocation->function,
+                        IREE_VM_CONTEXT_FLAG_NONE, /*policy=*/NULL,
+                        invocation->inputs, invocation->outputs,
+                        iree_allocator_system());
+}
+
+// Check the shape and byte size of an output against the model descriptor,
+// which leaves the dynamic dimensions to the invocation.
+static iree_status_t check_output(const MlTensor *output,
+                                  iree_hal_buffer_view_t *buffer_view) {
+  bool matches = iree_hal_buffer_view_shape_rank(buffer_view) == output->rank &&
+                 (output->dynamic_dims ||
+                  iree_hal_buffer_view_byte_length(buffer_view) ==
+                      output->size_bytes);
+  for (iree_host_size_t i = 0; matches && i < output->rank; ++i) {
+    matches =
+        (output->dynamic_dims & (1u << i)) ||
+        iree_hal_buffer_view_shape_dim(buffer_view, i) == output->shape[i];
+  }
+  if (!matches) {
+    return iree_make_status(IREE_STATUS_UNKNOWN, "output shape mismatches");
+  }
+  return iree_ok_status();
+}
+
+iree_status_t map_outputs(const MlModel *model, const Invocation *invocation) {
+  iree_hal_buffer_mapping_t *mapped_memories = model->output_mappings;
+  iree_status_t result = iree_ok_status();
+  for (iree_host_size_t index_output = 0; index_output < model->num_output;
+       index_output++) {
+    iree_hal_buffer_view_t *ret_buffer_view = NULL;
+    if (iree_status_is_ok(result)) {
+      // Get the result buffers from the invocation.
+      ret_buffer_view =
+          invocation->direct_call
+              ? invocation->output_views[index_output]
+              : (iree_hal_buffer_view_t *)iree_vm_list_get_ref_deref(
+                    invocation->outputs, index_output,
+                    iree_hal_buffer_view_get_descriptor());
+      if (ret_buffer_view == NULL) {
+        result = iree_make_status(IREE_STATUS_NOT_FOUND,
+                                  "can't find return buffer view");
+      }
+    }
+    if (iree_status_is_ok(result)) {
+      result = check_output(&model->outputs[index_output], ret_buffer_view);
+    }
+    if (iree_status_is_ok(result)) {
+      result = iree_hal_buffer_map_range(
+          iree_hal_buffer_view_buffer(ret_buffer_view),
+          IREE_HAL_MAPPING_MODE_SCOPED, IREE_HAL_MEMORY_ACCESS_READ, 0,
+          IREE_WHOLE_BUFFER, &mapped_memories[index_output]);
+    }
+  }
+  return result;
+}
+
+// Unmap whatever map_outputs mapped.
+static void unmap_outputs(const MlModel *model) {
+  iree_hal_buffer_mapping_t *mapped_memories = model->output_mappings;
+  for (iree_host_size_t index_output = 0; index_output < model->num_output;
+       index_output++) {
+    if (mapped_memories[index_output].contents.data != NULL) {
+      iree_hal_buffer_unmap_range(&mapped_memories[index_output]);
+    }
+  }
+  memset(mapped_memories, 0, model->num_output * sizeof(*mapped_memories));
+}
+
+iree_status_t release_outputs(const MlModel *model, Invocation *invocation) {
+  if (invocation->cache_hit) {
+    // Nothing ran, so there is nothing to unmap or drop.
+    memset(model->output_mappings, 0,
+           model->num_output * sizeof(*model->output_mappings));
+    invocation->cache_hit = false;
+    return iree_ok_status();
+  }
+  unmap_outputs(model);
+  if (invocation->direct_call) {
+    for (iree_host_size_t i = 0; i < model->num_output; ++i) {
+      iree_hal_buffer_view_release(invocation->output_views[i]);
+      invocation->output_views[i] = NULL;
+    }
+    return iree_ok_status();
+  }
+  return iree_vm_list_resize(invocation->outputs, 0);
+}
+
+iree_status_t invoke_and_map(const MlModel *model, Invocation *invocation,
+                             uint32_t *cycles) {
+  uint32_t start_cycles = springbok_ccount();
+  if (invocation->cache && result_cache_lookup(invocation->cache, model)) {
+    invocation->cache_hit = true;
+    *cycles = springbok_ccount() - start_cycles;
+    return iree_ok_status();
+  }
+  start_cycles = springbok_ccount();
+  iree_status_t result = invoke(invocation);
+  *cycles = springbok_ccount() - start_cycles;
+  if (iree_status_is_ok(result)) {
+    result = map_outputs(model, invocation);
+  }
+  if (iree_status_is_ok(result) && invocation->cache) {
+    result_cache_store(invocation->cache, model, *cycles);
+  }
+  return result;
+}
+
+iree_status_t write_output(const MlModel *model) {
+  uint32_t length = 0;
+  iree_status_t result =
+      process_output(model, model->output_mappings, &length);
+  output_header.length = length;
+  return result;
+}
+
+const char *format_fixed(uint64_t value, int decimals,
+                         char buffer[NUMBER_TEXT_SIZE]) {
+  char *digit = &buffer[NUMBER_TEXT_SIZE - 1];
+  *digit = '\0';
+  for (int i = 0; i < decimals; ++i) {
+    *--digit = (char)('0' + value % 10);
+    value /= 10;
+  }
+  if (decimals > 0) {
+    *--digit = '.';
+  }
+  do {
+    *--digit = (char)('0' + value % 10);
+    value /= 10;
+  } while (value);
+  return digit;
+}
+
+const char *format_u64(uint64_t value, char buffer[NUMBER_TEXT_SIZE]) {
+  return format_fixed(value, 0, buffer);
+}
+
+void print_energy(const char *name, uint64_t picojoules) {
+  if (picojoules == 0) {
+    return;
+  }
+  char text[NUMBER_TEXT_SIZE];
+  LOG_INFO("%s: %s nJ", name, format_fixed(picojoules, 3, text));
+}
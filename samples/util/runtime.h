@@ -0,0 +1,141 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLES_UTIL_RUNTIME_H_
+#define SAMPLES_UTIL_RUNTIME_H_
+
+// Runtime setup and invocation shared by the run modes of util.c: the single
+// inference, the dataset, shapes and server runs, and the pipeline. The VM
+// instance and HAL device are created once, and every model gets its own
+// context and Invocation on them.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "samples/util/model_api.h"
+#include "samples/util/result_cache.h"
+
+// Startup phases between main and the first inference, following the boot
+// phases crt0 timestamps in springbok_boot_ccount.
+typedef enum {
+  STARTUP_INSTANCE = 0,  // VM instance and HAL type registration.
+  STARTUP_DEVICE,        // HAL device and executable loader.
+  STARTUP_MODULE,        // Bytecode (verified and loaded) or C module.
+  STARTUP_CONTEXT,       // HAL module and VM context.
+  STARTUP_INPUTS,        // Entry function lookup and input buffers.
+  STARTUP_PHASE_COUNT,
+} StartupPhase;
+
+// The VM instance and HAL device the contexts share.
+typedef struct {
+  iree_vm_instance_t *instance;
+  iree_hal_device_t *device;
+  iree_hal_executable_loader_t *loader;
+} Runtime;
+
+// One call of the entry function of a model in its own context, through
+// iree_vm_invoke and its lists, or through the direct call of the model when
+// it has one.
+typedef struct {
+  iree_vm_context_t *context;
+  iree_vm_function_t function;
+  iree_vm_list_t *inputs;
+  iree_vm_list_t *outputs;
+  MlDirectCallFn direct_call;  // NULL to go through iree_vm_invoke.
+  // The buffer views of `inputs`, for the direct call.
+  iree_hal_buffer_view_t **input_views;
+  // The results of the direct call, retained until release_outputs.
+  iree_hal_buffer_view_t **output_views;
+  // Result cache of the dataset and server runs, NULL for none.
+  ResultCache *cache;
+  // Set while model->output_mappings point into the cache.
+  bool cache_hit;
+} Invocation;
+
+// 64-bit and fractional values are formatted by hand, as newlib-nano printf
+// has neither %llu nor floating point. A buffer of NUMBER_TEXT_SIZE holds any
+// of them.
+#define NUMBER_TEXT_SIZE 22
+
+// Record the end of startup phase `phase`. Only the first mark of a phase
+// counts, so with several models the module and context phases are those of
+// the first one, and the setup of the others falls in the inputs phase.
+void mark_startup_phase(StartupPhase phase);
+
+// Create the VM instance and HAL device, marking their startup phases.
+// Released by runtime_release, also on failure.
+iree_status_t runtime_create(Runtime *runtime);
+
+// Report the allocator statistics of the device and release the runtime.
+void runtime_release(Runtime *runtime);
+
+// End the startup at the inference marker, which runs restored from a
+// snapshot start from, and report the startup phases.
+void runtime_start_inference(void);
+
+// Create the context of the module `create` makes and set up the invocation
+// of the entry function of `model` in it, with input buffers wrapping the
+// static storage of the descriptor at its shape, loaded through
+// load_input_data if `load`. Released by release_invocation, also on failure.
+iree_status_t create_invocation(const Runtime *runtime, const MlModel *model,
+                                MlCreateModuleFn create, bool load,
+                                Invocation *invocation);
+
+void release_invocation(Invocation *invocation);
+
+// Number of elements of a tensor of `rank` dimensions at `shape`.
+iree_host_size_t shape_length(iree_host_size_t rank,
+                              const iree_hal_dim_t *shape);
+
+// Load the data of input `index` at `shape` and wrap its storage in a buffer
+// view. The buffer view must be released by the caller.
+iree_status_t prepare_input_hal_buffer_view(
+    const MlModel *model, iree_host_size_t index, const iree_hal_dim_t *shape,
+    iree_hal_device_t *device, iree_hal_buffer_view_t **out_buffer_view);
+
+iree_status_t invoke(Invocation *invocation);
+
+// Validate the outputs of an invocation against the model descriptor and map
+// their buffers into model->output_mappings.
+iree_status_t map_outputs(const MlModel *model, const Invocation *invocation);
+
+// Unmap the outputs and drop them, so the next invocation starts from an
+// empty output list.
+iree_status_t release_outputs(const MlModel *model, Invocation *invocation);
+
+// Invoke the entry function on the loaded inputs and map the outputs, or
+// map the cached outputs of the same inputs when the invocation has a result
+// cache that holds them. Sets `cycles` to the cycles of the invocation, or of
+// the lookup on a hit.
+iree_status_t invoke_and_map(const MlModel *model, Invocation *invocation,
+                             uint32_t *cycles);
+
+// Post-process the mapped outputs into the output sent to the host.
+iree_status_t write_output(const MlModel *model);
+
+// Decimal text of `value` / 10^`decimals` in `buffer`, with `decimals`
+// digits after the point.
+const char *format_fixed(uint64_t value, int decimals,
+                         char buffer[NUMBER_TEXT_SIZE]);
+
+// Decimal text of `value` in `buffer`.
+const char *format_u64(uint64_t value, char buffer[NUMBER_TEXT_SIZE]);
+
+// Log an energy estimate of the simulator, given in picojoules, unless its
+// energy model is off.
+void print_energy(const char *name, uint64_t picojoules);
+
+#endif  // SAMPLES_UTIL_RUNTIME_H_
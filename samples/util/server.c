@@ -0,0 +1,126 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "samples/util/server.h"
+
+#include <springbok.h>
+#include <string.h>
+
+volatile ServerQueue springbok_server_queue;
+
+static void *staging = NULL;
+
+iree_status_t server_open(const MlModel *model) {
+  iree_host_size_t input_size = 0;
+  for (iree_host_size_t i = 0; i < model->num_input; ++i) {
+    input_size += model->inputs[i].size_bytes;
+  }
+  iree_host_size_t output_size = 0;
+  for (iree_host_size_t i = 0; i < model->num_output; ++i) {
+    output_size += model->outputs[i].size_bytes;
+  }
+  iree_host_size_t slot_size = iree_host_align(input_size + output_size,
+                                               IREE_HAL_HEAP_BUFFER_ALIGNMENT);
+  IREE_RETURN_IF_ERROR(iree_allocator_malloc(iree_allocator_system(),
+                                             SERVER_QUEUE_DEPTH * slot_size,
+                                             &staging));
+  springbok_server_queue.depth = SERVER_QUEUE_DEPTH;
+  springbok_server_queue.slot_size = slot_size;
+  springbok_server_queue.input_size = input_size;
+  springbok_server_queue.output_size = output_size;
+  springbok_server_queue.staging_address = (uint32_t)(uintptr_t)staging;
+  return iree_ok_status();
+}
+
+void server_load_request(const MlModel *model,
+                         const volatile ServerRequest *request) {
+  const uint8_t *source = (const uint8_t *)(uintptr_t)request->input_address;
+  if (source == NULL) {
+    return;
+  }
+  for (iree_host_size_t i = 0; i < model->num_input; ++i) {
+    memcpy(model->inputs[i].data, source, model->inputs[i].size_bytes);
+    source += model->inputs[i].size_bytes;
+  }
+}
+
+void server_store_outputs(const MlModel *model,
+                          const volatile ServerRequest *request) {
+  uint8_t *destination = (uint8_t *)(uintptr_t)request->output_address;
+  if (destination == NULL) {
+    return;
+  }
+  for (iree_host_size_t i = 0; i < model->num_output; ++i) {
+    memcpy(destination, model->output_mappings[i].contents.data,
+           model->outputs[i].size_bytes);
+    destination += model->outputs[i].size_bytes;
+  }
+}
+
+void server_close(void) {
+  iree_allocator_free(iree_allocator_system(), staging);
+  staging = NULL;
+  springbok_server_queue.staging_address = 0;
+}
+
+iree_status_t run_server(const MlModel *model, Invocation *invocation) {
+  volatile ServerQueue *queue = &springbok_server_queue;
+  IREE_RETURN_IF_ERROR(server_open(model));
+  LOG_INFO("Server ready: %u slots of %u bytes at 0x%08x",
+           (unsigned)queue->depth, (unsigned)queue->slot_size,
+           (unsigned)queue->staging_address);
+  uint32_t served = 0;
+  iree_status_t result = iree_ok_status();
+  while (iree_status_is_ok(result)) {
+    if (queue->tail == queue->head) {
+      if (queue->stop) {
+        break;
+      }
+      springbok_hostreq();
+      continue;
+    }
+    volatile ServerRequest *request =
+        &queue->ring[queue->tail % SERVER_QUEUE_DEPTH];
+    request->start_ccount = springbok_ccount();
+    iree_status_t request_result = iree_ok_status();
+    if (request->model_id != 0) {
+      request_result = iree_make_status(IREE_STATUS_NOT_FOUND,
+                                        "no model %u", request->model_id);
+    }
+    if (iree_status_is_ok(request_result)) {
+      server_load_request(model, request);
+      uint32_t cycles = 0;
+      request_result = invoke_and_map(model, invocation, &cycles);
+      request->inference_cycles = cycles;
+    }
+    if (iree_status_is_ok(request_result)) {
+      server_store_outputs(model, request);
+    }
+    request->status = iree_status_code(request_result);
+    IREE_IGNORE_ERROR(request_result);
+    request->end_ccount = springbok_ccount();
+    queue->tail++;
+    served++;
+    result = release_outputs(model, invocation);
+    springbok_hostreq();
+  }
+  LOG_INFO("Server stopped after %u requests", (unsigned)served);
+  if (invocation->cache) {
+    result_cache_report(invocation->cache);
+  }
+  server_close();
+  return result;
+}
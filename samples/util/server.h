@@ -0,0 +1,90 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLES_UTIL_SERVER_H_
+#define SAMPLES_UTIL_SERVER_H_
+
+// Inference server mode: instead of running the model once and finishing,
+// the firmware serves the requests a host posts to `springbok_server_queue`,
+// a ring of request descriptors in DTCM, until the host stops it.
+//
+// The host halts the core at SPRINGBOK_MARKER_INFERENCE and sets `enabled`.
+// The firmware then allocates `depth` staging slots of `slot_size` bytes,
+// room for the inputs of the model back to back followed by its outputs, and
+// halts for the host with springbok_hostreq (the HostReq IRQ of the control
+// block) every time it completes a request or runs out of them. The host
+// posts requests at `head`, resumes the core, and reads the completed ones
+// up to `tail`. Both indices only grow; the descriptor of request n is
+// ring[n % SERVER_QUEUE_DEPTH]. Setting `stop` ends the run once the ring is
+// drained.
+//
+// build_tools/inference_server_host.py is a host that drives it in Renode.
+
+#include <stdint.h>
+
+#include "samples/util/model_api.h"
+#include "samples/util/runtime.h"
+
+#define SERVER_QUEUE_DEPTH 4
+
+typedef struct {
+  // Written by the host.
+  uint32_t request_id;
+  uint32_t model_id;  // The firmware serves its one model, id 0.
+  uint32_t input_address;   // Inputs back to back, 0 for the ones in place.
+  uint32_t output_address;  // Outputs copied back to back, 0 for none.
+  // Written by the firmware on completion.
+  int32_t status;  // iree_status_code_t.
+  uint32_t start_ccount;
+  uint32_t end_ccount;
+  uint32_t inference_cycles;
+} ServerRequest;
+
+typedef struct {
+  uint32_t enabled;  // Host: serve requests instead of the one inference.
+  uint32_t stop;     // Host: return once the ring is drained.
+  uint32_t head;     // Host: requests posted.
+  uint32_t tail;     // Firmware: requests completed.
+  uint32_t depth;    // Firmware: SERVER_QUEUE_DEPTH.
+  uint32_t staging_address;  // Firmware: first staging slot.
+  uint32_t slot_size;        // Firmware: bytes per staging slot.
+  uint32_t input_size;       // Firmware: bytes of the inputs of a request.
+  uint32_t output_size;      // Firmware: bytes of the outputs of a request.
+  ServerRequest ring[SERVER_QUEUE_DEPTH];
+} ServerQueue;
+
+extern volatile ServerQueue springbok_server_queue;
+
+// Allocate the staging slots and publish them in the queue.
+iree_status_t server_open(const MlModel *model);
+
+// Copy the inputs of a request into the input storage of the model.
+void server_load_request(const MlModel *model,
+                         const volatile ServerRequest *request);
+
+// Copy the mapped outputs of the model where the request wants them.
+void server_store_outputs(const MlModel *model,
+                          const volatile ServerRequest *request);
+
+void server_close(void);
+
+// Serve the requests the host posts to springbok_server_queue through
+// `invocation` until it stops the server. Every request runs to completion,
+// with its failure reported in its descriptor, and the core halts for the
+// host after each one and whenever the ring is empty.
+iree_status_t run_server(const MlModel *model, Invocation *invocation);
+
+#endif  // SAMPLES_UTIL_SERVER_H_
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "samples/util/shapes.h"
+
+#include <springbok.h>
+#include <stdio.h>
+#include <string.h>
+
+// Check that a shape select_input_shapes set keeps the static dimensions of
+// the input and the dynamic ones within their upper bounds.
+static iree_status_t check_input_shape(const MlTensor *input,
+                                       const iree_hal_dim_t *shape) {
+  for (iree_host_size_t i = 0; i < input->rank; ++i) {
+    bool dynamic = input->dynamic_dims & (1u << i);
+    if (dynamic ? shape[i] > input->shape[i] : shape[i] != input->shape[i]) {
+      return iree_make_status(IREE_STATUS_OUT_OF_RANGE,
+                              "dimension %u of %u is out of its bounds",
+                              (unsigned)i, (unsigned)shape[i]);
+    }
+  }
+  return iree_ok_status();
+}
+
+// Format `shape` as 1x96x96x3 into `text`.
+static void format_shape(iree_host_size_t rank, const iree_hal_dim_t *shape,
+                         char *text, size_t size) {
+  size_t written = 0;
+  text[0] = '\0';
+  for (iree_host_size_t i = 0; i < rank && written < size; ++i) {
+    written += snprintf(text + written, size - written, i ? "x%u" : "%u",
+                        (unsigned)shape[i]);
+  }
+}
+
+iree_status_t run_shapes(const MlModel *model, iree_hal_device_t *device,
+                         Invocation *invocation) {
+  iree_host_size_t total_rank = 0;
+  for (iree_host_size_t i = 0; i < model->num_input; ++i) {
+    total_rank += model->inputs[i].rank;
+  }
+  // The dimensions of every input, then the shape pointer of each.
+  iree_hal_dim_t *dims = NULL;
+  IREE_RETURN_IF_ERROR(iree_allocator_malloc(
+      iree_allocator_system(),
+      total_rank * sizeof(*dims) + model->num_input * sizeof(dims),
+      (void **)&dims));
+  iree_hal_dim_t **shapes = (iree_hal_dim_t **)(dims + total_rank);
+  for (iree_host_size_t i = 0, offset = 0; i < model->num_input; ++i) {
+    shapes[i] = dims + offset;
+    offset += model->inputs[i].rank;
+  }
+
+  uint32_t count = 0;
+  uint64_t total_cycles = 0;
+  iree_status_t result = iree_ok_status();
+  while (iree_status_is_ok(result)) {
+    for (iree_host_size_t i = 0; i < model->num_input; ++i) {
+      memcpy(shapes[i], model->inputs[i].shape,
+             model->inputs[i].rank * sizeof(*dims));
+    }
+    if (!select_input_shapes(model, count, shapes)) {
+      break;
+    }
+    iree_host_size_t elements = 0;
+    for (iree_host_size_t i = 0;
+         i < model->num_input && iree_status_is_ok(result); ++i) {
+      const MlTensor *input = &model->inputs[i];
+      result = check_input_shape(input, shapes[i]);
+      iree_hal_buffer_view_t *buffer_view = NULL;
+      if (iree_status_is_ok(result)) {
+        result = prepare_input_hal_buffer_view(model, i, shapes[i], device,
+                                               &buffer_view);
+      }
+      if (iree_status_is_ok(result)) {
+        // The list holds the reference the buffer view was created with.
+        iree_vm_ref_t buffer_view_ref =
+            iree_hal_buffer_view_move_ref(buffer_view);
+        result = iree_vm_list_set_ref_move(invocation->inputs, i,
+                                           &buffer_view_ref);
+      }
+      if (iree_status_is_ok(result)) {
+        invocation->input_views[i] = buffer_view;
+        elements += shape_length(input->rank, shapes[i]);
+      }
+    }
+    uint32_t cycles = 0;
+    if (iree_status_is_ok(result)) {
+      uint32_t start_cycles = springbok_ccount();
+      result = invoke(invocation);
+      cycles = springbok_ccount() - start_cycles;
+    }
+    if (iree_status_is_ok(result)) {
+      result = map_outputs(model, invocation);
+    }
+    if (iree_status_is_ok(result)) {
+      result = write_output(model);
+    }
+    if (iree_status_is_ok(result)) {
+      char shape[48];
+      format_shape(model->inputs[0].rank, shapes[0], shape, sizeof(shape));
+      char per_element[NUMBER_TEXT_SIZE];
+      LOG_INFO("Inference shape %s: %u elements, %u cycles, %s "
+               "cycles/element",
+               shape, (unsigned)elements, (unsigned)cycles,
+               format_fixed(elements ? (uint64_t)cycles * 100 / elements : 0,
+                            2, per_element));
+      total_cycles += cycles;
+      count++;
+    }
+    // The next invocation appends its results to an empty list.
+    if (iree_status_is_ok(result)) {
+      result = release_outputs(model, invocation);
+    } else {
+      IREE_IGNORE_ERROR(release_outputs(model, invocation));
+    }
+  }
+  iree_allocator_free(iree_allocator_system(), dims);
+
+  if (iree_status_is_ok(result) && count > 0) {
+    LOG_INFO("Inference shapes: %u invocations, mean %u cycles",
+             (unsigned)count, (unsigned)(total_cycles / count));
+  }
+  return result;
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLES_UTIL_SHAPES_H_
+#define SAMPLES_UTIL_SHAPES_H_
+
+// Input shapes mode: a model with dynamic input dimensions whose sample
+// defines select_input_shapes (see model_api.h) runs once per set of shapes
+// it selects, with the input buffers sized from them, rather than once at the
+// upper bounds of the descriptor.
+
+#include "samples/util/model_api.h"
+#include "samples/util/runtime.h"
+
+// Run the model through `invocation` once per set of input shapes
+// select_input_shapes sets. Reports the shape of the first input and the
+// cycles of each invocation, per input element too, so their scaling with the
+// input size shows.
+iree_status_t run_shapes(const MlModel *model, iree_hal_device_t *device,
+                         Invocation *invocation);
+
+#endif  // SAMPLES_UTIL_SHAPES_H_
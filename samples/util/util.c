@@ -20,254 +20,179 @@
 
 #include <springbok.h>
 
-#include "iree/modules/hal/inline/module.h"
-#include "iree/modules/hal/loader/module.h"
-#include "samples/device/device.h"
-
-typedef struct {
-  uint32_t return_code;  // Populated in crt0.S
-  uint32_t epc;          // Populated in crt0.S
-  uint32_t length;
-} OutputHeader;
-
-OutputHeader output_header;
+#include "samples/util/dataset.h"
+#include "samples/util/pipeline.h"
+#include "samples/util/result_cache.h"
+#include "samples/util/runtime.h"
+#include "samples/util/server.h"
+#include "samples/util/shapes.h"
 
 extern const MlModel kModel;
 
-// Create context that will hold the module state across invocations.
-static iree_status_t create_context(iree_vm_instance_t *instance,
-                                    iree_hal_device_t **device,
-                                    iree_vm_context_t **context) {
-  iree_allocator_t host_allocator = iree_allocator_system();
-  iree_status_t result = iree_vm_instance_create(host_allocator, &instance);
-
-#if defined(BUILD_INLINE_HAL)
-  IREE_RETURN_IF_ERROR(iree_hal_module_register_inline_types(instance));
-#elif defined(BUILD_LOADER_HAL)
-  IREE_RETURN_IF_ERROR(iree_hal_module_register_loader_types(instance));
-#else
-  IREE_RETURN_IF_ERROR(iree_hal_module_register_all_types(instance));
-#endif
-
-  iree_hal_executable_loader_t *loader = NULL;
-  if (iree_status_is_ok(result)) {
-    result = create_sample_device(host_allocator, device, &loader);
-  }
-
-  // Load bytecode or C module.
-  iree_vm_module_t *module = NULL;
-  if (iree_status_is_ok(result)) {
-    result = create_module(instance, &module);
-  }
-
-#if defined(BUILD_INLINE_HAL) || defined(BUILD_LOADER_HAL)
-  // Create hal_inline_module
-  iree_vm_module_t *hal_inline_module = NULL;
-  if (iree_status_is_ok(result)) {
-    result = iree_hal_inline_module_create(
-        instance, IREE_HAL_INLINE_MODULE_FLAG_NONE,
-        iree_hal_device_allocator(*device), host_allocator, &hal_inline_module);
-  }
-#endif
-#if defined(BUILD_INLINE_HAL)
-  iree_vm_module_t *modules[] = {hal_inline_module, module};
-#elif defined(BUILD_LOADER_HAL)
-  // Create hal_loader_module
-  iree_vm_module_t *hal_loader_module = NULL;
-  if (iree_status_is_ok(result)) {
-    result = iree_hal_loader_module_create(instance, IREE_HAL_MODULE_FLAG_NONE,
-                                           /*loader_count=*/1, &loader,
-                                           host_allocator, &hal_loader_module);
+// Log the bytes moved since `start` by the memory traffic counters of the
+// simulator, by TCM, direction and access type, and the bytes per cycle over
+// `cycles`, unless the counters are off.
+static void print_memory_traffic(const uint64_t *start, uint32_t cycles) {
+  static const char *const kDirections[] = {"loads", "stores"};
+  uint64_t bytes[SPRINGBOK_MEM_COUNTERS];
+  springbok_mem_traffic(bytes);
+  uint64_t total = 0;
+  for (int i = 0; i < SPRINGBOK_MEM_COUNTERS; ++i) {
+    bytes[i] -= start[i];
+    total += bytes[i];
+  }
+  if (total == 0) {
+    return;
+  }
+  for (int direction = 0; direction < 2; ++direction) {
+    const uint64_t *itcm =
+        &bytes[SPRINGBOK_MEM_ITCM | (direction * SPRINGBOK_MEM_STORE)];
+    const uint64_t *dtcm =
+        &bytes[SPRINGBOK_MEM_DTCM | (direction * SPRINGBOK_MEM_STORE)];
+    char text[5][NUMBER_TEXT_SIZE];
+    LOG_INFO("Inference %s bytes: DTCM scalar %s, unit-stride %s, "
+             "strided %s, indexed %s, ITCM %s",
+             kDirections[direction],
+             format_u64(dtcm[SPRINGBOK_MEM_SCALAR], text[0]),
+             format_u64(dtcm[SPRINGBOK_MEM_UNIT_STRIDE], text[1]),
+             format_u64(dtcm[SPRINGBOK_MEM_STRIDED], text[2]),
+             format_u64(dtcm[SPRINGBOK_MEM_INDEXED], text[3]),
+             format_u64(itcm[SPRINGBOK_MEM_SCALAR] +
+                            itcm[SPRINGBOK_MEM_UNIT_STRIDE] +
+                            itcm[SPRINGBOK_MEM_STRIDED] +
+                            itcm[SPRINGBOK_MEM_INDEXED],
+                        text[4]));
+  }
+  if (cycles) {
+    char text[NUMBER_TEXT_SIZE];
+    LOG_INFO("Inference memory bandwidth: %s bytes/cycle",
+             format_fixed(total * 100 / cycles, 2, text));
   }
-  iree_vm_module_t *modules[] = {hal_inline_module, hal_loader_module, module};
-#else
-  // Create hal_module
-  iree_vm_module_t *hal_module = NULL;
-  if (iree_status_is_ok(result)) {
-    result =
-        iree_hal_module_create(instance, *device, IREE_HAL_MODULE_FLAG_NONE,
-                               host_allocator, &hal_module);
-  }
-  iree_vm_module_t *modules[] = {hal_module, module};
-#endif
-  iree_hal_executable_loader_release(loader);
-
-  // Allocate a context that will hold the module state across invocations.
-  if (iree_status_is_ok(result)) {
-    result = iree_vm_context_create_with_modules(
-        instance, IREE_VM_CONTEXT_FLAG_NONE, IREE_ARRAYSIZE(modules),
-        &modules[0], host_allocator, context);
-  }
-#if defined(BUILD_INLINE_HAL) || defined(BUILD_LOADER_HAL)
-  iree_vm_module_release(hal_inline_module);
-#else
-  iree_vm_module_release(hal_module);
-#endif
-#if defined(BUILD_LOADER_HAL)
-  iree_vm_module_release(hal_loader_module);
-#endif
-  iree_vm_module_release(module);
-  return result;
 }
 
-// Prepare the input buffers and buffer_views based on the data type. They must
-// be released by the caller.
-static iree_status_t prepare_input_hal_buffer_views(
-    const MlModel *model, iree_hal_device_t *device, void **arg_buffers,
-    iree_hal_buffer_view_t **arg_buffer_views) {
+// Time model->benchmark_invocations inferences through iree_vm_invoke and as
+// many through the direct call, to tell the cost of the list marshalling.
+static iree_status_t benchmark_invocations(const MlModel *model,
+                                           Invocation *invocation) {
+  MlDirectCallFn direct_call = invocation->direct_call;
+  uint32_t cycles[2] = {0, 0};
   iree_status_t result = iree_ok_status();
-
-  // Prepare the input buffer, and populate the initial value.
-  // The input buffer must be released by the caller.
-  iree_const_byte_span_t *byte_span[MAX_MODEL_INPUT_NUM] = {NULL};
-  result = load_input_data(model, arg_buffers, byte_span);
-
-  // Wrap buffers in shaped buffer views.
-  // The buffers can be mapped on the CPU and that can also be used
-  // on the device. Not all devices support this, but the ones we have now do.
-
-  iree_hal_buffer_params_t buffer_params = {
-      .type =
-          IREE_HAL_MEMORY_TYPE_HOST_LOCAL | IREE_HAL_MEMORY_TYPE_DEVICE_VISIBLE,
-      .access = IREE_HAL_MEMORY_ACCESS_READ,
-      .usage = IREE_HAL_BUFFER_USAGE_DEFAULT};
-  for (int i = 0; i < model->num_input; ++i) {
-    if (iree_status_is_ok(result)) {
-      result = iree_hal_buffer_view_allocate_buffer(
-          iree_hal_device_allocator(device), model->num_input_dim[i],
-          model->input_shape[i], model->hal_element_type,
-          IREE_HAL_ENCODING_TYPE_DENSE_ROW_MAJOR, buffer_params, *byte_span[i],
-          &(arg_buffer_views[i]));
-    }
-    if (byte_span[i] != NULL) {
-      free(byte_span[i]);
+  for (int direct = 0; direct < (direct_call ? 2 : 1); ++direct) {
+    invocation->direct_call = direct ? direct_call : NULL;
+    for (uint32_t i = 0;
+         i < model->benchmark_invocations && iree_status_is_ok(result); ++i) {
+      uint32_t start_cycles = springbok_ccount();
+      result = invoke(invocation);
+      cycles[direct] += springbok_ccount() - start_cycles;
+      if (iree_status_is_ok(result)) {
+        result = release_outputs(model, invocation);
+      }
     }
   }
+  invocation->direct_call = direct_call;
+  if (!iree_status_is_ok(result)) {
+    return result;
+  }
+  uint32_t invoke_cycles = cycles[0] / model->benchmark_invocations;
+  LOG_INFO("Invoke benchmark: iree_vm_invoke %u cycles per inference",
+           (unsigned)invoke_cycles);
+  if (direct_call) {
+    uint32_t direct_cycles = cycles[1] / model->benchmark_invocations;
+    LOG_INFO("Invoke benchmark: direct call %u cycles per inference",
+             (unsigned)direct_cycles);
+    LOG_INFO("Invoke benchmark: direct call saves %d cycles per inference",
+             (int)(invoke_cycles - direct_cycles));
+  }
   return result;
 }
 
 iree_status_t run(const MlModel *model) {
-  iree_vm_instance_t *instance = NULL;
-  iree_hal_device_t *device = NULL;
-  iree_vm_context_t *context = NULL;
+  Runtime runtime = {0};
+  Invocation invocation = {0};
   // create context
-  iree_status_t result = create_context(instance, &device, &context);
-
-  // Lookup the entry point function.
-  // Note that we use the synchronous variant which operates on pure type/shape
-  // erased buffers.
-  iree_vm_function_t main_function;
-  if (iree_status_is_ok(result)) {
-    result = (iree_vm_context_resolve_function(
-        context, iree_make_cstring_view(model->entry_func), &main_function));
-  }
-
-  // Prepare the input buffers.
-  void *arg_buffers[MAX_MODEL_INPUT_NUM] = {NULL};
-  iree_hal_buffer_view_t *arg_buffer_views[MAX_MODEL_INPUT_NUM] = {NULL};
+  iree_status_t result = runtime_create(&runtime);
   if (iree_status_is_ok(result)) {
-    result = prepare_input_hal_buffer_views(model, device, arg_buffers,
-                                            arg_buffer_views);
-  }
-
-  // Setup call inputs with our buffers.
-  iree_vm_list_t *inputs = NULL;
-  if (iree_status_is_ok(result)) {
-    result = iree_vm_list_create(
-        /*element_type=*/NULL, /*capacity=*/model->num_input,
-        iree_allocator_system(), &inputs);
-  }
-  iree_vm_ref_t arg_buffer_view_ref;
-  for (int i = 0; i < model->num_input; ++i) {
-    arg_buffer_view_ref = iree_hal_buffer_view_move_ref(arg_buffer_views[i]);
-    if (iree_status_is_ok(result)) {
-      result = iree_vm_list_push_ref_move(inputs, &arg_buffer_view_ref);
-    }
+    result = create_invocation(&runtime, model, create_module, /*load=*/true,
+                               &invocation);
   }
 
-  // Prepare outputs list to accept the results from the invocation.
-  // The output vm list is allocated statically.
-  iree_vm_list_t *outputs = NULL;
   if (iree_status_is_ok(result)) {
-    result = iree_vm_list_create(
-        /*element_type=*/NULL,
-        /*capacity=*/1, iree_allocator_system(), &outputs);
+    runtime_start_inference();
   }
 
-  // Invoke the function.
+  // Host files are not part of a snapshot, so the dataset is opened after the
+  // marker.
+  Dataset dataset = {.inputs_fd = -1, .labels_fd = -1};
   if (iree_status_is_ok(result)) {
-    result = iree_vm_invoke(context, main_function, IREE_VM_CONTEXT_FLAG_NONE,
-                            /*policy=*/NULL, inputs, outputs,
-                            iree_allocator_system());
-  }
-
-  // Validate output and gather buffers.
-  iree_hal_buffer_mapping_t mapped_memories[MAX_MODEL_OUTPUTS] = {{0}};
-  for (int index_output = 0; index_output < model->num_output; index_output++) {
-    iree_hal_buffer_view_t *ret_buffer_view = NULL;
-    if (iree_status_is_ok(result)) {
-      // Get the result buffers from the invocation.
-      ret_buffer_view = (iree_hal_buffer_view_t *)iree_vm_list_get_ref_deref(
-          outputs, index_output, iree_hal_buffer_view_get_descriptor());
-      if (ret_buffer_view == NULL) {
-        result = iree_make_status(IREE_STATUS_NOT_FOUND,
-                                  "can't find return buffer view");
-      }
-    }
+    result = dataset_open(model, &dataset);
+  }
+
+  if (iree_status_is_ok(result) && model->benchmark_invocations > 0) {
+    result = benchmark_invocations(model, &invocation);
+  }
+
+  // Only the dataset and server runs see the same inputs more than once.
+  ResultCache cache;
+  bool serve = springbok_server_queue.enabled;
+  if (iree_status_is_ok(result) && model->result_cache != RESULT_CACHE_NONE &&
+      (serve || dataset.inputs_fd >= 0)) {
+    invocation.cache = &cache;
+    result = result_cache_create(model, model->result_cache, &cache);
+  }
+
+  if (iree_status_is_ok(result) && serve) {
+    result = run_server(model, &invocation);
+  } else if (iree_status_is_ok(result) && dataset.inputs_fd >= 0) {
+    result = run_dataset(model, &dataset, &invocation);
+  } else if (iree_status_is_ok(result) && select_input_shapes) {
+    result = run_shapes(model, runtime.device, &invocation);
+  } else if (iree_status_is_ok(result)) {
+    // Invoke the function.
+    uint64_t start_traffic[SPRINGBOK_MEM_COUNTERS];
+    springbok_mem_traffic(start_traffic);
+    uint64_t start_energy = springbok_energy();
+    uint32_t start_cycles = springbok_ccount();
+    uint32_t start_instructions = springbok_icount();
+    result = invoke(&invocation);
+    uint32_t cycles = springbok_ccount() - start_cycles;
+    LOG_INFO("Inference cycles: %u", (unsigned)cycles);
+    LOG_INFO("Inference instructions: %u",
+             (unsigned)(springbok_icount() - start_instructions));
+    print_energy("Inference energy", springbok_energy() - start_energy);
+    print_memory_traffic(start_traffic, cycles);
+
+    // Validate output and gather buffers.
     if (iree_status_is_ok(result)) {
-      result = iree_hal_buffer_map_range(
-          iree_hal_buffer_view_buffer(ret_buffer_view),
-          IREE_HAL_MAPPING_MODE_SCOPED, IREE_HAL_MEMORY_ACCESS_READ, 0,
-          IREE_WHOLE_BUFFER, &mapped_memories[index_output]);
+      result = map_outputs(model, &invocation);
     }
 
+    // Post-process memory into model output.
     if (iree_status_is_ok(result)) {
-      if (index_output > model->num_output ||
-          mapped_memories[index_output].contents.data_length /
-                  model->output_size_bytes !=
-              model->output_length[index_output]) {
-        result =
-            iree_make_status(IREE_STATUS_UNKNOWN, "output length mismatches");
-      }
+      result = write_output(model);
     }
+    IREE_IGNORE_ERROR(release_outputs(model, &invocation));
   }
 
-  // Post-process memory into model output.
-  if (iree_status_is_ok(result)) {
-    uint32_t length = 0;
-    result = process_output(model, mapped_memories, &length);
-    output_header.length = length;
-  }
-
-  for (int index_output = 0; index_output < model->num_output; index_output++) {
-    if (mapped_memories[index_output].contents.data != NULL) {
-      iree_hal_buffer_unmap_range(&mapped_memories[index_output]);
-    }
-  }
-  iree_vm_list_release(inputs);
-  iree_vm_list_release(outputs);
-  for (int i = 0; i < model->num_input; ++i) {
-    if (arg_buffers[i] != NULL) {
-      free(arg_buffers[i]);
-    }
+  if (invocation.cache) {
+    result_cache_destroy(invocation.cache);
   }
-  iree_vm_context_release(context);
-  IREE_IGNORE_ERROR(iree_hal_allocator_statistics_fprint(
-      stdout, iree_hal_device_allocator(device)));
-  iree_hal_device_release(device);
-  iree_vm_instance_release(instance);
+  dataset_close(&dataset);
+  release_invocation(&invocation);
+  runtime_release(&runtime);
   return result;
 }
 
 int main() {
-  const MlModel *model_ptr = &kModel;
-  const iree_status_t result = run(model_ptr);
+  const MlPipeline *pipeline = ml_pipeline ? ml_pipeline() : NULL;
+  const iree_status_t result =
+      pipeline ? run_pipeline(pipeline) : run(&kModel);
   int ret = (int)iree_status_code(result);
   if (!iree_status_is_ok(result)) {
     iree_status_fprint(stderr, result);
     iree_status_free(result);
   } else {
-    LOG_INFO("%s finished successfully", model_ptr->model_name);
+    LOG_INFO("%s finished successfully",
+             pipeline ? pipeline->name : kModel.model_name);
   }
 
   return ret;
@@ -19,7 +19,6 @@
 
 // A top-level header collection for ML executable utility library.
 
-#include "samples/util/alloc.h"
 #include "samples/util/model_api.h"
 
 #endif  // SAMPLES_UTIL_UTIL_H_
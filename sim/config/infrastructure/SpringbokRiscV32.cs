@@ -13,9 +13,12 @@
 // limitations under the License.
 
 using System;
+using System.Collections.Generic;
+using System.IO;
 using System.Linq;
 using System.Text;
 
+using Antmicro.Migrant;
 using Antmicro.Renode.Core;
 using Antmicro.Renode.Core.Structure.Registers;
 using Antmicro.Renode.Logging;
@@ -65,6 +68,11 @@ namespace Antmicro.Renode.Peripherals.CPU
             {
                 ControlBlock.Reset();
             }
+
+            CloseHostFiles();
+            ResetInstructionStatistics();
+            stallCycles = 0;
+            dmaDoneCycle = 0;
         }
 
         public void RegisterControlBlock(SpringbokRiscV32_ControlBlock controlBlock)
@@ -76,6 +84,343 @@ namespace Antmicro.Renode.Peripherals.CPU
         private SpringbokRiscV32_ControlBlock ControlBlock;
         private bool ControlBlockRegistered = false;
 
+        // Marker id the core halts at, as on a hostreq. 0 never halts.
+        public uint StopAtMarker { get; set; }
+
+        // Host directory the hostfile instruction reads files from. Unset,
+        // every hostfile operation fails.
+        public string HostFileRoot { get; set; }
+
+        // Cost of the copy engine of the dma instruction, which stands in for
+        // an engine in front of a memory slower than the TCMs. A copy lands
+        // in memory at once, but completes DmaSetupCycles plus a cycle per
+        // DmaBytesPerCycle bytes after the previous one, and a wait stalls
+        // the core until the last copy completes. A read takes the engine as
+        // long as a copy, for data the core loads from the slow memory
+        // itself, since direct loads are not slowed down. Stalls count as
+        // cycles, on top of the one per instruction.
+        public uint DmaSetupCycles { get; set; } = 64;
+        public uint DmaBytesPerCycle { get; set; } = 4;
+
+        // Samples VL and VTYPE after every vector instruction, to report how
+        // much of VLMAX the executed vector code actually uses. Off by default
+        // since the hooks slow down the simulation.
+        public void EnableVectorLengthStatistics()
+        {
+            if(vectorStatisticsEnabled)
+            {
+                return;
+            }
+            EnablePostOpcodeExecutionHooks(1);
+            AddPostOpcodeExecutionHook(0x7F, (ulong)MajorOpcode.OpV, CountVectorInstruction);
+            AddPostOpcodeExecutionHook(0x7F, (ulong)MajorOpcode.LoadFp, CountVectorInstruction);
+            AddPostOpcodeExecutionHook(0x7F, (ulong)MajorOpcode.StoreFp, CountVectorInstruction);
+            vectorStatisticsEnabled = true;
+        }
+
+        public string VectorLengthStatistics()
+        {
+            return String.Format("vector length statistics: instructions {0}, vl sum {1}, vlmax sum {2}, vsetvl {3}",
+                                 vectorInstructions, vectorLengthSum, vectorLengthMaxSum, vectorConfigurations);
+        }
+
+        // Energy model costs, in picojoules. Every instruction is fetched
+        // from ITCM, and all data accesses are charged as DTCM accesses.
+        public double ScalarOpEnergy { get; set; } = 4.0;
+        public double VectorElementOpEnergySew8 { get; set; } = 0.4;
+        public double VectorElementOpEnergySew16 { get; set; } = 0.7;
+        public double VectorElementOpEnergySew32 { get; set; } = 1.3;
+        public double ItcmFetchEnergyPerByte { get; set; } = 0.6;
+        public double DtcmLoadEnergyPerByte { get; set; } = 0.8;
+        public double DtcmStoreEnergyPerByte { get; set; } = 1.0;
+
+        // Accumulates the energy of the executed instructions from the costs
+        // above, read through the Energy CSRs. Off by default, like the
+        // vector length statistics its hooks extend.
+        public void EnableEnergyModel()
+        {
+            EnableMemoryAccessHooks();
+            energyModelEnabled = true;
+        }
+
+        // Counts the bytes loaded and stored, by ITCM or DTCM and by scalar,
+        // unit-stride, strided or indexed vector access, read through the
+        // MemoryTraffic CSRs. Off by default, like the energy model.
+        public void EnableMemoryTrafficCounters()
+        {
+            EnableMemoryAccessHooks();
+            memoryTrafficEnabled = true;
+        }
+
+        public string MemoryTrafficStatistics()
+        {
+            var counters = new List<string>();
+            for(int i = 0; i < memoryTraffic.Length; i++)
+            {
+                counters.Add(String.Format("{0}_{1}_{2}={3}", (i & MemoryTrafficDtcm) != 0 ? "dtcm" : "itcm",
+                                           (i & MemoryTrafficStore) != 0 ? "store" : "load",
+                                           MemoryAccessKindNames[i & 0x3], memoryTraffic[i]));
+            }
+            return "memory traffic statistics: " + String.Join(" ", counters);
+        }
+
+        public string EnergyStatistics()
+        {
+            ulong scalarOps = ScalarOps();
+            ulong fetchBytes = ExecutedInstructions * 4;
+            double vectorEnergy = VectorEnergy();
+            return String.Format(System.Globalization.CultureInfo.InvariantCulture,
+                                 "energy statistics: scalar_ops={0} scalar_pj={1:F1} vector_element_ops_sew8={2} "
+                                 + "vector_element_ops_sew16={3} vector_element_ops_sew32={4} vector_pj={5:F1} "
+                                 + "fetch_bytes={6} fetch_pj={7:F1} load_bytes={8} load_pj={9:F1} "
+                                 + "store_bytes={10} store_pj={11:F1} total_pj={12:F1}",
+                                 scalarOps, scalarOps * ScalarOpEnergy,
+                                 vectorElementOps[0], vectorElementOps[1], vectorElementOps[2], vectorEnergy,
+                                 fetchBytes, fetchBytes * ItcmFetchEnergyPerByte,
+                                 loadBytes, loadBytes * DtcmLoadEnergyPerByte,
+                                 storeBytes, storeBytes * DtcmStoreEnergyPerByte, Energy());
+        }
+
+        // Energy since reset in picojoules, 0 without the energy model.
+        private double Energy()
+        {
+            if(!energyModelEnabled)
+            {
+                return 0;
+            }
+            return ScalarOps() * ScalarOpEnergy
+                + VectorEnergy()
+                + ExecutedInstructions * 4 * ItcmFetchEnergyPerByte
+                + loadBytes * DtcmLoadEnergyPerByte
+                + storeBytes * DtcmStoreEnergyPerByte;
+        }
+
+        // vsetvl counts as a scalar op, the other vector instructions by their
+        // element ops or bytes.
+        private ulong ScalarOps()
+        {
+            return (ExecutedInstructions > vectorInstructions) ? ExecutedInstructions - vectorInstructions : 0;
+        }
+
+        private double VectorEnergy()
+        {
+            return vectorElementOps[0] * VectorElementOpEnergySew8
+                + vectorElementOps[1] * VectorElementOpEnergySew16
+                + vectorElementOps[2] * VectorElementOpEnergySew32;
+        }
+
+        private void CountVectorInstruction(ulong pc)
+        {
+            uint opcode = ReadDoubleWordFromBus(pc);
+            uint majorOpcode = opcode & 0x7F;
+            uint funct3 = (opcode >> 12) & 0x7;
+            if(majorOpcode == (uint)MajorOpcode.OpV)
+            {
+                if(funct3 == 0x7)
+                {
+                    // vsetvl, vsetvli, vsetivli
+                    vectorConfigurations++;
+                    return;
+                }
+            }
+            else if(funct3 == 0x1 || funct3 == 0x2 || funct3 == 0x3 || funct3 == 0x4)
+            {
+                // Scalar flh, flw, fld, flq and their stores, which leave the
+                // integer base register alone.
+                bool store = majorOpcode == (uint)MajorOpcode.StoreFp;
+                CountDataAccess(store, MemoryAccessKind.Scalar, ScalarAccessAddress(opcode, store), 1UL << (int)funct3);
+                return;
+            }
+
+            ulong vtype = GetRegisterUnsafe((int)RiscV32Registers.VTYPE).RawValue;
+            if((vtype & (1UL << 31)) != 0)
+            {
+                // vill
+                return;
+            }
+            int vsew = (int)((vtype >> 3) & 0x7);
+            ulong sew = 8UL << vsew;
+            int vlmul = (int)(vtype & 0x7);
+            ulong vlmax = (vlmul < 4)
+                ? ((ulong)VectorRegisterLength << vlmul) / sew
+                : ((ulong)VectorRegisterLength >> (8 - vlmul)) / sew;
+            ulong vl = GetRegisterUnsafe((int)RiscV32Registers.VL).RawValue;
+            vectorInstructions++;
+            vectorLengthSum += vl;
+            vectorLengthMaxSum += vlmax;
+
+            if(majorOpcode == (uint)MajorOpcode.OpV)
+            {
+                if(vsew < vectorElementOps.Length)
+                {
+                    vectorElementOps[vsew] += vl;
+                }
+            }
+            else
+            {
+                CountVectorMemoryAccess(opcode, vl, sew / 8);
+            }
+        }
+
+        private void CountVectorMemoryAccess(uint opcode, ulong vl, ulong sewBytes)
+        {
+            uint funct3 = (opcode >> 12) & 0x7;
+            uint mop = (opcode >> 26) & 0x3;
+            uint umop = (opcode >> 20) & 0x1F;
+            ulong fields = ((opcode >> 29) & 0x7) + 1;
+            // The width field is the EEW of the data of unit-stride and
+            // strided accesses, and of the indices of indexed ones, whose
+            // data has SEW: 0 is 8 bits, 5 to 7 are 16 to 64 bits.
+            ulong eewBytes = (funct3 == 0) ? 1UL : 1UL << (int)(funct3 - 4);
+            MemoryAccessKind kind;
+            ulong bytes;
+            switch(mop)
+            {
+                case 0:
+                    kind = MemoryAccessKind.UnitStride;
+                    if(umop == 0x08)
+                    {
+                        // Whole registers, whatever VL.
+                        bytes = fields * (ulong)VectorRegisterLength / 8;
+                    }
+                    else if(umop == 0x0B)
+                    {
+                        // Mask, one bit per element.
+                        bytes = (vl + 7) / 8;
+                    }
+                    else
+                    {
+                        bytes = vl * eewBytes * fields;
+                    }
+                    break;
+                case 2:
+                    kind = MemoryAccessKind.Strided;
+                    bytes = vl * eewBytes * fields;
+                    break;
+                default:
+                    kind = MemoryAccessKind.Indexed;
+                    bytes = vl * sewBytes * fields;
+                    break;
+            }
+            // Strided and indexed accesses are attributed after their base.
+            uint rs1 = (opcode >> 15) & 0x1F;
+            CountDataAccess((opcode & 0x7F) == (uint)MajorOpcode.StoreFp, kind, X[rs1].RawValue, bytes);
+        }
+
+        private void CountScalarMemoryAccess(ulong pc)
+        {
+            uint opcode = ReadDoubleWordFromBus(pc);
+            bool store = (opcode & 0x7F) == (uint)MajorOpcode.Store;
+            // funct3 holds log2 of the access size, and the signedness of
+            // loads in its top bit.
+            ulong bytes = 1UL << (int)((opcode >> 12) & 0x3);
+            uint rd = (opcode >> 7) & 0x1F;
+            uint rs1 = (opcode >> 15) & 0x1F;
+            // A load into its own base register leaves no trace of its
+            // address; it is attributed to DTCM, which holds all the data
+            // sections.
+            ulong? address = (!store && rd == rs1 && rd != 0) ? (ulong?)null : ScalarAccessAddress(opcode, store);
+            CountDataAccess(store, MemoryAccessKind.Scalar, address, bytes);
+        }
+
+        private ulong ScalarAccessAddress(uint opcode, bool store)
+        {
+            uint rs1 = (opcode >> 15) & 0x1F;
+            int offset = store
+                ? ((int)(opcode & 0xFE000000) >> 20) | (int)((opcode >> 7) & 0x1F)
+                : (int)opcode >> 20;
+            return (ulong)(uint)((int)X[rs1].RawValue + offset);
+        }
+
+        private void ResetInstructionStatistics()
+        {
+            vectorInstructions = 0;
+            vectorLengthSum = 0;
+            vectorLengthMaxSum = 0;
+            vectorConfigurations = 0;
+            Array.Clear(vectorElementOps, 0, vectorElementOps.Length);
+            loadBytes = 0;
+            storeBytes = 0;
+            Array.Clear(memoryTraffic, 0, memoryTraffic.Length);
+        }
+
+        private void EnableMemoryAccessHooks()
+        {
+            if(memoryAccessHooksEnabled)
+            {
+                return;
+            }
+            EnableVectorLengthStatistics();
+            AddPostOpcodeExecutionHook(0x7F, (ulong)MajorOpcode.Load, CountScalarMemoryAccess);
+            AddPostOpcodeExecutionHook(0x7F, (ulong)MajorOpcode.Store, CountScalarMemoryAccess);
+            memoryAccessHooksEnabled = true;
+        }
+
+        // A null address is attributed to DTCM. Accesses outside of the
+        // TCMs, to peripherals, are not memory traffic.
+        private void CountDataAccess(bool store, MemoryAccessKind kind, ulong? address, ulong bytes)
+        {
+            if(energyModelEnabled)
+            {
+                if(store)
+                {
+                    storeBytes += bytes;
+                }
+                else
+                {
+                    loadBytes += bytes;
+                }
+            }
+            if(memoryTrafficEnabled)
+            {
+                int region = MemoryTrafficDtcm;
+                if(address.HasValue && ControlBlockRegistered)
+                {
+                    if(!tcmRangesResolved)
+                    {
+                        itcmRange = ControlBlock.InstructionMemoryRange;
+                        dtcmRange = ControlBlock.DataMemoryRange;
+                        tcmRangesResolved = true;
+                    }
+                    if(itcmRange.Contains(address.Value))
+                    {
+                        region = 0;
+                    }
+                    else if(!dtcmRange.Contains(address.Value))
+                    {
+                        return;
+                    }
+                }
+                memoryTraffic[region | (store ? MemoryTrafficStore : 0) | (int)kind] += bytes;
+            }
+        }
+
+        private bool vectorStatisticsEnabled = false;
+        private ulong vectorInstructions;
+        private ulong vectorLengthSum;
+        private ulong vectorLengthMaxSum;
+        private ulong vectorConfigurations;
+
+        private bool memoryAccessHooksEnabled = false;
+        private bool energyModelEnabled = false;
+        // Element ops of vector arithmetic by SEW 8, 16 and 32.
+        private readonly ulong[] vectorElementOps = new ulong[3];
+        private ulong loadBytes;
+        private ulong storeBytes;
+
+        private bool memoryTrafficEnabled = false;
+        // Bytes indexed by region (ITCM 0, DTCM MemoryTrafficDtcm), direction
+        // (load 0, store MemoryTrafficStore) and MemoryAccessKind, like the
+        // MemoryTraffic CSRs.
+        private readonly ulong[] memoryTraffic = new ulong[16];
+        private const int MemoryTrafficStore = 0x4;
+        private const int MemoryTrafficDtcm = 0x8;
+        private static readonly string[] MemoryAccessKindNames = { "scalar", "unit_stride", "strided", "indexed" };
+        // Looked up on the first access, once the memories are registered.
+        private bool tcmRangesResolved = false;
+        private Range itcmRange;
+        private Range dtcmRange;
+
         private void HandleSpringbokCustom3(UInt64 opcode)
         {
             int rd = (int)BitHelper.GetValue(opcode, 7, 5);
@@ -144,8 +489,9 @@ namespace Antmicro.Renode.Peripherals.CPU
                             break;
                         case 1:
                             // ccount
-                            // Renode simulates one cycle per instruction
-                            X[rd] = ExecutedInstructions;
+                            // Renode simulates one cycle per instruction,
+                            // plus the dma stalls
+                            X[rd] = Cycles();
                             break;
                         default:
                             this.Log(LogLevel.Error, "xcount: unrecognized source: {0} (0x{0:X})", rs1);
@@ -166,6 +512,31 @@ namespace Antmicro.Renode.Peripherals.CPU
                         ControlBlock.ExecFinish();
                     }
                     break;
+                case 4:
+                    // marker
+                    // rs1 is the marker id
+                    uint marker = (uint)(X[rs1].RawValue);
+                    if(marker != 0 && marker == StopAtMarker)
+                    {
+                        this.Log(LogLevel.Info, "marker {0}: halted for the host", marker);
+                        if(ControlBlockRegistered)
+                        {
+                            ControlBlock.ExecHostReq();
+                        }
+                    }
+                    break;
+                case 5:
+                    // hostfile
+                    // rd is the operation, and receives its result
+                    // rs1 is pointer to the argument words of the operation
+                    X[rd] = (ulong)(uint)HostFileOperation((uint)X[rd].RawValue, (uint)X[rs1].RawValue);
+                    break;
+                case 6:
+                    // dma
+                    // rd is the operation, and receives its result
+                    // rs1 is pointer to the argument words of the operation
+                    X[rd] = (ulong)(uint)DmaOperation((uint)X[rd].RawValue, (uint)X[rs1].RawValue);
+                    break;
                 default:
                     // Unrecognized
                     this.Log(LogLevel.Error, "custom-3: unrecognized funct3: {0} (0x{0:X})", funct3);
@@ -173,20 +544,195 @@ namespace Antmicro.Renode.Peripherals.CPU
             }
         }
 
+        private int DmaOperation(uint operation, uint argsPtr)
+        {
+            Func<int, uint> arg = i => ReadDoubleWordFromBus(argsPtr + (uint)(4 * i));
+            switch((DmaOperations)operation)
+            {
+                case DmaOperations.Copy:
+                    uint length = arg(2);
+                    try
+                    {
+                        machine.SystemBus.WriteBytes(machine.SystemBus.ReadBytes(arg(1), (int)length), arg(0));
+                    }
+                    catch(Exception e)
+                    {
+                        this.Log(LogLevel.Warning, "dma: copy of {0} bytes failed: {1}", length, e.Message);
+                        return -1;
+                    }
+                    QueueDmaTransfer(length);
+                    return 0;
+                case DmaOperations.Read:
+                    QueueDmaTransfer(arg(1));
+                    return 0;
+                case DmaOperations.Wait:
+                    ulong now = Cycles();
+                    ulong stall = dmaDoneCycle > now ? dmaDoneCycle - now : 0;
+                    stallCycles += stall;
+                    return (int)Math.Min(stall, (ulong)int.MaxValue);
+                default:
+                    this.Log(LogLevel.Error, "dma: unrecognized operation: {0}", operation);
+                    return -1;
+            }
+        }
+
+        private void QueueDmaTransfer(uint length)
+        {
+            ulong start = Math.Max(Cycles(), dmaDoneCycle);
+            ulong bytesPerCycle = Math.Max(DmaBytesPerCycle, 1u);
+            dmaDoneCycle = start + DmaSetupCycles + (length + bytesPerCycle - 1) / bytesPerCycle;
+        }
+
+        // Cycles since reset: one per instruction, and the dma stalls.
+        private ulong Cycles()
+        {
+            return ExecutedInstructions + stallCycles;
+        }
+
+        private ulong stallCycles;
+        // Cycle the last copy of the dma instruction completes at.
+        private ulong dmaDoneCycle;
+
+        private int HostFileOperation(uint operation, uint argsPtr)
+        {
+            Func<int, uint> arg = i => ReadDoubleWordFromBus(argsPtr + (uint)(4 * i));
+            try
+            {
+                switch((HostFileOperations)operation)
+                {
+                    case HostFileOperations.Open:
+                        return OpenHostFile(ReadString(arg(0)));
+                    case HostFileOperations.Read:
+                        return ReadHostFile(HostFile(arg(0)), arg(1), (int)arg(2));
+                    case HostFileOperations.Seek:
+                        return checked((int)HostFile(arg(0)).Seek((int)arg(1), (SeekOrigin)arg(2)));
+                    case HostFileOperations.Close:
+                        HostFile(arg(0)).Dispose();
+                        HostFiles.Remove((int)arg(0));
+                        return 0;
+                    default:
+                        this.Log(LogLevel.Error, "hostfile: unrecognized operation: {0}", operation);
+                        return -1;
+                }
+            }
+            catch(Exception e) when(e is IOException || e is ArgumentException || e is KeyNotFoundException ||
+                                    e is UnauthorizedAccessException || e is OverflowException)
+            {
+                this.Log(LogLevel.Warning, "hostfile: operation {0} failed: {1}", operation, e.Message);
+                return -1;
+            }
+        }
+
+        private int OpenHostFile(string path)
+        {
+            if(String.IsNullOrEmpty(HostFileRoot))
+            {
+                this.Log(LogLevel.Debug, "hostfile: no HostFileRoot to open {0} from", path);
+                return -1;
+            }
+            // Only files under the root are served.
+            string root = Path.GetFullPath(HostFileRoot).TrimEnd(Path.DirectorySeparatorChar) + Path.DirectorySeparatorChar;
+            string fullPath = Path.GetFullPath(Path.Combine(root, path));
+            if(!fullPath.StartsWith(root, StringComparison.Ordinal))
+            {
+                this.Log(LogLevel.Warning, "hostfile: {0} is outside of {1}", path, root);
+                return -1;
+            }
+            int handle = 0;
+            while(HostFiles.ContainsKey(handle))
+            {
+                handle++;
+            }
+            HostFiles[handle] = new FileStream(fullPath, FileMode.Open, FileAccess.Read);
+            this.Log(LogLevel.Debug, "hostfile: opened {0} as {1}", fullPath, handle);
+            return handle;
+        }
+
+        private int ReadHostFile(FileStream file, uint address, int length)
+        {
+            byte[] buffer = new byte[Math.Min(length, HostFileChunkSize)];
+            int total = 0;
+            while(total < length)
+            {
+                int read = file.Read(buffer, 0, Math.Min(length - total, buffer.Length));
+                if(read == 0)
+                {
+                    break;
+                }
+                if(read < buffer.Length)
+                {
+                    Array.Resize(ref buffer, read);
+                }
+                machine.SystemBus.WriteBytes(buffer, address + (uint)total);
+                total += read;
+            }
+            return total;
+        }
+
+        private FileStream HostFile(uint handle)
+        {
+            return HostFiles[(int)handle];
+        }
+
+        private string ReadString(uint address)
+        {
+            var bytes = new List<byte>();
+            for(byte b = ReadByteFromBus(address); b != 0; b = ReadByteFromBus(++address))
+            {
+                bytes.Add(b);
+            }
+            return Encoding.UTF8.GetString(bytes.ToArray());
+        }
+
+        private void CloseHostFiles()
+        {
+            foreach(var file in HostFiles.Values)
+            {
+                file.Dispose();
+            }
+            HostFiles.Clear();
+        }
+
+        // Bounds the host memory a single hostfile read takes.
+        private const int HostFileChunkSize = 1 << 20;
+        // Open host files are not part of a snapshot, a restored core starts
+        // with none.
+        [Transient]
+        private Dictionary<int, FileStream> hostFilesByHandle;
+
+        private Dictionary<int, FileStream> HostFiles
+        {
+            get
+            {
+                if(hostFilesByHandle == null)
+                {
+                    hostFilesByHandle = new Dictionary<int, FileStream>();
+                }
+                return hostFilesByHandle;
+            }
+        }
+
         private void RegisterCustomCSRs()
         {
             // validate only privilege level when accessing CSRs
             // do not validate rw bit as VexRiscv custom CSRs do not follow the standard
             CSRValidation = CSRValidationLevel.None;
 
-            RegisterCSR((ulong)CSRs.InstructionCount, () => InstructionCountCSRRead("InstructionCount"), value => { });
-            RegisterCSR((ulong)CSRs.CycleCount, () => InstructionCountCSRRead("CycleCount"), value => { });
+            RegisterCSR((ulong)CSRs.InstructionCount, () => InstructionCountCSRRead("InstructionCount", ExecutedInstructions), value => { });
+            RegisterCSR((ulong)CSRs.CycleCount, () => InstructionCountCSRRead("CycleCount", Cycles()), value => { });
+            RegisterCSR((ulong)CSRs.Energy, () => (ulong)Energy() & 0xFFFFFFFF, value => { });
+            RegisterCSR((ulong)CSRs.EnergyHigh, () => (ulong)Energy() >> 32, value => { });
+            for(int i = 0; i < memoryTraffic.Length; i++)
+            {
+                int counter = i;
+                RegisterCSR((ulong)CSRs.MemoryTraffic + (ulong)i, () => memoryTraffic[counter] & 0xFFFFFFFF, value => { });
+                RegisterCSR((ulong)CSRs.MemoryTrafficHigh + (ulong)i, () => memoryTraffic[counter] >> 32, value => { });
+            }
         }
 
-        private ulong InstructionCountCSRRead(string name)
+        private ulong InstructionCountCSRRead(string name, ulong count)
         {
-            this.Log(LogLevel.Noisy, "Reading instruction count CSR {0} 0x{1:X}", name, ExecutedInstructions);
-            ulong count = ExecutedInstructions;
+            this.Log(LogLevel.Noisy, "Reading instruction count CSR {0} 0x{1:X}", name, count);
             return count;
         }
 
@@ -194,6 +740,49 @@ namespace Antmicro.Renode.Peripherals.CPU
         {
             InstructionCount = 0x7C0,
             CycleCount = 0x7C1,
+            // Energy model estimate in picojoules, low and high words.
+            Energy = 0x7C2,
+            EnergyHigh = 0x7C3,
+            // Bytes loaded and stored, 16 counters from 0x7C8 laid out like
+            // the memoryTraffic array, and their high words from 0x7D8.
+            MemoryTraffic = 0x7C8,
+            MemoryTrafficHigh = 0x7D8,
+        }
+
+        private enum MemoryAccessKind
+        {
+            Scalar = 0,
+            UnitStride = 1,
+            Strided = 2,
+            Indexed = 3,
+        }
+
+        // Operations of the hostfile instruction, SPRINGBOK_HOSTFILE_* in
+        // springbok_intrinsics.h.
+        private enum HostFileOperations
+        {
+            Open = 1,
+            Read = 2,
+            Seek = 3,
+            Close = 4,
+        }
+
+        // Operations of the dma instruction, SPRINGBOK_DMA_* in
+        // springbok_intrinsics.h.
+        private enum DmaOperations
+        {
+            Copy = 1,
+            Wait = 2,
+            Read = 3,
+        }
+
+        private enum MajorOpcode
+        {
+            Load = 0x03,
+            LoadFp = 0x07,
+            Store = 0x23,
+            StoreFp = 0x27,
+            OpV = 0x57,
         }
     }
 
@@ -479,6 +1068,16 @@ namespace Antmicro.Renode.Peripherals.CPU
 
         private Mode mode;
         private readonly Machine Machine;
+        public Range InstructionMemoryRange
+        {
+            get { return Machine.SystemBus.GetRegistrationPoints(IMem, Core).First().Range; }
+        }
+
+        public Range DataMemoryRange
+        {
+            get { return Machine.SystemBus.GetRegistrationPoints(DMem, Core).First().Range; }
+        }
+
         private readonly SpringbokRiscV32 Core;
         private readonly MappedMemory IMem;
         private readonly MappedMemory DMem;
@@ -48,10 +48,24 @@
 #define LOG_NOISY(msg, args...) \
   SIMLOG(noisy, LOG_FMT msg, LOG_ARGS(NOISY_TAG), ##args)
 
+// Boot phases timestamped by crt0 on the primary hart.
+typedef enum {
+  // First instruction of _start.
+  SPRINGBOK_BOOT_RESET = 0,
+  // Registers, CSRs, stack sentinels and atexit set up.
+  SPRINGBOK_BOOT_LIBC_INIT = 1,
+  // Static constructors done, right before main.
+  SPRINGBOK_BOOT_MAIN = 2,
+  SPRINGBOK_BOOT_PHASE_COUNT = 3,
+} springbok_boot_phase_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 int float_to_str(const int len, char *buffer, const float value);
+// Cycle count at the start of each boot phase.
+extern const volatile unsigned int
+    springbok_boot_ccount[SPRINGBOK_BOOT_PHASE_COUNT];
 #ifdef __cplusplus
 }
 #endif
@@ -22,6 +22,31 @@
 #define SPRINGBOK_SIMPRINT_DEBUG   (3)
 #define SPRINGBOK_SIMPRINT_NOISY   (4)
 
+// Markers the simulator can be armed to stop at.
+#define SPRINGBOK_MARKER_INFERENCE (1)  // Context and inputs ready, before the first inference.
+
+// Host file operations of springbok_hostfile.
+#define SPRINGBOK_HOSTFILE_OPEN  (1)  // {path} -> handle
+#define SPRINGBOK_HOSTFILE_READ  (2)  // {handle, buffer, length} -> bytes read
+#define SPRINGBOK_HOSTFILE_SEEK  (3)  // {handle, offset, whence} -> new position
+#define SPRINGBOK_HOSTFILE_CLOSE (4)  // {handle} -> 0
+
+// Copy engine operations of springbok_dma.
+#define SPRINGBOK_DMA_COPY (1)  // {destination, source, length} -> 0
+#define SPRINGBOK_DMA_WAIT (2)  // {} -> cycles stalled
+#define SPRINGBOK_DMA_READ (3)  // {source, length} -> 0, the engine time of a copy of data the core reads in place
+
+// Memory traffic counters of springbok_mem_traffic, indexed by region | direction | access type.
+#define SPRINGBOK_MEM_ITCM        (0)
+#define SPRINGBOK_MEM_DTCM        (8)
+#define SPRINGBOK_MEM_LOAD        (0)
+#define SPRINGBOK_MEM_STORE       (4)
+#define SPRINGBOK_MEM_SCALAR      (0)
+#define SPRINGBOK_MEM_UNIT_STRIDE (1)  // Including whole register and mask accesses.
+#define SPRINGBOK_MEM_STRIDED     (2)
+#define SPRINGBOK_MEM_INDEXED     (3)
+#define SPRINGBOK_MEM_COUNTERS    (16)
+
 #define springbok_simprint_error(s, n)   springbok_simprint(SPRINGBOK_SIMPRINT_ERROR, s, n)
 #define springbok_simprint_warning(s, n) springbok_simprint(SPRINGBOK_SIMPRINT_WARNING, s, n)
 #define springbok_simprint_info(s, n)    springbok_simprint(SPRINGBOK_SIMPRINT_INFO, s, n)
@@ -78,6 +103,63 @@ static inline unsigned int springbok_ccount(void) {
   return retval;
 }
 
+// energy
+// Description:
+//   This intrinsic returns a 64-bit value representing the energy in picojoules the simulator estimates since reset,
+//   from the per-event costs of its energy model. It is 0 unless the energy model of the simulator is enabled.
+// Inputs:
+//   none
+// Outputs:
+//   the estimated energy since reset, in picojoules
+static inline unsigned long long springbok_energy(void) {
+  unsigned int high, low, high_again;
+  do {
+    __asm__ volatile("csrr %0, 0x7c3;" : "=r"(high));
+    __asm__ volatile("csrr %0, 0x7c2;" : "=r"(low));
+    __asm__ volatile("csrr %0, 0x7c3;" : "=r"(high_again));
+  } while (high != high_again);
+  return ((unsigned long long)high << 32) | low;
+}
+
+// mem_traffic
+// Description:
+//   This intrinsic reads the 64-bit counters of the bytes loaded and stored since reset, by TCM, direction and scalar
+//   or vector access type. They are 0 unless the memory traffic counters of the simulator are enabled.
+// Inputs:
+//   bytes: array of SPRINGBOK_MEM_COUNTERS counters, indexed by SPRINGBOK_MEM_{ITCM,DTCM} |
+//          SPRINGBOK_MEM_{LOAD,STORE} | SPRINGBOK_MEM_{SCALAR,UNIT_STRIDE,STRIDED,INDEXED}
+// Outputs:
+//   none
+#define SPRINGBOK_READ_MEM_COUNTER(bytes, i)                                              \
+  do {                                                                                    \
+    unsigned int high, low, high_again;                                                   \
+    do {                                                                                  \
+      __asm__ volatile("csrr %0, %1;" : "=r"(high) : "i"(0x7d8 + (i)));                  \
+      __asm__ volatile("csrr %0, %1;" : "=r"(low) : "i"(0x7c8 + (i)));                   \
+      __asm__ volatile("csrr %0, %1;" : "=r"(high_again) : "i"(0x7d8 + (i)));            \
+    } while (high != high_again);                                                         \
+    bytes[i] = ((unsigned long long)high << 32) | low;                                    \
+  } while (0)
+static inline void springbok_mem_traffic(unsigned long long bytes[SPRINGBOK_MEM_COUNTERS]) {
+  SPRINGBOK_READ_MEM_COUNTER(bytes, 0);
+  SPRINGBOK_READ_MEM_COUNTER(bytes, 1);
+  SPRINGBOK_READ_MEM_COUNTER(bytes, 2);
+  SPRINGBOK_READ_MEM_COUNTER(bytes, 3);
+  SPRINGBOK_READ_MEM_COUNTER(bytes, 4);
+  SPRINGBOK_READ_MEM_COUNTER(bytes, 5);
+  SPRINGBOK_READ_MEM_COUNTER(bytes, 6);
+  SPRINGBOK_READ_MEM_COUNTER(bytes, 7);
+  SPRINGBOK_READ_MEM_COUNTER(bytes, 8);
+  SPRINGBOK_READ_MEM_COUNTER(bytes, 9);
+  SPRINGBOK_READ_MEM_COUNTER(bytes, 10);
+  SPRINGBOK_READ_MEM_COUNTER(bytes, 11);
+  SPRINGBOK_READ_MEM_COUNTER(bytes, 12);
+  SPRINGBOK_READ_MEM_COUNTER(bytes, 13);
+  SPRINGBOK_READ_MEM_COUNTER(bytes, 14);
+  SPRINGBOK_READ_MEM_COUNTER(bytes, 15);
+}
+#undef SPRINGBOK_READ_MEM_COUNTER
+
 // hostreq
 // Description:
 //   This intrinsic halts Springbok and triggers a host request interrupt in an attached management core.
@@ -93,6 +175,71 @@ static inline void springbok_hostreq(void) {
                     /* no clobbers */);
 }
 
+// marker
+// Description:
+//   This intrinsic marks a point of interest in the program. It does nothing unless the simulator is armed to stop
+//   at this marker, in which case it halts Springbok like hostreq so the host can act (e.g. save a snapshot).
+// Inputs:
+//   _id:
+//     The marker identifier, one of SPRINGBOK_MARKER_*
+// Outputs:
+//   none
+static inline void springbok_marker(int _id) {
+  // marker a0 # "------------[rs1]100-----1111011"
+  register int id __asm__ ("a0") = _id;
+  __asm__ volatile ("\t.word 0x0005407B\n" :
+                    /* no outputs */ :
+                    "r"(id) :
+                    /* no clobbers */);
+}
+
+// hostfile
+// Description:
+//   This intrinsic runs a read-only file operation on the host, in the directory the simulator serves (the HostFileRoot
+//   of the core), like semihosting. A read lands in memory in bulk, as a single instruction. Files are opened
+//   read-only, and every operation fails unless the simulator serves a directory.
+// Inputs:
+//   _op:
+//     The operation, one of SPRINGBOK_HOSTFILE_*
+//   _args:
+//     A pointer to the words of the operation arguments
+// Outputs:
+//   the result of the operation, negative on failure
+static inline int springbok_hostfile(int _op, const void *_args) {
+  // hostfile a0, a1 # "------------[rs1]101[rd ]1111011"
+  register int         op   __asm__ ("a0") = _op;
+  register const void *args __asm__ ("a1") = _args;
+  __asm__ volatile ("\t.word 0x0005D57B\n" :
+                    "+r"(op) :
+                    "r"(args) :
+                    "memory");
+  return op;
+}
+
+// dma
+// Description:
+//   This intrinsic drives the copy engine the simulator models in front of the external memory. A copy lands in memory
+//   at once, as a single instruction, but completes after the setup and transfer cycles of the engine, one copy after
+//   the other. A wait stalls Springbok until the last copy completes, and the stall counts in ccount, so the cycles a
+//   copy overlaps with computation are hidden.
+// Inputs:
+//   _op:
+//     The operation, one of SPRINGBOK_DMA_*
+//   _args:
+//     A pointer to the words of the operation arguments
+// Outputs:
+//   the result of the operation, negative on failure
+static inline int springbok_dma(int _op, const void *_args) {
+  // dma a0, a1 # "------------[rs1]110[rd ]1111011"
+  register int         op   __asm__ ("a0") = _op;
+  register const void *args __asm__ ("a1") = _args;
+  __asm__ volatile ("\t.word 0x0005E57B\n" :
+                    "+r"(op) :
+                    "r"(args) :
+                    "memory");
+  return op;
+}
+
 // finish
 // Description:
 //   This intrinsic halts and resets Springbok while triggerring a completion interrupt in an attached management core.
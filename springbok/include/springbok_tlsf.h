@@ -0,0 +1,81 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Two-level segregated fit allocator.
+//
+// Free blocks are kept in size classes: a first level of powers of two, each
+// split linearly in 32 second-level classes, with a bitmap of the non-empty
+// classes at each level. Allocation, free and the merges of neighboring free
+// blocks are all O(1), and the good fit of the size classes keeps the
+// fragmentation low when buffers of many sizes are allocated and freed over
+// many inferences. With SPRINGBOK_TLSF_MALLOC, the BSP replaces newlib-nano's
+// malloc with one of these over the _sheap.._eheap region.
+
+#ifndef SPRINGBOK_TLSF_H
+#define SPRINGBOK_TLSF_H
+
+#include <stddef.h>
+
+// Alignment of every block returned by springbok_tlsf_malloc.
+#define SPRINGBOK_TLSF_ALIGN (8)
+
+typedef struct springbok_tlsf springbok_tlsf_t;
+
+typedef struct {
+  // Bytes the pool can hand out, before any block header.
+  size_t pool_bytes;
+  // Bytes in allocated blocks, now and at most since the pool was created.
+  size_t used_bytes;
+  size_t peak_used_bytes;
+  // Bytes in free blocks, and in the largest of them.
+  size_t free_bytes;
+  size_t largest_free_bytes;
+  size_t used_blocks;
+  size_t free_blocks;
+  // Allocations that found no free block large enough.
+  size_t failed_allocations;
+  // Share of the free bytes outside the largest free block, in percent.
+  unsigned int fragmentation_percent;
+} springbok_tlsf_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Creates an allocator over `bytes` of `memory`, which holds its control
+// structure too. Returns NULL when the memory is too small.
+springbok_tlsf_t *springbok_tlsf_create(void *memory, size_t bytes);
+void *springbok_tlsf_malloc(springbok_tlsf_t *tlsf, size_t size);
+// `alignment` is a power of two, such as 64 for blocks vector loads and stores
+// access a whole cache line at a time.
+void *springbok_tlsf_memalign(springbok_tlsf_t *tlsf, size_t alignment,
+                              size_t size);
+void *springbok_tlsf_realloc(springbok_tlsf_t *tlsf, void *ptr, size_t size);
+void springbok_tlsf_free(springbok_tlsf_t *tlsf, void *ptr);
+// Usable size of an allocated block, at least the size it was asked for.
+size_t springbok_tlsf_block_size(const void *ptr);
+// Walks the blocks of the pool, so this one is O(blocks).
+void springbok_tlsf_stats(const springbok_tlsf_t *tlsf,
+                          springbok_tlsf_stats_t *stats);
+
+// Statistics of the allocator behind malloc, with SPRINGBOK_TLSF_MALLOC.
+void springbok_heap_stats(springbok_tlsf_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -14,6 +14,7 @@
 
 #include <stdlib.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <stdint.h>
@@ -22,6 +23,14 @@
 
 void* __dso_handle = (void*) &__dso_handle;
 
+#if defined(SPRINGBOK_TLSF_MALLOC)
+// The heap belongs to the TLSF allocator behind malloc.
+extern "C" void *_sbrk(int nbytes) {
+  springbok_simprint(SPRINGBOK_SIMPRINT_ERROR, "_sbrk is not available with the TLSF malloc. Number of bytes requested:", nbytes);
+  errno = ENOMEM;
+  return (void *)-1;
+}
+#else
 extern "C" void *_sbrk(int nbytes) {
   extern char _sheap, _eheap;
   static char *_heap_ptr = &_sheap;
@@ -38,8 +47,56 @@ extern "C" void *_sbrk(int nbytes) {
   _heap_ptr += nbytes;
   return base;
 }
+#endif
+
+// Files on the host, served read-only by the simulator through the hostfile
+// intrinsic, get the file descriptors from 3 up.
+static const int kHostFileBase = 3;
+
+static inline bool is_host_file(int file) {
+  return file >= kHostFileBase;
+}
+
+static int hostfile_seek(int file, int offset, int whence) {
+  const uint32_t args[] = {static_cast<uint32_t>(file - kHostFileBase),
+                           static_cast<uint32_t>(offset),
+                           static_cast<uint32_t>(whence)};
+  int position = springbok_hostfile(SPRINGBOK_HOSTFILE_SEEK, args);
+  if (position < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  return position;
+}
+
+extern "C" int _open(const char *path, int flags, int mode) {
+  if ((flags & O_ACCMODE) != O_RDONLY) {
+    errno = EROFS;
+    return -1;
+  }
+
+  const uint32_t args[] = {reinterpret_cast<uintptr_t>(path)};
+  int handle = springbok_hostfile(SPRINGBOK_HOSTFILE_OPEN, args);
+  if (handle < 0) {
+    errno = ENOENT;
+    return -1;
+  }
+  return handle + kHostFileBase;
+}
 
 extern "C" int _read(int file, char *ptr, int len) {
+  if (is_host_file(file)) {
+    const uint32_t args[] = {static_cast<uint32_t>(file - kHostFileBase),
+                             reinterpret_cast<uintptr_t>(ptr),
+                             static_cast<uint32_t>(len)};
+    int bytes_read = springbok_hostfile(SPRINGBOK_HOSTFILE_READ, args);
+    if (bytes_read < 0) {
+      errno = EBADF;
+      return -1;
+    }
+    return bytes_read;
+  }
+
   if (file != STDIN_FILENO) {
     errno = EBADF;
     return -1;
@@ -98,11 +155,22 @@ extern "C" int _write(int file, char *buf, int nbytes) {
 }
 
 extern "C" int _close(int file) {
+  if (is_host_file(file)) {
+    const uint32_t args[] = {static_cast<uint32_t>(file - kHostFileBase)};
+    if (springbok_hostfile(SPRINGBOK_HOSTFILE_CLOSE, args) == 0) {
+      return 0;
+    }
+  }
+
   errno = EBADF;
   return -1;
 }
 
 extern "C" int _lseek(int file, int offset, int whence) {
+  if (is_host_file(file)) {
+    return hostfile_seek(file, offset, whence);
+  }
+
   if (file != STDOUT_FILENO && file != STDERR_FILENO) {
     errno = EBADF;
     return -1;
@@ -112,7 +180,7 @@ extern "C" int _lseek(int file, int offset, int whence) {
 }
 
 extern "C" int _fstat(int file, struct stat *st) {
-  if (file != STDOUT_FILENO && file != STDERR_FILENO) {
+  if (file != STDOUT_FILENO && file != STDERR_FILENO && !is_host_file(file)) {
     errno = EBADF;
     return -1;
   }
@@ -122,11 +190,28 @@ extern "C" int _fstat(int file, struct stat *st) {
     return -1;
   }
 
+  if (is_host_file(file)) {
+    // The size of a host file is the position of its end.
+    int position = hostfile_seek(file, 0, SEEK_CUR);
+    int size = (position < 0) ? -1 : hostfile_seek(file, 0, SEEK_END);
+    if (size < 0 || hostfile_seek(file, position, SEEK_SET) < 0) {
+      return -1;
+    }
+    st->st_mode = S_IFREG;
+    st->st_size = size;
+    return 0;
+  }
+
   st->st_mode = S_IFCHR;
   return 0;
 }
 
 extern "C" int _isatty(int file) {
+  if (is_host_file(file)) {
+    errno = ENOTTY;
+    return 0;
+  }
+
   if (file != STDOUT_FILENO && file != STDERR_FILENO) {
     errno = EBADF;
     return -1;
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2022 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// malloc and friends on a TLSF allocator over the _sheap.._eheap region, in
+// place of newlib-nano's first-fit free list on top of _sbrk. Both the
+// reentrant entry points newlib calls internally and the public ones are
+// defined here, so none of newlib-nano's malloc objects gets linked.
+
+#include <errno.h>
+#include <reent.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <springbok_intrinsics.h>
+
+#include "springbok_tlsf.h"
+
+static springbok_tlsf_t *heap(void) {
+  static springbok_tlsf_t *tlsf;
+  if (!tlsf) {
+    extern char _sheap, _eheap;
+    tlsf = springbok_tlsf_create(&_sheap, &_eheap - &_sheap);
+  }
+  return tlsf;
+}
+
+static void *check_allocation(struct _reent *reent, void *ptr, size_t size) {
+  if (!ptr) {
+    springbok_simprint(SPRINGBOK_SIMPRINT_ERROR,
+                       "malloc failed to allocate memory. Number of bytes "
+                       "requested:", (int)size);
+    reent->_errno = ENOMEM;
+  }
+  return ptr;
+}
+
+void *_malloc_r(struct _reent *reent, size_t size) {
+  springbok_tlsf_t *tlsf = heap();
+  return check_allocation(reent,
+                          tlsf ? springbok_tlsf_malloc(tlsf, size) : NULL,
+                          size);
+}
+
+void _free_r(struct _reent *reent, void *ptr) {
+  if (ptr) {
+    springbok_tlsf_free(heap(), ptr);
+  }
+}
+
+void *_calloc_r(struct _reent *reent, size_t count, size_t size) {
+  size_t bytes;
+  if (__builtin_mul_overflow(count, size, &bytes)) {
+    reent->_errno = ENOMEM;
+    return NULL;
+  }
+  void *ptr = _malloc_r(reent, bytes);
+  if (ptr) {
+    memset(ptr, 0, bytes);
+  }
+  return ptr;
+}
+
+void *_realloc_r(struct _reent *reent, void *ptr, size_t size) {
+  springbok_tlsf_t *tlsf = heap();
+  if (!tlsf) {
+    return check_allocation(reent, NULL, size);
+  }
+  void *moved = springbok_tlsf_realloc(tlsf, ptr, size);
+  // A zero size frees the block and returns NULL.
+  return size ? check_allocation(reent, moved, size) : moved;
+}
+
+void *_memalign_r(struct _reent *reent, size_t alignment, size_t size) {
+  springbok_tlsf_t *tlsf = heap();
+  return check_allocation(
+      reent, tlsf ? springbok_tlsf_memalign(tlsf, alignment, size) : NULL,
+      size);
+}
+
+size_t _malloc_usable_size_r(struct _reent *reent, void *ptr) {
+  return springbok_tlsf_block_size(ptr);
+}
+
+void *malloc(size_t size) { return _malloc_r(_REENT, size); }
+
+void free(void *ptr) { _free_r(_REENT, ptr); }
+
+void *calloc(size_t count, size_t size) {
+  return _calloc_r(_REENT, count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  return _realloc_r(_REENT, ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+  return _memalign_r(_REENT, alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+  return _memalign_r(_REENT, alignment, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size) {
+  if (alignment < sizeof(void *) || alignment & (alignment - 1)) {
+    return EINVAL;
+  }
+  void *ptr = _memalign_r(_REENT, alignment, size);
+  if (!ptr) {
+    return ENOMEM;
+  }
+  *memptr = ptr;
+  return 0;
+}
+
+size_t malloc_usable_size(void *ptr) {
+  return _malloc_usable_size_r(_REENT, ptr);
+}
+
+void springbok_heap_stats(springbok_tlsf_stats_t *stats) {
+  springbok_tlsf_t *tlsf = heap();
+  if (tlsf) {
+    springbok_tlsf_stats(tlsf, stats);
+  } else {
+    memset(stats, 0, sizeof(*stats));
+  }
+}
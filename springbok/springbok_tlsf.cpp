@@ -0,0 +1,378 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "springbok_tlsf.h"
+
+// Every block starts with a header holding the previous block in memory and
+// the size of its payload, which follows the header. Free blocks link into
+// the list of their size class from the start of their payload. The pool ends
+// with an empty used block, so every block has a next one.
+struct Block {
+  Block *prev_phys;
+  size_t size;  // Payload bytes, with kFreeBit.
+  // Only in free blocks.
+  Block *next_free;
+  Block *prev_free;
+};
+
+static const size_t kFreeBit = 1;
+static const size_t kHeaderSize = 2 * sizeof(size_t);
+static const size_t kAlign = SPRINGBOK_TLSF_ALIGN;
+// A free block holds the two free list links.
+static const size_t kMinPayload = 2 * sizeof(Block *);
+static const size_t kMinBlock = kHeaderSize + kMinPayload;
+
+// Sizes below kSmallBlockSize are all in the first level, split in classes of
+// kAlign bytes. Above, the first level is the most significant bit of the size
+// and the second level the next kSlIndexCountLog2 bits.
+static const int kSlIndexCountLog2 = 5;
+static const int kSlIndexCount = 1 << kSlIndexCountLog2;
+static const int kFlIndexShift = kSlIndexCountLog2 + 3;  // log2(kAlign)
+static const int kFlIndexMax = 30;
+static const int kFlIndexCount = kFlIndexMax - kFlIndexShift + 1;
+static const size_t kSmallBlockSize = size_t(1) << kFlIndexShift;
+static const size_t kMaxPayload = size_t(1) << kFlIndexMax;
+
+struct springbok_tlsf {
+  uint32_t fl_bitmap;
+  uint32_t sl_bitmap[kFlIndexCount];
+  Block *free_lists[kFlIndexCount][kSlIndexCount];
+  Block *first;
+  size_t pool_bytes;
+  size_t used_bytes;
+  size_t peak_used_bytes;
+  size_t failed_allocations;
+};
+
+static inline int highest_bit(size_t value) {
+  return static_cast<int>(sizeof(value) * 8 - 1) - __builtin_clzl(value);
+}
+
+static inline int lowest_bit(uint32_t value) {
+  return __builtin_ctz(value);
+}
+
+static inline size_t align_up(size_t value, size_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static inline size_t block_size(const Block *block) {
+  return block->size & ~kFreeBit;
+}
+
+static inline bool is_free(const Block *block) {
+  return block->size & kFreeBit;
+}
+
+static inline char *payload(Block *block) {
+  return reinterpret_cast<char *>(block) + kHeaderSize;
+}
+
+static inline Block *from_payload(const void *ptr) {
+  return reinterpret_cast<Block *>(
+      const_cast<char *>(static_cast<const char *>(ptr)) - kHeaderSize);
+}
+
+static inline Block *next_phys(Block *block) {
+  return reinterpret_cast<Block *>(payload(block) + block_size(block));
+}
+
+// Sets the size of a block, and the back link of the block it now ends at.
+static inline void set_size(Block *block, size_t size, bool free) {
+  block->size = size | (free ? kFreeBit : 0);
+  next_phys(block)->prev_phys = block;
+}
+
+static void mapping_insert(size_t size, int *fl, int *sl) {
+  if (size < kSmallBlockSize) {
+    *fl = 0;
+    *sl = static_cast<int>(size / (kSmallBlockSize / kSlIndexCount));
+  } else {
+    int bit = highest_bit(size);
+    *sl = static_cast<int>(size >> (bit - kSlIndexCountLog2)) ^
+          kSlIndexCount;
+    *fl = bit - (kFlIndexShift - 1);
+  }
+}
+
+// Rounds the size up to the next class, so that any block of the class found
+// is large enough.
+static void mapping_search(size_t size, int *fl, int *sl) {
+  if (size >= kSmallBlockSize) {
+    size += (size_t(1) << (highest_bit(size) - kSlIndexCountLog2)) - 1;
+  }
+  mapping_insert(size, fl, sl);
+}
+
+static void insert_free_block(springbok_tlsf_t *tlsf, Block *block) {
+  int fl, sl;
+  mapping_insert(block_size(block), &fl, &sl);
+  Block *head = tlsf->free_lists[fl][sl];
+  block->next_free = head;
+  block->prev_free = nullptr;
+  if (head) {
+    head->prev_free = block;
+  }
+  tlsf->free_lists[fl][sl] = block;
+  tlsf->fl_bitmap |= 1u << fl;
+  tlsf->sl_bitmap[fl] |= 1u << sl;
+}
+
+static void remove_free_block(springbok_tlsf_t *tlsf, Block *block) {
+  int fl, sl;
+  mapping_insert(block_size(block), &fl, &sl);
+  if (block->prev_free) {
+    block->prev_free->next_free = block->next_free;
+  } else {
+    tlsf->free_lists[fl][sl] = block->next_free;
+    if (!block->next_free) {
+      tlsf->sl_bitmap[fl] &= ~(1u << sl);
+      if (!tlsf->sl_bitmap[fl]) {
+        tlsf->fl_bitmap &= ~(1u << fl);
+      }
+    }
+  }
+  if (block->next_free) {
+    block->next_free->prev_free = block->prev_free;
+  }
+}
+
+// Takes a free block of at least `size` bytes off its list.
+static Block *take_free_block(springbok_tlsf_t *tlsf, size_t size) {
+  int fl, sl;
+  mapping_search(size, &fl, &sl);
+  if (fl >= kFlIndexCount) {
+    return nullptr;
+  }
+  uint32_t sl_map = tlsf->sl_bitmap[fl] & (~0u << sl);
+  if (!sl_map) {
+    uint32_t fl_map = tlsf->fl_bitmap & (~0u << (fl + 1));
+    if (!fl_map) {
+      return nullptr;
+    }
+    fl = lowest_bit(fl_map);
+    sl_map = tlsf->sl_bitmap[fl];
+  }
+  sl = lowest_bit(sl_map);
+  Block *block = tlsf->free_lists[fl][sl];
+  remove_free_block(tlsf, block);
+  return block;
+}
+
+// Merges a free block, off its list, with its free neighbors.
+static Block *merge_free_block(springbok_tlsf_t *tlsf, Block *block) {
+  Block *prev = block->prev_phys;
+  if (prev && is_free(prev)) {
+    remove_free_block(tlsf, prev);
+    set_size(prev, block_size(prev) + kHeaderSize + block_size(block), true);
+    block = prev;
+  }
+  Block *next = next_phys(block);
+  if (is_free(next)) {
+    remove_free_block(tlsf, next);
+    set_size(block, block_size(block) + kHeaderSize + block_size(next), true);
+  }
+  return block;
+}
+
+// Shrinks a used block to `size` bytes and frees the rest, when the rest can
+// make a block.
+static void trim_used_block(springbok_tlsf_t *tlsf, Block *block,
+                            size_t size) {
+  size_t current = block_size(block);
+  if (current < size + kMinBlock) {
+    return;
+  }
+  Block *rest = reinterpret_cast<Block *>(payload(block) + size);
+  rest->prev_phys = block;
+  set_size(rest, current - size - kHeaderSize, true);
+  block->size = size;
+  insert_free_block(tlsf, merge_free_block(tlsf, rest));
+}
+
+// Marks a block taken off its free list used, trimmed to `size` bytes.
+static void *use_block(springbok_tlsf_t *tlsf, Block *block, size_t size) {
+  block->size &= ~kFreeBit;
+  trim_used_block(tlsf, block, size);
+  tlsf->used_bytes += block_size(block);
+  if (tlsf->used_bytes > tlsf->peak_used_bytes) {
+    tlsf->peak_used_bytes = tlsf->used_bytes;
+  }
+  return payload(block);
+}
+
+static inline size_t adjust_size(size_t size) {
+  return size < kMinPayload ? kMinPayload : align_up(size, kAlign);
+}
+
+extern "C" springbok_tlsf_t *springbok_tlsf_create(void *memory,
+                                                   size_t bytes) {
+  uintptr_t start = reinterpret_cast<uintptr_t>(memory);
+  uintptr_t end = (start + bytes) & ~(kAlign - 1);
+  uintptr_t pool = align_up(start + sizeof(springbok_tlsf), kAlign);
+  if (end < pool || end - pool < 2 * kHeaderSize + kMinPayload) {
+    return nullptr;
+  }
+
+  springbok_tlsf_t *tlsf = static_cast<springbok_tlsf_t *>(memory);
+  memset(tlsf, 0, sizeof(*tlsf));
+  size_t pool_bytes = end - pool - 2 * kHeaderSize;
+  if (pool_bytes >= kMaxPayload) {
+    pool_bytes = kMaxPayload - kAlign;
+  }
+  Block *block = reinterpret_cast<Block *>(pool);
+  block->prev_phys = nullptr;
+  block->size = pool_bytes;
+  // The end sentinel: an empty used block.
+  next_phys(block)->size = 0;
+  set_size(block, pool_bytes, true);
+  insert_free_block(tlsf, block);
+  tlsf->first = block;
+  tlsf->pool_bytes = pool_bytes;
+  return tlsf;
+}
+
+extern "C" void *springbok_tlsf_malloc(springbok_tlsf_t *tlsf, size_t size) {
+  if (size >= kMaxPayload) {
+    ++tlsf->failed_allocations;
+    return nullptr;
+  }
+  size = adjust_size(size);
+  Block *block = take_free_block(tlsf, size);
+  if (!block) {
+    ++tlsf->failed_allocations;
+    return nullptr;
+  }
+  return use_block(tlsf, block, size);
+}
+
+extern "C" void *springbok_tlsf_memalign(springbok_tlsf_t *tlsf,
+                                         size_t alignment, size_t size) {
+  if (alignment <= kAlign) {
+    return springbok_tlsf_malloc(tlsf, size);
+  }
+  if (alignment & (alignment - 1) || size >= kMaxPayload - alignment) {
+    ++tlsf->failed_allocations;
+    return nullptr;
+  }
+  // Room to move the payload up to the alignment, leaving a free block
+  // before it.
+  size = adjust_size(size);
+  Block *block = take_free_block(tlsf, size + alignment + kMinBlock);
+  if (!block) {
+    ++tlsf->failed_allocations;
+    return nullptr;
+  }
+
+  uintptr_t ptr = reinterpret_cast<uintptr_t>(payload(block));
+  uintptr_t aligned = align_up(ptr, alignment);
+  if (aligned != ptr) {
+    aligned = align_up(ptr + kMinBlock, alignment);
+  }
+  if (aligned != ptr) {
+    size_t gap = aligned - ptr;
+    Block *moved = from_payload(reinterpret_cast<void *>(aligned));
+    moved->prev_phys = block;
+    set_size(moved, block_size(block) - gap, false);
+    // The neighbors of a free block are used, so the gap stays one block.
+    block->size = (gap - kHeaderSize) | kFreeBit;
+    insert_free_block(tlsf, block);
+    block = moved;
+  }
+  return use_block(tlsf, block, size);
+}
+
+extern "C" void springbok_tlsf_free(springbok_tlsf_t *tlsf, void *ptr) {
+  if (!ptr) {
+    return;
+  }
+  Block *block = from_payload(ptr);
+  tlsf->used_bytes -= block_size(block);
+  block->size |= kFreeBit;
+  insert_free_block(tlsf, merge_free_block(tlsf, block));
+}
+
+extern "C" void *springbok_tlsf_realloc(springbok_tlsf_t *tlsf, void *ptr,
+                                        size_t size) {
+  if (!ptr) {
+    return springbok_tlsf_malloc(tlsf, size);
+  }
+  if (size == 0) {
+    springbok_tlsf_free(tlsf, ptr);
+    return nullptr;
+  }
+  if (size >= kMaxPayload) {
+    ++tlsf->failed_allocations;
+    return nullptr;
+  }
+
+  Block *block = from_payload(ptr);
+  size_t current = block_size(block);
+  size = adjust_size(size);
+  if (size > current) {
+    // Grow in place into a free next block, or move.
+    Block *next = next_phys(block);
+    size_t combined = current + kHeaderSize + block_size(next);
+    if (!is_free(next) || combined < size) {
+      void *moved = springbok_tlsf_malloc(tlsf, size);
+      if (moved) {
+        memcpy(moved, ptr, current);
+        springbok_tlsf_free(tlsf, ptr);
+      }
+      return moved;
+    }
+    remove_free_block(tlsf, next);
+    set_size(block, combined, false);
+  }
+  trim_used_block(tlsf, block, size);
+  tlsf->used_bytes = tlsf->used_bytes - current + block_size(block);
+  if (tlsf->used_bytes > tlsf->peak_used_bytes) {
+    tlsf->peak_used_bytes = tlsf->used_bytes;
+  }
+  return ptr;
+}
+
+extern "C" size_t springbok_tlsf_block_size(const void *ptr) {
+  return ptr ? block_size(from_payload(ptr)) : 0;
+}
+
+extern "C" void springbok_tlsf_stats(const springbok_tlsf_t *tlsf,
+                                     springbok_tlsf_stats_t *stats) {
+  memset(stats, 0, sizeof(*stats));
+  stats->pool_bytes = tlsf->pool_bytes;
+  stats->used_bytes = tlsf->used_bytes;
+  stats->peak_used_bytes = tlsf->peak_used_bytes;
+  stats->failed_allocations = tlsf->failed_allocations;
+  for (Block *block = tlsf->first; block_size(block);
+       block = next_phys(block)) {
+    size_t size = block_size(block);
+    if (is_free(block)) {
+      ++stats->free_blocks;
+      stats->free_bytes += size;
+      if (size > stats->largest_free_bytes) {
+        stats->largest_free_bytes = size;
+      }
+    } else {
+      ++stats->used_blocks;
+    }
+  }
+  if (stats->free_bytes) {
+    stats->fragmentation_percent = static_cast<unsigned int>(
+        100ull * (stats->free_bytes - stats->largest_free_bytes) /
+        stats->free_bytes);
+  }
+}
@@ -30,4 +30,11 @@
 #define IREE_DEVICE_SIZE_T uint32_t
 #define PRIdsz PRIu32
 
+// The bytecode modules are embedded in the firmware at build time. When they
+// are trusted, skip their verification, which walks the whole flatbuffer on
+// every load.
+#if defined(SPRINGBOK_TRUSTED_MODULES)
+#define IREE_VM_BYTECODE_VERIFICATION_ENABLE 0
+#endif
+
 #endif // SPRINGBOK_CONFIG_H